@@ -0,0 +1,408 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "headless_runner.hpp"
+
+#include "trace_recorder.hpp"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QTextStream>
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+
+// Only a lock-free flag is safe to touch from a signal handler
+static std::atomic<bool> stopRequested{false};
+
+static void requestStop(int /*signal*/)
+{
+    stopRequested = true;
+}
+
+HeadlessRunner::HeadlessRunner(SourceManager *manager)
+    : manager_(manager), duration_(0), statsInterval_(0), lockMemory_(false),
+      traceEvents_(TRACE_EVENTS_PER_THREAD)
+{
+}
+
+static ThreadProfile threadProfileFromJson(const QJsonObject &json)
+{
+    ThreadProfile profile;
+    for (const auto &cpu : json["cpus"].toArray())
+    {
+        profile.cpus.push_back(cpu.toInt());
+    }
+    auto policy = json["policy"].toString("default");
+    if (policy == "fifo")
+    {
+        profile.policy = SchedulingPolicy::Fifo;
+    }
+    else if (policy == "rr")
+    {
+        profile.policy = SchedulingPolicy::RoundRobin;
+    }
+    else if (policy != "default")
+    {
+        qDebug() << "Unknown scheduling policy " << policy << ", using the default.";
+    }
+    profile.priority = json["priority"].toInt(0);
+    return profile;
+}
+
+// False if the window or the averaging isn't known
+static bool spectrumOptionsFromJson(const QJsonObject &json, SpectrumOptions &options)
+{
+    auto ok = true;
+    options.fftSize =
+        static_cast<size_t>(json["fft_size"].toInt(static_cast<int>(options.fftSize)));
+    if (json.contains("window") &&
+        !parseWindowFunction(json["window"].toString().toStdString(), options.window))
+    {
+        qDebug() << "Unknown window: " << json["window"];
+        ok = false;
+    }
+    options.overlap = json["overlap"].toDouble(options.overlap);
+    if (json.contains("averaging") &&
+        !parseSpectrumAveraging(json["averaging"].toString().toStdString(),
+                                options.averaging))
+    {
+        qDebug() << "Unknown averaging: " << json["averaging"];
+        ok = false;
+    }
+    options.averages =
+        static_cast<size_t>(json["averages"].toInt(static_cast<int>(options.averages)));
+    options.updateRate = json["update_rate"].toDouble(options.updateRate);
+    options.channel = static_cast<size_t>(json["channel"].toInt(0));
+    return ok;
+}
+
+// The acquisition thread should never compete with the DSP for a CPU
+static void checkIsolation(const QString &id, const SchedulingProfile &profile)
+{
+    for (auto cpu : profile.acquisition.cpus)
+    {
+        const auto &dsp = profile.dispatch.cpus;
+        if (std::find(dsp.begin(), dsp.end(), cpu) != dsp.end())
+        {
+            qDebug() << id << ": CPU " << cpu
+                     << " runs both acquisition and dispatch, overflows are likely.";
+        }
+    }
+}
+
+bool HeadlessRunner::load(const QJsonObject &config)
+{
+    duration_ = config["duration"].toDouble(0);
+    statsInterval_ = config["stats_interval"].toDouble(0);
+    lockMemory_ = config["lock_memory"].toBool(false);
+    metricsConfig_ = config["metrics"].toObject();
+    auto trace = config["trace"].toObject();
+    tracePath_ = trace["path"].toString();
+    traceEvents_ = static_cast<size_t>(
+        trace["events_per_thread"].toDouble(TRACE_EVENTS_PER_THREAD));
+
+    auto ok = true;
+    for (const auto &value : config["sources"].toArray())
+    {
+        auto entry = value.toObject();
+        auto id = entry["id"].toString();
+        auto type = entry["type"].toString();
+        if (id.isEmpty() || type.isEmpty())
+        {
+            qDebug() << "Every source needs an id and a type: " << entry;
+            ok = false;
+            continue;
+        }
+
+        std::vector<int> cpus;
+        for (const auto &cpu : entry["cpus"].toArray())
+        {
+            cpus.push_back(cpu.toInt());
+        }
+
+        SourceListenersCollection listeners;
+        if (entry.contains("record"))
+        {
+            auto record = entry["record"].toObject();
+            IqRecorderOptions options;
+            options.maxFileBytes =
+                static_cast<uint64_t>(record["max_file_bytes"].toDouble(0));
+            options.maxFileSeconds = record["max_file_seconds"].toDouble(0);
+            options.directIo = record["direct_io"].toBool(true);
+            options.channel = static_cast<size_t>(record["channel"].toInt(0));
+            options.writerThread = threadProfileFromJson(record["thread"].toObject());
+
+            auto recorder = std::make_shared<IqRecorder>(options);
+            SubscriptionOptions subscription;
+            subscription.name = id.toStdString() + "/record";
+            listeners.subscribe(recorder, subscription);
+            recordings_.push_back({recorder, record["path"].toString(id)});
+        }
+        if (entry.contains("sweep"))
+        {
+            auto sweep = entry["sweep"].toObject();
+            SweepOptions options;
+            options.startFrequency = sweep["start"].toDouble(0);
+            options.stopFrequency = sweep["stop"].toDouble(0);
+            options.fftSize =
+                static_cast<size_t>(sweep["fft_size"].toInt(SWEEP_FFT_SIZE));
+            options.averages =
+                static_cast<size_t>(sweep["averages"].toInt(SWEEP_AVERAGES));
+            options.usableFraction = sweep["usable"].toDouble(SWEEP_USABLE_FRACTION);
+            options.dcMaskBins =
+                static_cast<size_t>(sweep["dc_mask_bins"].toInt(SWEEP_DC_MASK_BINS));
+            options.settleTime = sweep["settle"].toDouble(SWEEP_SETTLE_TIME);
+            options.channel = static_cast<size_t>(sweep["channel"].toInt(0));
+            options.fftThread = threadProfileFromJson(sweep["thread"].toObject());
+
+            // Inline, as it retunes the source from its stream thread
+            auto engine = std::make_shared<SweepEngine>(options);
+            SubscriptionOptions subscription;
+            subscription.name = id.toStdString() + "/sweep";
+            listeners.subscribe(engine, subscription);
+            sweeps_.push_back({engine, id.toStdString(), sweep["path"].toString()});
+        }
+        if (entry.contains("spectrum"))
+        {
+            auto spectrum = entry["spectrum"].toObject();
+            SpectrumOptions options;
+            ok &= spectrumOptionsFromJson(spectrum, options);
+
+            // A display's pace: when the CPU is short, spectra are lost, not the stream
+            auto analyser = std::make_shared<SpectrumAnalyser>(options);
+            SubscriptionOptions subscription;
+            subscription.dedicatedThread = true;
+            subscription.policy = BackpressurePolicy::DropOldest;
+            subscription.thread = threadProfileFromJson(spectrum["thread"].toObject());
+            subscription.name = id.toStdString() + "/spectrum";
+            listeners.subscribe(analyser, subscription);
+            analyses_.push_back(
+                {analyser, id.toStdString(), spectrum["path"].toString()});
+        }
+
+        auto *source = manager_->addSource(id.toStdString(), type.toStdString(),
+                                           std::move(listeners), cpus);
+        if (source == nullptr)
+        {
+            ok = false;
+            continue;
+        }
+
+        if (entry.contains("scheduling"))
+        {
+            auto scheduling = entry["scheduling"].toObject();
+            SchedulingProfile profile;
+            profile.acquisition =
+                threadProfileFromJson(scheduling["acquisition"].toObject());
+            profile.dispatch = threadProfileFromJson(scheduling["dispatch"].toObject());
+            checkIsolation(id, profile);
+            source->setSchedulingProfile(profile);
+        }
+
+        if (!source->configure(entry["settings"].toObject()))
+        {
+            qDebug() << "Couldn't configure " << id;
+            ok = false;
+        }
+    }
+
+    if (manager_->getSourceIds().empty())
+    {
+        qDebug() << "No sources to run.";
+        return false;
+    }
+    return ok;
+}
+
+int HeadlessRunner::exec()
+{
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+
+    // Before the streams allocate their buffers; not fatal, only riskier
+    if (lockMemory_)
+    {
+        lockProcessMemory();
+    }
+
+    for (auto &recording : recordings_)
+    {
+        if (!recording.recorder->startRecording(recording.path))
+        {
+            qDebug() << "Couldn't start recording to " << recording.path;
+            return 1;
+        }
+    }
+
+    for (auto &sweep : sweeps_)
+    {
+        if (!sweep.engine->startSweep(manager_->getSource(sweep.sourceId)))
+        {
+            qDebug() << "Couldn't start sweeping "
+                     << QString::fromStdString(sweep.sourceId);
+            return 1;
+        }
+    }
+
+    if (!startMetrics())
+    {
+        return 1;
+    }
+
+    if (!tracePath_.isEmpty())
+    {
+        TraceRecorder::shared().start(traceEvents_);
+    }
+    manager_->startAll();
+
+    QObject::connect(&signalTimer_, &QTimer::timeout, [&]() {
+        auto ids = manager_->getSourceIds();
+        auto finished = std::all_of(ids.begin(), ids.end(), [&](const std::string &id) {
+            return manager_->getSource(id)->isFinished();
+        });
+        if (stopRequested || finished)
+        {
+            QCoreApplication::quit();
+        }
+    });
+    signalTimer_.start(HEADLESS_SIGNAL_POLL);
+
+    if (statsInterval_ > 0)
+    {
+        QObject::connect(&statsTimer_, &QTimer::timeout, [&]() { printStatistics(); });
+        // NOLINTNEXTLINE(readability-magic-numbers)
+        statsTimer_.start(static_cast<int>(statsInterval_ * 1000));
+    }
+
+    if (duration_ > 0)
+    {
+        // NOLINTNEXTLINE(readability-magic-numbers)
+        QTimer::singleShot(static_cast<int>(duration_ * 1000),
+                           []() { QCoreApplication::quit(); });
+    }
+
+    auto res = QCoreApplication::exec();
+
+    signalTimer_.stop();
+    statsTimer_.stop();
+
+    // The sources first, so the recorders get everything they were sent
+    manager_->stopAll();
+    for (auto &recording : recordings_)
+    {
+        recording.recorder->stopRecording();
+    }
+    for (auto &sweep : sweeps_)
+    {
+        sweep.engine->stopSweep();
+        if (!sweep.path.isEmpty())
+        {
+            auto spectrum = sweep.engine->getSpectrum();
+            saveSpectrum(sweep.path, spectrum.startFrequency, spectrum.binWidth,
+                         spectrum.power);
+        }
+    }
+    for (auto &analysis : analyses_)
+    {
+        if (!analysis.path.isEmpty())
+        {
+            auto spectrum = analysis.analyser->getSpectrum();
+            saveSpectrum(analysis.path, spectrum.startFrequency, spectrum.binWidth,
+                         spectrum.power);
+        }
+    }
+
+    printStatistics();
+    metrics_.stop();
+
+    if (!tracePath_.isEmpty())
+    {
+        TraceRecorder::shared().stop();
+        if (!TraceRecorder::shared().writeChromeTrace(tracePath_.toStdString()))
+        {
+            qDebug() << "Couldn't write the trace to " << tracePath_;
+        }
+    }
+    return res;
+}
+
+bool HeadlessRunner::startMetrics()
+{
+    if (metricsConfig_.contains("port"))
+    {
+        auto port = metricsConfig_["port"].toInt(METRICS_DEFAULT_PORT);
+        if (!metrics_.listen(static_cast<uint16_t>(port)))
+        {
+            return false;
+        }
+    }
+    if (metricsConfig_.contains("path"))
+    {
+        auto interval = metricsConfig_["interval"].toDouble(statsInterval_);
+        if (!metrics_.writeFile(metricsConfig_["path"].toString(), interval))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void HeadlessRunner::printStatistics()
+{
+    for (const auto &id : manager_->getSourceIds())
+    {
+        auto stats = manager_->getSource(id)->getStatistics();
+        qDebug().nospace() << QString::fromStdString(id)
+                           << ": samples: " << stats.samplesReceived
+                           << ", measured rate: " << stats.measuredSampleRate
+                           << ", overflows: " << stats.overflows
+                           << ", dropped blocks: " << stats.droppedBlocks
+                           << ", gaps: " << stats.gaps
+                           << ", lost samples: " << stats.lostSamples
+                           << ", retunes: " << stats.retunes
+                           << ", recoveries: " << stats.recoveries;
+    }
+    for (const auto &sweep : sweeps_)
+    {
+        qDebug().nospace() << QString::fromStdString(sweep.sourceId)
+                           << ": sweeps: " << sweep.engine->getSweeps()
+                           << ", hops: " << sweep.engine->getHops()
+                           << ", hops/s: " << sweep.engine->getHopsPerSecond();
+    }
+    for (const auto &analysis : analyses_)
+    {
+        qDebug().nospace() << QString::fromStdString(analysis.sourceId)
+                           << ": FFT frames: " << analysis.analyser->getFrames()
+                           << ", spectra: " << analysis.analyser->getSpectra()
+                           << ", restarts: " << analysis.analyser->getRestarts();
+    }
+}
+
+bool HeadlessRunner::saveSpectrum(const QString &path, double startFrequency,
+                                  double binWidth, const std::vector<float> &power)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        qDebug() << "Couldn't write " << path << ": " << file.errorString();
+        return false;
+    }
+
+    // Hz, dBFS
+    QTextStream out(&file);
+    for (auto i = 0U; i < power.size(); i++)
+    {
+        out << QString::number(startFrequency + i * binWidth, 'f', 0) << "," << power[i]
+            << "\n";
+    }
+    return true;
+}
@@ -0,0 +1,118 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "iq_recorder.hpp"
+#include "metrics_exporter.hpp"
+#include "source_manager.hpp"
+#include "spectrum_analyser.hpp"
+#include "sweep_engine.hpp"
+
+#include <QJsonObject>
+#include <QString>
+#include <QTimer>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#define HEADLESS_SIGNAL_POLL 100 // ms
+
+// Runs the sources of a config on a QCoreApplication, without creating any widget:
+//
+// {
+//   "duration": 0,        s, 0 runs until SIGINT or SIGTERM, or until every source has
+//                         finished (replays that don't loop)
+//   "stats_interval": 10, s, 0 for none
+//   "lock_memory": false, Keeps every page in RAM (mlockall)
+//   "metrics": {"port": 9464, "path": "aether.prom", "interval": 10}
+//                         Optional, served on localhost and/or written every interval s
+//   "trace": {"path": "trace.json", "events_per_thread": 65536}
+//                         Optional, a Chrome/Perfetto trace of the run, written on exit
+//   "sources": [{
+//     "id": "rx0",
+//     "type": "SoapySDR",  As registered in the factory
+//     "cpus": [2, 3],      Optional, pins all of the source's threads
+//     "scheduling": {"acquisition": {"cpus": [2], "policy": "fifo", "priority": 80},
+//                    "dispatch": {"cpus": [3], "policy": "rr", "priority": 60}}
+//                          Optional, policies are "default", "fifo" or "rr"
+//     "settings": {...},   See each source's `configure`
+//     "record": {"path": "/data/rx0", "max_file_bytes": 0, "max_file_seconds": 60,
+//                "direct_io": true, "channel": 0, "thread": {...}}    Optional
+//     "sweep": {"start": 88e6, "stop": 108e6, "fft_size": 1024, "averages": 8,
+//               "usable": 0.75, "dc_mask_bins": 2, "settle": 0.005, "channel": 0,
+//               "path": "sweep.csv", "thread": {...}}    Optional, the last sweep is
+//                                                        saved on exit
+//     "spectrum": {"fft_size": 2048, "window": "blackman_harris", "overlap": 0.5,
+//                  "averaging": "exponential", "averages": 16, "update_rate": 30,
+//                  "channel": 0, "path": "spectrum.csv", "thread": {...}}
+//                          Optional, on its own thread; the last spectrum is saved on
+//                          exit. Windows are "rectangular", "hann", "hamming",
+//                          "blackman_harris" or "flat_top"; averaging "none", "linear"
+//                          or "exponential"
+//   }]
+// }
+class HeadlessRunner
+{
+  public:
+    explicit HeadlessRunner(SourceManager *manager);
+    HeadlessRunner() = delete;
+    HeadlessRunner(const HeadlessRunner &) = delete;
+    HeadlessRunner &operator=(const HeadlessRunner &) = delete;
+    ~HeadlessRunner() = default;
+
+    // Adds and configures every source. False if any of them failed.
+    bool load(const QJsonObject &config);
+    // Starts everything and runs the event loop until done, then stops. Returns the
+    // exit code.
+    int exec();
+
+  private:
+    SourceManager *manager_;
+    double duration_;
+    double statsInterval_;
+    bool lockMemory_;
+
+    QJsonObject metricsConfig_;
+    MetricsExporter metrics_;
+    bool startMetrics();
+
+    QString tracePath_;
+    size_t traceEvents_;
+
+    struct Recording
+    {
+        std::shared_ptr<IqRecorder> recorder;
+        QString path;
+    };
+    std::vector<Recording> recordings_;
+
+    struct Sweep
+    {
+        std::shared_ptr<SweepEngine> engine;
+        std::string sourceId;
+        QString path;
+    };
+    std::vector<Sweep> sweeps_;
+
+    struct Analysis
+    {
+        std::shared_ptr<SpectrumAnalyser> analyser;
+        std::string sourceId;
+        QString path;
+    };
+    std::vector<Analysis> analyses_;
+
+    static bool saveSpectrum(const QString &path, double startFrequency, double binWidth,
+                             const std::vector<float> &power);
+
+    QTimer signalTimer_; // Polls for SIGINT, SIGTERM and finished sources
+    QTimer statsTimer_;
+    void printStatistics();
+};
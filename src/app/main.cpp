@@ -8,14 +8,25 @@
 
 #include "ISource.hpp"
 #include "ISourceListener.hpp"
+#include "file_replay_source.hpp"
+#include "headless_runner.hpp"
 #include "soapysdr_radio.hpp"
 #include "source_factory.hpp"
 #include "source_listeners_collection.hpp"
 #include "source_manager.hpp"
+#include "synthetic_source.hpp"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
 #include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 
 class BasicSourceListener : public ISourceListener,
@@ -38,9 +49,9 @@ class BasicSourceListener : public ISourceListener,
     {
         qDebug() << "Centre frequency changed to " << centreFrequency;
     };
-    void receiveSamples(std::vector<std::complex<float>> &samples) override
+    void receiveSamples(const SampleBlockPtr &block) override
     {
-        qDebug() << "Received " << samples.size() << " samples x " << counter_++;
+        qDebug() << "Received " << block->size() << " samples x " << counter_++;
     };
 
     std::shared_ptr<BasicSourceListener> getSharedPtr()
@@ -52,8 +63,154 @@ class BasicSourceListener : public ISourceListener,
     size_t counter_{0};
 };
 
+static SourceFactory makeSourceFactory()
+{
+    auto sourceFactory = SourceFactory();
+    /*
+     * Now register sources...
+     */
+    sourceFactory.registerSource("SoapySDR",
+                                []() { return std::make_unique<SoapySdrRadio>(); });
+    sourceFactory.registerSource("File replay",
+                                []() { return std::make_unique<FileReplaySource>(); });
+    sourceFactory.registerSource("Synthetic",
+                                []() { return std::make_unique<SyntheticSource>(); });
+    return sourceFactory;
+}
+
+// Decided before any Q*Application exists, as that's what differs
+static bool isHeadless(int argc, char *argv[])
+{
+    return std::any_of(argv + 1, argv + argc, [](const char *arg) {
+        return std::strcmp(arg, "--headless") == 0;
+    });
+}
+
+// `--set key=value` values: booleans, numbers, JSON arrays or else strings
+static QJsonValue parseSettingValue(const QString &text)
+{
+    if (text == "true" || text == "false")
+    {
+        return text == "true";
+    }
+    auto isNumber = false;
+    auto number = text.toDouble(&isNumber);
+    if (isNumber)
+    {
+        return number;
+    }
+    if (text.startsWith('['))
+    {
+        auto doc = QJsonDocument::fromJson(text.toUtf8());
+        if (doc.isArray())
+        {
+            return doc.array();
+        }
+    }
+    return text;
+}
+
+static int runHeadless(QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs sources and listeners without a GUI.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"headless", "Run without a GUI."},
+        {"config", "JSON config, see headless_runner.hpp.", "file"},
+        {"source", "Adds a source of this type, set up with --set and --record.", "type"},
+        {"set", "A setting of the --source source, repeatable.", "key=value"},
+        {"record", "Records the --source source to these files.", "path"},
+        {"duration", "Seconds to run for, 0 for until interrupted.", "seconds"},
+        {"stats", "Seconds between statistics, 0 for none.", "seconds"},
+        {"lock-memory", "Keep every page of the process in RAM."},
+        {"metrics-port", "Serves metrics on this localhost port.", "port"},
+        {"trace", "Writes a Chrome/Perfetto trace of the run here.", "file"},
+    });
+    parser.process(app);
+
+    QJsonObject config;
+    if (parser.isSet("config"))
+    {
+        QFile file(parser.value("config"));
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            qDebug() << "Couldn't open " << file.fileName() << ": " << file.errorString();
+            return 1;
+        }
+        QJsonParseError error{};
+        auto doc = QJsonDocument::fromJson(file.readAll(), &error);
+        if (!doc.isObject())
+        {
+            qDebug() << "Couldn't parse " << file.fileName() << ": "
+                     << error.errorString();
+            return 1;
+        }
+        config = doc.object();
+    }
+
+    // The command line adds to, or overrides, the file
+    if (parser.isSet("source"))
+    {
+        QJsonObject settings;
+        for (const auto &setting : parser.values("set"))
+        {
+            auto equals = setting.indexOf('=');
+            settings[setting.left(equals)] = parseSettingValue(setting.mid(equals + 1));
+        }
+        QJsonObject entry{
+            {"id", "cli"}, {"type", parser.value("source")}, {"settings", settings}};
+        if (parser.isSet("record"))
+        {
+            entry["record"] = QJsonObject{{"path", parser.value("record")}};
+        }
+        auto sources = config["sources"].toArray();
+        sources.append(entry);
+        config["sources"] = sources;
+    }
+    if (parser.isSet("duration"))
+    {
+        config["duration"] = parser.value("duration").toDouble();
+    }
+    if (parser.isSet("stats"))
+    {
+        config["stats_interval"] = parser.value("stats").toDouble();
+    }
+    if (parser.isSet("lock-memory"))
+    {
+        config["lock_memory"] = true;
+    }
+    if (parser.isSet("metrics-port"))
+    {
+        auto metrics = config["metrics"].toObject();
+        metrics["port"] = parser.value("metrics-port").toInt();
+        config["metrics"] = metrics;
+    }
+    if (parser.isSet("trace"))
+    {
+        auto trace = config["trace"].toObject();
+        trace["path"] = parser.value("trace");
+        config["trace"] = trace;
+    }
+
+    auto sourceManager = SourceManager(makeSourceFactory(), SourceListenersCollection());
+    auto runner = HeadlessRunner(&sourceManager);
+    if (!runner.load(config))
+    {
+        return 1;
+    }
+    return runner.exec();
+}
+
 int main(int argc, char *argv[])
 {
+    // No widget is ever created headless, not even the sources' ones
+    if (isHeadless(argc, argv))
+    {
+        QCoreApplication app(argc, argv);
+        return runHeadless(app);
+    }
+
     QApplication app(argc, argv);
 
     auto listenersCollection = SourceListenersCollection();
@@ -63,15 +220,8 @@ int main(int argc, char *argv[])
     auto basicListener = std::make_shared<BasicSourceListener>();
     listenersCollection.subscribe(basicListener->getSharedPtr());
 
-    auto sourceFactory = SourceFactory();
-    /*
-     * Now register sources...
-     */
-    sourceFactory.registerSource("SoapySDR",
-                                []() { return std::make_unique<SoapySdrRadio>(); });
-
     auto sourceManager =
-        SourceManager(std::move(sourceFactory), std::move(listenersCollection));
+        SourceManager(makeSourceFactory(), std::move(listenersCollection));
 
     // In the future this would be part of a larger main Window, of course...
     sourceManager.getWidget()->show();
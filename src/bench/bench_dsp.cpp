@@ -0,0 +1,182 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "bench_harness.hpp"
+
+#include "fft_plan_cache.hpp"
+#include "sample_block.hpp"
+#include "sample_conversion.hpp"
+#include "signal_generators.hpp"
+#include "spectrum_analyser.hpp"
+#include "spectrum_kernels.hpp"
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#define BENCH_BLOCK_SIZE 16384 // Samples, about one SoapySDR MTU
+#define BENCH_SAMPLE_RATE 20e6  // For what depends on it, the fastest we aim for
+
+void addConversionBenchmarks(BenchSuite &suite)
+{
+    struct Buffers
+    {
+        std::vector<int16_t> cs16;
+        std::vector<int8_t> cs8;
+        std::vector<std::complex<float>> cf32;
+        std::vector<std::complex<float>> out;
+    };
+    auto buffers = std::make_shared<Buffers>();
+    size_t count = BENCH_BLOCK_SIZE;
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> values(-128, 127);
+    for (size_t i = 0; i < 2 * count; i++)
+    {
+        auto value = values(random);
+        buffers->cs16.push_back(static_cast<int16_t>(value * 256));
+        buffers->cs8.push_back(static_cast<int8_t>(value));
+    }
+    buffers->cf32.resize(count);
+    buffers->out.resize(count);
+
+    auto name = [&](const char *format) {
+        return std::string("conversion/") + format + "_to_cf32/" + std::to_string(count);
+    };
+    suite.add({name("cs16"), count, [buffers, count]() {
+                   convertToCf32(SampleFormat::CS16, buffers->cs16.data(),
+                                 buffers->out.data(), count, 1.0F / 32768);
+                   doNotOptimize(buffers->out[0]);
+               }});
+    suite.add({name("cs8"), count, [buffers, count]() {
+                   convertToCf32(SampleFormat::CS8, buffers->cs8.data(),
+                                 buffers->out.data(), count, 1.0F / 128);
+                   doNotOptimize(buffers->out[0]);
+               }});
+    suite.add({name("cf32"), count, [buffers, count]() {
+                   convertToCf32(SampleFormat::CF32, buffers->cf32.data(),
+                                 buffers->out.data(), count, 1.0F);
+                   doNotOptimize(buffers->out[0]);
+               }});
+}
+
+void addFftBenchmarks(BenchSuite &suite)
+{
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    for (size_t size : {256, 1024, 4096, 16384, 65536})
+    {
+        // Planned up front, the first plan of a size takes a while
+        auto plan = FftPlanCache::shared().plan(size);
+        std::shared_ptr<FftPlanCache::Buffer> in =
+            std::make_shared<FftPlanCache::Buffer>(FftPlanCache::allocate(size));
+        std::shared_ptr<FftPlanCache::Buffer> out =
+            std::make_shared<FftPlanCache::Buffer>(FftPlanCache::allocate(size));
+        NoiseGenerator(1).generate(in->get(), size, 1.0F);
+
+        suite.add({"fft/forward/" + std::to_string(size), size, [plan, in, out]() {
+                       FftPlanCache::execute(plan, in->get(), out->get());
+                       doNotOptimize(out->get()[0]);
+                   }});
+    }
+}
+
+// The only sample-by-sample kernels in the tree; there are no filters yet
+void addGeneratorBenchmarks(BenchSuite &suite)
+{
+    size_t count = BENCH_BLOCK_SIZE;
+    auto out = std::make_shared<std::vector<std::complex<float>>>(count);
+    auto suffix = "/" + std::to_string(count);
+
+    auto tone = std::make_shared<ToneGenerator>();
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    tone->setTone(0.01);
+    suite.add({"generators/tone" + suffix, count, [tone, out, count]() {
+                   tone->generate(out->data(), count, 1.0F);
+                   doNotOptimize((*out)[0]);
+               }});
+    suite.add({"generators/mix" + suffix, count, [tone, out, count]() {
+                   tone->mix(out->data(), count);
+                   doNotOptimize((*out)[0]);
+               }});
+
+    auto noise = std::make_shared<NoiseGenerator>(1);
+    suite.add({"generators/noise" + suffix, count, [noise, out, count]() {
+                   noise->generate(out->data(), count, 1.0F);
+                   doNotOptimize((*out)[0]);
+               }});
+
+    auto fm = std::make_shared<FmGenerator>();
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    fm->configure(0.1, 0.02, 0.001);
+    suite.add({"generators/fm" + suffix, count, [fm, out, count]() {
+                   fm->generate(out->data(), count, 1.0F);
+                   doNotOptimize((*out)[0]);
+               }});
+}
+
+void addSpectrumBenchmarks(BenchSuite &suite)
+{
+    size_t size = SPECTRUM_FFT_SIZE;
+    struct Buffers
+    {
+        std::vector<std::complex<float>> bins;
+        std::vector<float> window;
+        std::vector<std::complex<float>> windowed;
+        std::vector<float> power;
+        std::vector<float> db;
+    };
+    auto buffers = std::make_shared<Buffers>();
+    buffers->bins.resize(size);
+    NoiseGenerator(1).generate(buffers->bins.data(), size, 1.0F);
+    buffers->window = makeWindow(WindowFunction::BlackmanHarris, size);
+    buffers->windowed.resize(size);
+    buffers->power.resize(size, 1.0F);
+    buffers->db.resize(size);
+
+    auto suffix = "/" + std::to_string(size);
+    suite.add({"spectrum/window" + suffix, size, [buffers, size]() {
+                   applyWindow(buffers->bins.data(), buffers->window.data(),
+                               buffers->windowed.data(), size);
+                   doNotOptimize(buffers->windowed[0]);
+               }});
+    suite.add({"spectrum/smooth_power" + suffix, size, [buffers, size]() {
+                   // NOLINTNEXTLINE(readability-magic-numbers)
+                   smoothPower(buffers->bins.data(), buffers->power.data(), size,
+                               0.0625F);
+                   doNotOptimize(buffers->power[0]);
+               }});
+    suite.add({"spectrum/power_to_db" + suffix, size, [buffers, size]() {
+                   powerToDb(buffers->power.data(), buffers->db.data(), size, 1.0F);
+                   doNotOptimize(buffers->db[0]);
+               }});
+
+    // The whole analyser on a stream: its Msamples/s is the fastest rate it keeps up with
+    auto pool = SampleBlockPool::make(1, BENCH_BLOCK_SIZE);
+    auto block = std::make_shared<SampleBlockPtr>(pool->acquire());
+    (*block)->setSize(BENCH_BLOCK_SIZE);
+    NoiseGenerator(1).generate((*block)->data(), BENCH_BLOCK_SIZE, 1.0F);
+    for (auto averaging : {SpectrumAveraging::None, SpectrumAveraging::Exponential})
+    {
+        SpectrumOptions options;
+        options.averaging = averaging;
+        auto analyser = std::make_shared<SpectrumAnalyser>(options);
+        analyser->setSampleRate(BENCH_SAMPLE_RATE);
+        auto name = std::string("spectrum/analyser/") +
+                    (averaging == SpectrumAveraging::None ? "none" : "exponential") +
+                    suffix;
+        suite.add({name, BENCH_BLOCK_SIZE, [analyser, block]() {
+                       // One continuous stream, or every block would start over
+                       auto next = (*block)->sampleIndex() + BENCH_BLOCK_SIZE;
+                       (*block)->setSampleIndex(next);
+                       analyser->receiveSamples(*block);
+                   }});
+    }
+}
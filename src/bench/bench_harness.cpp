@@ -0,0 +1,185 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "bench_harness.hpp"
+
+#include "thread_scheduling.hpp"
+
+#include <QDateTime>
+#include <QJsonArray>
+#include <QSysInfo>
+#include <QTextStream>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <utility>
+
+BenchSuite::BenchSuite(const BenchOptions &options) : options_(options)
+{
+}
+
+void BenchSuite::add(Benchmark benchmark)
+{
+    if (benchmark.name.find(options_.filter) != std::string::npos)
+    {
+        benchmarks_.push_back(std::move(benchmark));
+    }
+}
+
+std::vector<BenchResult> BenchSuite::runAll()
+{
+    if (!options_.cpus.empty())
+    {
+        ThreadProfile profile;
+        profile.cpus = options_.cpus;
+        applyThreadProfile(profile);
+    }
+
+    QTextStream out(stdout);
+    std::vector<BenchResult> results;
+    for (const auto &benchmark : benchmarks_)
+    {
+        results.push_back(measure(benchmark));
+        const auto &result = results.back();
+        out << QString("%1 %2 ns/item  %3 Mitems/s  [%4 .. %5]\n")
+                   .arg(QString::fromStdString(result.name), -40)
+                   .arg(result.nsPerItem, 10, 'f', 3)
+                   // NOLINTNEXTLINE(readability-magic-numbers)
+                   .arg(result.itemsPerSecond * 1e-6, 10, 'f', 2)
+                   .arg(result.minNsPerItem, 0, 'f', 3)
+                   .arg(result.maxNsPerItem, 0, 'f', 3);
+        out.flush();
+    }
+    return results;
+}
+
+BenchResult BenchSuite::measure(const Benchmark &benchmark) const
+{
+    using Clock = std::chrono::steady_clock;
+    auto time = [&](size_t iterations) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            benchmark.run();
+        }
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    // Warms the caches up and finds how many calls fill a repetition
+    size_t iterations = 1;
+    auto elapsed = time(iterations);
+    while (elapsed < options_.minTime)
+    {
+        // Aims a little past `minTime`, growing tenfold at most per step
+        // NOLINTNEXTLINE(readability-magic-numbers)
+        auto scale = elapsed > 0 ? std::min(options_.minTime / elapsed * 1.2, 10.0)
+                                 : 10.0; // NOLINT(readability-magic-numbers)
+        iterations = std::max(iterations + 1, static_cast<size_t>(iterations * scale));
+        elapsed = time(iterations);
+    }
+
+    std::vector<double> nsPerItem;
+    for (size_t rep = 0; rep < std::max<size_t>(options_.repetitions, 1); rep++)
+    {
+        // NOLINTNEXTLINE(readability-magic-numbers)
+        nsPerItem.push_back(time(iterations) * 1e9 /
+                            static_cast<double>(iterations * benchmark.items));
+    }
+    std::sort(nsPerItem.begin(), nsPerItem.end());
+
+    BenchResult result;
+    result.name = benchmark.name;
+    result.items = benchmark.items;
+    result.iterations = iterations;
+    result.nsPerItem = nsPerItem[nsPerItem.size() / 2];
+    result.minNsPerItem = nsPerItem.front();
+    result.maxNsPerItem = nsPerItem.back();
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    result.itemsPerSecond = result.nsPerItem > 0 ? 1e9 / result.nsPerItem : 0;
+    return result;
+}
+
+QJsonObject BenchSuite::context()
+{
+    QJsonObject context;
+    context["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    context["host"] = QSysInfo::machineHostName();
+    context["cpu_architecture"] = QSysInfo::currentCpuArchitecture();
+    context["os"] = QSysInfo::prettyProductName();
+    context["hardware_threads"] = static_cast<int>(std::thread::hardware_concurrency());
+    context["compiler"] = AETHER_BENCH_COMPILER;
+    context["build_type"] = AETHER_BENCH_BUILD_TYPE;
+    context["flags"] = AETHER_BENCH_FLAGS;
+    context["simd"] = AETHER_BENCH_SIMD;
+#if defined(__FAST_MATH__)
+    context["fast_math"] = true;
+#else
+    context["fast_math"] = false;
+#endif
+    return context;
+}
+
+QJsonObject BenchSuite::toJson(const std::vector<BenchResult> &results)
+{
+    QJsonArray benchmarks;
+    for (const auto &result : results)
+    {
+        benchmarks.append(QJsonObject{
+            {"name", QString::fromStdString(result.name)},
+            {"items", static_cast<double>(result.items)},
+            {"iterations", static_cast<double>(result.iterations)},
+            {"ns_per_item", result.nsPerItem},
+            {"min_ns_per_item", result.minNsPerItem},
+            {"max_ns_per_item", result.maxNsPerItem},
+            {"items_per_second", result.itemsPerSecond},
+        });
+    }
+    return QJsonObject{{"context", context()}, {"benchmarks", benchmarks}};
+}
+
+size_t BenchSuite::compare(const std::vector<BenchResult> &results,
+                           const QJsonObject &baseline, double tolerance)
+{
+    std::map<std::string, double> before;
+    for (const auto &value : baseline["benchmarks"].toArray())
+    {
+        auto benchmark = value.toObject();
+        before[benchmark["name"].toString().toStdString()] =
+            benchmark["ns_per_item"].toDouble();
+    }
+
+    QTextStream out(stdout);
+    auto flags = baseline["context"].toObject()["flags"].toString();
+    if (flags != AETHER_BENCH_FLAGS)
+    {
+        out << "Baseline built with other flags: " << flags << "\n";
+    }
+
+    size_t regressions = 0;
+    for (const auto &result : results)
+    {
+        auto pos = before.find(result.name);
+        if (pos == before.end() || pos->second <= 0)
+        {
+            continue;
+        }
+
+        auto change = result.nsPerItem / pos->second - 1;
+        auto regressed = change > tolerance;
+        regressions += regressed ? 1 : 0;
+        out << QString("%1 %2%3%")
+                   .arg(QString::fromStdString(result.name), -40)
+                   .arg(change >= 0 ? "+" : "")
+                   // NOLINTNEXTLINE(readability-magic-numbers)
+                   .arg(change * 100, 0, 'f', 1)
+            << (regressed ? "  REGRESSION" : "") << "\n";
+    }
+    return regressions;
+}
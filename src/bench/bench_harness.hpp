@@ -0,0 +1,94 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define BENCH_REPETITIONS 15
+#define BENCH_MIN_TIME 0.02  // s per repetition, the iterations are scaled up to it
+#define BENCH_TOLERANCE 0.05 // Slower than the baseline by more is a regression
+
+// Keeps the compiler from optimising away a result nobody reads
+template <typename T> inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+// One measurement: `run` handles `items` items (samples, blocks, messages...) per call.
+// Whatever `run` needs is set up before registering, so only `run` is timed.
+struct Benchmark
+{
+    std::string name; // group/kernel/size, e.g. "fft/forward/1024"
+    size_t items;
+    std::function<void()> run;
+};
+
+struct BenchResult
+{
+    std::string name;
+    size_t items{0};
+    size_t iterations{0}; // Calls of `run` per repetition
+    double nsPerItem{0};  // Median over the repetitions
+    double minNsPerItem{0};
+    double maxNsPerItem{0};
+    double itemsPerSecond{0}; // From the median
+};
+
+struct BenchOptions
+{
+    size_t repetitions{BENCH_REPETITIONS};
+    double minTime{BENCH_MIN_TIME};
+    std::string filter;    // Only benchmarks whose name contains it
+    std::vector<int> cpus; // Pins the benchmarking thread
+};
+
+// Runs benchmarks one after the other, on one (ideally pinned) thread. Every repetition
+// runs `run` enough times to take `minTime`, and the median repetition is reported, so
+// one-off hiccups don't move the numbers. Inputs are built from fixed seeds, so every run
+// measures the same work.
+class BenchSuite
+{
+  public:
+    explicit BenchSuite(const BenchOptions &options);
+
+    void add(Benchmark benchmark);
+    std::vector<BenchResult> runAll();
+
+    // The build and the machine, so results are only compared like for like
+    static QJsonObject context();
+    static QJsonObject toJson(const std::vector<BenchResult> &results);
+    // Prints the change from `baseline` for every benchmark in both, and returns how many
+    // got slower than `tolerance` allows
+    static size_t compare(const std::vector<BenchResult> &results,
+                          const QJsonObject &baseline, double tolerance);
+
+  private:
+    BenchOptions options_;
+    std::vector<Benchmark> benchmarks_;
+    BenchResult measure(const Benchmark &benchmark) const;
+};
+
+// Each group of benchmarks, in its own file
+void addConversionBenchmarks(BenchSuite &suite);
+void addFftBenchmarks(BenchSuite &suite);
+void addSpectrumBenchmarks(BenchSuite &suite);
+void addGeneratorBenchmarks(BenchSuite &suite);
+void addQueueBenchmarks(BenchSuite &suite);
+void addFanOutBenchmarks(BenchSuite &suite);
@@ -0,0 +1,92 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "bench_harness.hpp"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Microbenchmarks of the sample path and the DSP kernels. Build in Release and "
+        "pin to an idle CPU for numbers worth comparing.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"json", "Writes the results here.", "file"},
+        {"baseline", "Compares with these earlier results; exits with 1 on regressions.",
+         "file"},
+        {"tolerance", "Slowdown allowed over the baseline, e.g. 0.05 for 5%.", "ratio"},
+        {"filter", "Only runs benchmarks whose name contains this.", "text"},
+        {"repetitions", "Repetitions per benchmark, the median is kept.", "count"},
+        {"min-time", "Seconds per repetition.", "seconds"},
+        {"cpus", "Pins the benchmarks to these CPUs, e.g. 2 or 2,3.", "list"},
+    });
+    parser.process(app);
+
+    BenchOptions options;
+    options.filter = parser.value("filter").toStdString();
+    if (parser.isSet("repetitions"))
+    {
+        options.repetitions = parser.value("repetitions").toUInt();
+    }
+    if (parser.isSet("min-time"))
+    {
+        options.minTime = parser.value("min-time").toDouble();
+    }
+    for (const auto &cpu : parser.value("cpus").split(',', Qt::SkipEmptyParts))
+    {
+        options.cpus.push_back(cpu.toInt());
+    }
+
+    BenchSuite suite(options);
+    addConversionBenchmarks(suite);
+    addFftBenchmarks(suite);
+    addSpectrumBenchmarks(suite);
+    addGeneratorBenchmarks(suite);
+    addQueueBenchmarks(suite);
+    addFanOutBenchmarks(suite);
+    auto results = suite.runAll();
+
+    if (parser.isSet("json"))
+    {
+        QFile file(parser.value("json"));
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            qDebug() << "Couldn't write " << file.fileName() << ": "
+                     << file.errorString();
+            return 1;
+        }
+        file.write(QJsonDocument(BenchSuite::toJson(results)).toJson());
+    }
+
+    if (parser.isSet("baseline"))
+    {
+        QFile file(parser.value("baseline"));
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            qDebug() << "Couldn't open " << file.fileName() << ": "
+                     << file.errorString();
+            return 1;
+        }
+        auto tolerance = parser.isSet("tolerance") ? parser.value("tolerance").toDouble()
+                                                   : BENCH_TOLERANCE;
+        auto baseline = QJsonDocument::fromJson(file.readAll()).object();
+        if (BenchSuite::compare(results, baseline, tolerance) > 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
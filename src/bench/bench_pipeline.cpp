@@ -0,0 +1,172 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "bench_harness.hpp"
+
+#include "ISource.hpp"
+#include "ISourceListener.hpp"
+#include "control_mailbox.hpp"
+#include "queued_source_listener.hpp"
+#include "sample_block.hpp"
+#include "spsc_ring_buffer.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#define BENCH_BATCH 1024      // Items per call for the cheapest operations
+#define BENCH_POOL_BLOCKS 64  // As many as a source's pool
+#define BENCH_BLOCK_SAMPLES 16384
+
+namespace
+{
+
+// Does as little as a listener can, so only the dispatch is measured
+class NullListener : public ISourceListener
+{
+  public:
+    void setSampleRate(double /*sampleRate*/) override{};
+    void setCentreFrequency(double /*centreFrequency*/) override{};
+    void receiveSamples(const SampleBlockPtr &block) override
+    {
+        samples_ += block->size();
+        doNotOptimize(samples_);
+    };
+
+  private:
+    size_t samples_{0};
+};
+
+// Hands blocks to its listeners the way every source's stream thread does
+class DispatchSource : public ISource
+{
+  public:
+    void start() override{};
+    void stop() override{};
+    double getCentreFrequency() override
+    {
+        return 0;
+    };
+    void setCentreFrequency(double /*centreFrequency*/) override{};
+    double getSampleRate() override
+    {
+        return 0;
+    };
+    SourceStatistics getStatistics() override
+    {
+        return {};
+    };
+    QWidget *getWidget() override
+    {
+        return nullptr;
+    };
+
+    void dispatch(const SampleBlockPtr &block)
+    {
+        for (const auto &listener : listeners_)
+        {
+            listener->receiveSamples(block);
+        }
+    };
+};
+
+SampleBlockPtr makeBlock(const std::shared_ptr<SampleBlockPool> &pool)
+{
+    auto block = pool->acquire();
+    block->setSize(block->capacity());
+    return block;
+}
+
+} // namespace
+
+void addQueueBenchmarks(BenchSuite &suite)
+{
+    auto ring = std::make_shared<SpscRingBuffer<size_t>>(BENCH_POOL_BLOCKS);
+    suite.add({"queue/spsc_ring/write_read", BENCH_BATCH, [ring]() {
+                   for (size_t i = 0; i < BENCH_BATCH; i++)
+                   {
+                       *ring->writeSlot() = i;
+                       ring->commitWrite();
+                       doNotOptimize(*ring->readSlot());
+                       ring->commitRead();
+                   }
+               }});
+
+    auto mailbox = std::make_shared<ControlMailbox<double>>(BENCH_POOL_BLOCKS);
+    suite.add({"queue/control_mailbox/post_take", BENCH_POOL_BLOCKS, [mailbox]() {
+                   for (size_t i = 0; i < BENCH_POOL_BLOCKS; i++)
+                   {
+                       mailbox->post(static_cast<double>(i));
+                   }
+                   double value = 0;
+                   while (mailbox->take(value))
+                   {
+                       doNotOptimize(value);
+                   }
+               }});
+
+    auto pool = SampleBlockPool::make(BENCH_POOL_BLOCKS, BENCH_BLOCK_SAMPLES);
+    auto held = std::make_shared<std::vector<SampleBlockPtr>>(BENCH_POOL_BLOCKS);
+    suite.add({"queue/block_pool/acquire_release", BENCH_POOL_BLOCKS, [pool, held]() {
+                   for (auto &block : *held)
+                   {
+                       block = pool->acquire();
+                   }
+                   for (auto &block : *held)
+                   {
+                       block = SampleBlockPtr();
+                   }
+               }});
+
+    // To another thread and back: the queue, its locks and the wake-ups
+    for (auto policy : {BackpressurePolicy::Block, BackpressurePolicy::DropOldest})
+    {
+        SubscriptionOptions options;
+        options.dedicatedThread = true;
+        options.policy = policy;
+        auto queued = std::make_shared<QueuedSourceListener>(
+            std::make_shared<NullListener>(), options);
+        auto block = std::make_shared<SampleBlockPtr>(makeBlock(pool));
+        auto name = std::string("queue/queued_listener/") +
+                    (policy == BackpressurePolicy::Block ? "block" : "drop_oldest");
+        suite.add({name, BENCH_POOL_BLOCKS, [queued, block]() {
+                       for (size_t i = 0; i < BENCH_POOL_BLOCKS; i++)
+                       {
+                           queued->receiveSamples(*block);
+                       }
+                   }});
+    }
+}
+
+void addFanOutBenchmarks(BenchSuite &suite)
+{
+    auto pool = SampleBlockPool::make(1, BENCH_BLOCK_SAMPLES);
+    auto block = std::make_shared<SampleBlockPtr>(makeBlock(pool));
+
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    for (size_t count : {1, 4, 16})
+    {
+        auto listeners = std::make_shared<std::vector<std::unique_ptr<NullListener>>>();
+        std::vector<ISourceListener *> pointers;
+        for (size_t i = 0; i < count; i++)
+        {
+            listeners->push_back(std::make_unique<NullListener>());
+            pointers.push_back(listeners->back().get());
+        }
+
+        auto source = std::make_shared<DispatchSource>();
+        source->setListeners(pointers);
+        suite.add({"fanout/inline/" + std::to_string(count), BENCH_BATCH,
+                   [source, listeners, block]() {
+                       for (size_t i = 0; i < BENCH_BATCH; i++)
+                       {
+                           source->dispatch(*block);
+                       }
+                   }});
+    }
+}
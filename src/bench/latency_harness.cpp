@@ -0,0 +1,297 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "latency_harness.hpp"
+
+#include "bench_harness.hpp"
+#include "iq_recorder.hpp"
+#include "queued_source_listener.hpp"
+#include "soapysdr_radio.hpp"
+#include "spectrum_analyser.hpp"
+#include "synthetic_source.hpp"
+
+#include <QDebug>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <utility>
+#include <vector>
+
+LatencyProbe::LatencyProbe(std::shared_ptr<LatencyRecorder> latency,
+                           std::shared_ptr<ISourceListener> sink)
+    : latency_(std::move(latency)), sink_(std::move(sink))
+{
+}
+
+void LatencyProbe::setSampleRate(double sampleRate)
+{
+    if (sink_ != nullptr)
+    {
+        sink_->setSampleRate(sampleRate);
+    }
+}
+
+void LatencyProbe::setCentreFrequency(double centreFrequency)
+{
+    if (sink_ != nullptr)
+    {
+        sink_->setCentreFrequency(centreFrequency);
+    }
+}
+
+void LatencyProbe::receiveSamples(const SampleBlockPtr &block)
+{
+    if (sink_ != nullptr)
+    {
+        sink_->receiveSamples(block);
+    }
+    latency_->recordSince(block->readNs());
+}
+
+namespace
+{
+
+// What the audio sink will do with a block: an FM demodulator decimating to audio rate.
+// The tree has no audio sink yet.
+class AudioModel : public ISourceListener
+{
+  public:
+    void setSampleRate(double sampleRate) override
+    {
+        // NOLINTNEXTLINE(readability-magic-numbers)
+        auto decimation = std::lround(sampleRate / LATENCY_AUDIO_RATE);
+        decimation_ = std::max<size_t>(static_cast<size_t>(decimation), 1);
+    };
+    void setCentreFrequency(double /*centreFrequency*/) override{};
+    void receiveSamples(const SampleBlockPtr &block) override
+    {
+        audio_.clear();
+        for (const auto &sample : *block)
+        {
+            sum_ += std::arg(sample * std::conj(previous_));
+            previous_ = sample;
+            if (++summed_ == decimation_)
+            {
+                audio_.push_back(sum_ / static_cast<float>(decimation_));
+                sum_ = 0;
+                summed_ = 0;
+            }
+        }
+        doNotOptimize(audio_.data());
+    };
+
+  private:
+    size_t decimation_{1};
+    std::complex<float> previous_;
+    float sum_{0};
+    size_t summed_{0};
+    std::vector<float> audio_;
+};
+
+} // namespace
+
+static std::unique_ptr<ISource> makeSource(const LatencyRunOptions &options)
+{
+    std::unique_ptr<ISource> source;
+    QJsonObject settings{{"sample_rate", options.sampleRate}};
+    if (options.source == "synthetic")
+    {
+        source = std::make_unique<SyntheticSource>();
+        settings["block_size"] = static_cast<double>(options.blockSize);
+        settings["pacing"] = "real_time";
+    }
+    else if (options.source == "soapysdr")
+    {
+        // The fake device reads one MTU at a time, which is the block size
+        source = std::make_unique<SoapySdrRadio>();
+        auto device = QString("driver=fake,mtu=%1,rate=%2")
+                          .arg(options.blockSize)
+                          .arg(options.sampleRate, 0, 'f', 0);
+        if (!options.soapyArgs.empty())
+        {
+            device += "," + QString::fromStdString(options.soapyArgs);
+        }
+        settings["device"] = device;
+    }
+    else
+    {
+        qDebug() << "Unknown source: " << QString::fromStdString(options.source);
+        return nullptr;
+    }
+
+    if (!source->configure(settings))
+    {
+        qDebug() << "Couldn't set up the source.";
+        return nullptr;
+    }
+    if (!options.cpus.empty())
+    {
+        source->setCpuAffinity(options.cpus);
+    }
+    return source;
+}
+
+LatencyRun runLatency(const LatencyRunOptions &options)
+{
+    LatencyRun run;
+    run.options = options;
+
+    auto source = makeSource(options);
+    QTemporaryDir directory;
+    if (source == nullptr || !directory.isValid())
+    {
+        return run;
+    }
+
+    auto dispatch = std::make_shared<LatencyRecorder>();
+    auto display = std::make_shared<LatencyRecorder>();
+    auto audio = std::make_shared<LatencyRecorder>();
+    auto recorded = std::make_shared<LatencyRecorder>();
+
+    auto dispatchProbe = std::make_shared<LatencyProbe>(dispatch);
+
+    SubscriptionOptions displayOptions;
+    displayOptions.dedicatedThread = true;
+    displayOptions.policy = BackpressurePolicy::DropOldest;
+    displayOptions.queueDepth = LATENCY_DISPLAY_QUEUE;
+    auto displayQueue = std::make_shared<QueuedSourceListener>(
+        std::make_shared<LatencyProbe>(display, std::make_shared<SpectrumAnalyser>()),
+        displayOptions);
+
+    SubscriptionOptions audioOptions;
+    audioOptions.dedicatedThread = true;
+    audioOptions.policy = BackpressurePolicy::Block;
+    audioOptions.queueDepth = LATENCY_AUDIO_QUEUE;
+    auto audioQueue = std::make_shared<QueuedSourceListener>(
+        std::make_shared<LatencyProbe>(audio, std::make_shared<AudioModel>()),
+        audioOptions);
+
+    // Smaller batches than by default, or filling one would be most of the latency
+    IqRecorderOptions recorderOptions;
+    recorderOptions.batchBytes = LATENCY_RECORDER_BATCH_BYTES;
+    recorderOptions.writeLatency = recorded;
+    auto recorder = std::make_shared<IqRecorder>(recorderOptions);
+
+    source->setListeners(
+        {dispatchProbe.get(), displayQueue.get(), audioQueue.get(), recorder.get()});
+
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    auto warmup = static_cast<long long>(options.warmup * 1e9);
+    auto measureFrom = LatencyRecorder::now() + warmup;
+    for (const auto &latency : {dispatch, display, audio, recorded})
+    {
+        latency->keepFrom(measureFrom);
+    }
+
+    if (!recorder->startRecording(directory.filePath("latency")))
+    {
+        return run;
+    }
+    source->start();
+
+    QEventLoop loop;
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    auto runMs = static_cast<int>((options.warmup + options.duration) * 1000);
+    QTimer::singleShot(runMs, &loop, &QEventLoop::quit);
+    loop.exec();
+
+    source->stop();
+    source->setListeners({});
+    recorder->stopRecording();
+
+    run.stages = {
+        {"dispatch", dispatch->summarize(), 0},
+        {"display", display->summarize(), displayQueue->getDroppedBlocks()},
+        {"audio", audio->summarize(), audioQueue->getDroppedBlocks()},
+        {"recorder", recorded->summarize(),
+         static_cast<size_t>(recorder->getDroppedSamples())},
+    };
+    run.ok = run.stages.front().summary.count > 0;
+    if (!run.ok)
+    {
+        qDebug() << "No samples came through.";
+    }
+    return run;
+}
+
+void printLatency(const LatencyRun &run)
+{
+    QTextStream out(stdout);
+    out << QString("%1 %2 Msps, %3 samples per block%4\n")
+               .arg(QString::fromStdString(run.options.source))
+               // NOLINTNEXTLINE(readability-magic-numbers)
+               .arg(run.options.sampleRate * 1e-6, 0, 'f', 3)
+               .arg(run.options.blockSize)
+               .arg(run.ok ? "" : " FAILED");
+    out << QString("  %1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+               .arg("stage (us)", -10)
+               .arg("count", 9)
+               .arg("min", 9)
+               .arg("p50", 9)
+               .arg("p90", 9)
+               .arg("p99", 9)
+               .arg("p99.9", 9)
+               .arg("max", 9)
+               .arg("dropped", 9);
+    for (const auto &stage : run.stages)
+    {
+        const auto &summary = stage.summary;
+        out << QString("  %1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+                   .arg(QString::fromStdString(stage.name), -10)
+                   .arg(summary.count, 9)
+                   .arg(summary.min, 9, 'f', 1)
+                   .arg(summary.p50, 9, 'f', 1)
+                   .arg(summary.p90, 9, 'f', 1)
+                   .arg(summary.p99, 9, 'f', 1)
+                   .arg(summary.p999, 9, 'f', 1)
+                   .arg(summary.max, 9, 'f', 1)
+                   .arg(stage.dropped, 9);
+    }
+    out.flush();
+}
+
+QJsonObject latencyToJson(const std::vector<LatencyRun> &runs)
+{
+    QJsonArray array;
+    for (const auto &run : runs)
+    {
+        QJsonArray stages;
+        for (const auto &stage : run.stages)
+        {
+            const auto &summary = stage.summary;
+            stages.append(QJsonObject{
+                {"name", QString::fromStdString(stage.name)},
+                {"count", static_cast<double>(summary.count)},
+                {"missed", static_cast<double>(summary.missed)},
+                {"dropped", static_cast<double>(stage.dropped)},
+                {"min_us", summary.min},
+                {"mean_us", summary.mean},
+                {"p50_us", summary.p50},
+                {"p90_us", summary.p90},
+                {"p99_us", summary.p99},
+                {"p999_us", summary.p999},
+                {"max_us", summary.max},
+            });
+        }
+        array.append(QJsonObject{
+            {"source", QString::fromStdString(run.options.source)},
+            {"sample_rate", run.options.sampleRate},
+            {"block_size", static_cast<double>(run.options.blockSize)},
+            {"duration", run.options.duration},
+            {"ok", run.ok},
+            {"stages", stages},
+        });
+    }
+    return QJsonObject{{"context", BenchSuite::context()}, {"runs", array}};
+}
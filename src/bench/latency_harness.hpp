@@ -0,0 +1,79 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "ISourceListener.hpp"
+#include "latency_recorder.hpp"
+#include "sample_block.hpp"
+
+#include <QJsonObject>
+#include <QString>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define LATENCY_DURATION 5.0 // s measured per run
+#define LATENCY_WARMUP 0.5   // s before measuring, while pools and caches warm up
+#define LATENCY_DISPLAY_QUEUE 4
+#define LATENCY_AUDIO_RATE 48000.0
+#define LATENCY_AUDIO_QUEUE 8
+#define LATENCY_RECORDER_BATCH_BYTES (256 * 1024)
+
+// Passes every block on to `sink`, if any, then notes how long it's been since the
+// block's samples were read
+class LatencyProbe : public ISourceListener
+{
+  public:
+    explicit LatencyProbe(std::shared_ptr<LatencyRecorder> latency,
+                          std::shared_ptr<ISourceListener> sink = nullptr);
+
+    void setSampleRate(double sampleRate) override;
+    void setCentreFrequency(double centreFrequency) override;
+    void receiveSamples(const SampleBlockPtr &block) override;
+
+  private:
+    std::shared_ptr<LatencyRecorder> latency_;
+    std::shared_ptr<ISourceListener> sink_;
+};
+
+struct LatencyRunOptions
+{
+    std::string source{"synthetic"}; // Or "soapysdr", for the fake device
+    std::string soapyArgs;           // Appended to the fake device's, e.g. "jitter=50"
+    size_t blockSize{0};
+    double sampleRate{0};
+    double duration{LATENCY_DURATION};
+    double warmup{LATENCY_WARMUP};
+    std::vector<int> cpus; // Of the source's threads
+};
+
+struct LatencyStage
+{
+    std::string name;
+    LatencySummary summary;
+    size_t dropped{0}; // Blocks by the stage's queue, samples by the recorder
+};
+
+struct LatencyRun
+{
+    LatencyRunOptions options;
+    bool ok{false};
+    std::vector<LatencyStage> stages;
+};
+
+// Streams from one source for a while, into a probe for every kind of sink, and measures
+// the latency from `readStream` to each: "dispatch" (inline on the source's thread, no
+// work), "display" (a `SpectrumAnalyser` on its own thread, drops the oldest), "audio"
+// (an FM demodulator on its own thread, never drops) and "recorder" (until the batch is
+// on disk).
+LatencyRun runLatency(const LatencyRunOptions &options);
+void printLatency(const LatencyRun &run);
+QJsonObject latencyToJson(const std::vector<LatencyRun> &runs);
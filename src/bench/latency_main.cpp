@@ -0,0 +1,93 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "latency_harness.hpp"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+
+#include <algorithm>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Measures the latency from reading samples to each kind of sink, for every block "
+        "size and sample rate given. Set AETHER_SOAPY_LIBRARY to the fake SoapySDR "
+        "library for the soapysdr source.");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"sources", "synthetic and/or soapysdr, e.g. synthetic,soapysdr.", "list"},
+        {"block-sizes", "Samples per block, e.g. 1024,16384.", "list"},
+        {"sample-rates", "In samples per second, e.g. 2e6,20e6.", "list"},
+        {"duration", "Seconds measured per run.", "seconds"},
+        {"warmup", "Seconds before measuring, per run.", "seconds"},
+        {"soapy-args", "Added to the fake device's arguments, e.g. jitter=50.", "args"},
+        {"cpus", "Pins the source's threads to these CPUs, e.g. 2 or 2,3.", "list"},
+        {"json", "Writes the results here.", "file"},
+    });
+    parser.process(app);
+
+    auto list = [&](const QString &name, const QString &fallback) {
+        auto value = parser.isSet(name) ? parser.value(name) : fallback;
+        return value.split(',', Qt::SkipEmptyParts);
+    };
+
+    LatencyRunOptions base;
+    if (parser.isSet("duration"))
+    {
+        base.duration = parser.value("duration").toDouble();
+    }
+    if (parser.isSet("warmup"))
+    {
+        base.warmup = parser.value("warmup").toDouble();
+    }
+    base.soapyArgs = parser.value("soapy-args").toStdString();
+    for (const auto &cpu : list("cpus", ""))
+    {
+        base.cpus.push_back(cpu.toInt());
+    }
+
+    std::vector<LatencyRun> runs;
+    for (const auto &source : list("sources", "synthetic"))
+    {
+        for (const auto &blockSize : list("block-sizes", "1024,4096,16384"))
+        {
+            for (const auto &sampleRate : list("sample-rates", "2e6,10e6,20e6"))
+            {
+                auto options = base;
+                options.source = source.toStdString();
+                options.blockSize = blockSize.toULongLong();
+                options.sampleRate = sampleRate.toDouble();
+                runs.push_back(runLatency(options));
+                printLatency(runs.back());
+            }
+        }
+    }
+
+    if (parser.isSet("json"))
+    {
+        QFile file(parser.value("json"));
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            qDebug() << "Couldn't write " << file.fileName() << ": "
+                     << file.errorString();
+            return 1;
+        }
+        file.write(QJsonDocument(latencyToJson(runs)).toJson());
+    }
+
+    auto failed = std::any_of(runs.begin(), runs.end(),
+                              [](const LatencyRun &run) { return !run.ok; });
+    return failed ? 1 : 0;
+}
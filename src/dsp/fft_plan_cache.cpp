@@ -0,0 +1,70 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "fft_plan_cache.hpp"
+
+#include <algorithm>
+
+// std::complex<float> is layout compatible with fftwf_complex
+static fftwf_complex *asFftw(std::complex<float> *data)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return reinterpret_cast<fftwf_complex *>(data);
+}
+
+FftPlanCache::~FftPlanCache()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &plan : plans_)
+    {
+        fftwf_destroy_plan(plan.second);
+    }
+}
+
+FftPlanCache &FftPlanCache::shared()
+{
+    static FftPlanCache cache;
+    return cache;
+}
+
+void FftPlanCache::FftwDelete::operator()(std::complex<float> *data) const
+{
+    fftwf_free(data);
+}
+
+FftPlanCache::Buffer FftPlanCache::allocate(size_t size)
+{
+    auto *data = static_cast<std::complex<float> *>(
+        fftwf_malloc(sizeof(std::complex<float>) * size));
+    std::fill(data, data + size, std::complex<float>());
+    return Buffer(data);
+}
+
+fftwf_plan FftPlanCache::plan(size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = plans_.find(size);
+    if (it != plans_.end())
+    {
+        return it->second;
+    }
+
+    // FFTW_MEASURE scribbles over the buffers, so plan on scratch ones
+    auto in = allocate(size);
+    auto out = allocate(size);
+    auto *plan = fftwf_plan_dft_1d(static_cast<int>(size), asFftw(in.get()),
+                                   asFftw(out.get()), FFTW_FORWARD, FFTW_MEASURE);
+    plans_[size] = plan;
+    return plan;
+}
+
+void FftPlanCache::execute(fftwf_plan plan, std::complex<float> *in,
+                           std::complex<float> *out)
+{
+    fftwf_execute_dft(plan, asFftw(in), asFftw(out));
+}
@@ -0,0 +1,47 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <fftw3.h>
+
+#include <complex>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// FFTW's planner is slow and not thread safe, while executing a plan is cheap and is.
+// Plans are made once per size (FFTW_MEASURE) and shared by the whole process; run them
+// with `execute` on buffers from `allocate`, so their alignment matches the plan's.
+class FftPlanCache
+{
+  public:
+    FftPlanCache() = default;
+    ~FftPlanCache();
+    FftPlanCache(const FftPlanCache &) = delete;
+    FftPlanCache &operator=(const FftPlanCache &) = delete;
+
+    static FftPlanCache &shared();
+
+    struct FftwDelete
+    {
+        void operator()(std::complex<float> *data) const;
+    };
+    using Buffer = std::unique_ptr<std::complex<float>[], FftwDelete>;
+    static Buffer allocate(size_t size);
+
+    // Forward and out of place. The first call for a size plans it, which takes a while.
+    fftwf_plan plan(size_t size);
+    static void execute(fftwf_plan plan, std::complex<float> *in,
+                        std::complex<float> *out);
+
+  private:
+    std::mutex mutex_;
+    std::map<size_t, fftwf_plan> plans_;
+};
@@ -0,0 +1,98 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "sample_conversion.hpp"
+
+#include <xsimd/xsimd.hpp>
+
+#include <algorithm>
+
+using FloatBatch = xsimd::simd_type<float>;
+
+// I and Q are converted alike, so the complex samples are handled as a flat array of
+// 2 * count scalars.
+template <typename T>
+static void convertInterleaved(const T *in, float *out, size_t count, float scale)
+{
+    const FloatBatch scaleBatch(scale);
+
+    size_t i = 0;
+    for (; i + FloatBatch::size <= count; i += FloatBatch::size)
+    {
+        FloatBatch values;
+        values.load_unaligned(in + i);
+        (values * scaleBatch).store_unaligned(out + i);
+    }
+    for (; i < count; i++)
+    {
+        out[i] = static_cast<float>(in[i]) * scale;
+    }
+}
+
+size_t bytesPerSample(SampleFormat format)
+{
+    switch (format)
+    {
+    case SampleFormat::CF32:
+        return 2 * sizeof(float);
+    case SampleFormat::CS16:
+        return 2 * sizeof(int16_t);
+    case SampleFormat::CS8:
+        return 2 * sizeof(int8_t);
+    }
+    return 0;
+}
+
+double defaultFullScale(SampleFormat format)
+{
+    switch (format)
+    {
+    case SampleFormat::CF32:
+        return 1.0;
+    case SampleFormat::CS16:
+        return 32768.0; // NOLINT(readability-magic-numbers)
+    case SampleFormat::CS8:
+        return 128.0; // NOLINT(readability-magic-numbers)
+    }
+    return 1.0;
+}
+
+void convertCs16ToCf32(const int16_t *in, std::complex<float> *out, size_t count,
+                       float scale)
+{
+    convertInterleaved(in, reinterpret_cast<float *>(out), 2 * count, scale);
+}
+
+void convertCs8ToCf32(const int8_t *in, std::complex<float> *out, size_t count,
+                      float scale)
+{
+    convertInterleaved(in, reinterpret_cast<float *>(out), 2 * count, scale);
+}
+
+void convertToCf32(SampleFormat format, const void *in, std::complex<float> *out,
+                   size_t count, float scale)
+{
+    switch (format)
+    {
+    case SampleFormat::CF32:
+        if (scale == 1.0F)
+        {
+            std::copy_n(static_cast<const std::complex<float> *>(in), count, out);
+            break;
+        }
+        convertInterleaved(static_cast<const float *>(in), reinterpret_cast<float *>(out),
+                           2 * count, scale);
+        break;
+    case SampleFormat::CS16:
+        convertCs16ToCf32(static_cast<const int16_t *>(in), out, count, scale);
+        break;
+    case SampleFormat::CS8:
+        convertCs8ToCf32(static_cast<const int8_t *>(in), out, count, scale);
+        break;
+    }
+}
@@ -0,0 +1,37 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+// Wire formats of interleaved I/Q samples
+enum class SampleFormat
+{
+    CF32,
+    CS16,
+    CS8
+};
+
+size_t bytesPerSample(SampleFormat format);
+
+// Full scale of the integer formats, used when the device doesn't report one
+double defaultFullScale(SampleFormat format);
+
+// Vectorised conversions to CF32. Every output value is `input * scale`, so pass
+// `1 / fullScale` to normalise to [-1, 1]. `count` is in complex samples.
+void convertCs16ToCf32(const int16_t *in, std::complex<float> *out, size_t count,
+                       float scale);
+void convertCs8ToCf32(const int8_t *in, std::complex<float> *out, size_t count,
+                      float scale);
+
+// Dispatches on `format`. For CF32 the samples are copied (and scaled if needed).
+void convertToCf32(SampleFormat format, const void *in, std::complex<float> *out,
+                   size_t count, float scale);
@@ -0,0 +1,331 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "signal_generators.hpp"
+
+#include <xsimd/xsimd.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using FloatBatch = xsimd::simd_type<float>;
+using ComplexBatch = xsimd::simd_type<std::complex<float>>;
+
+static constexpr size_t lanes = FloatBatch::size;
+
+// The vectorised loops run in float; restarting them from the exact (double) state every
+// chunk keeps the accumulated error far below the float noise floor.
+static constexpr size_t chunkSamples = 1024;
+
+static constexpr double twoPi = 6.283185307179586;
+static constexpr float uniformScale = 1.0F / 16777216.0F; // 2^-24
+
+static uint32_t mixSeed(uint32_t seed, uint32_t lane)
+{
+    // splitmix32-style scrambling, so neighbouring seeds and lanes are unrelated
+    uint32_t x = seed + (lane + 1) * 0x9E3779B9U; // NOLINT(readability-magic-numbers)
+    x = (x ^ (x >> 16U)) * 0x85EBCA6BU;           // NOLINT(readability-magic-numbers)
+    x = (x ^ (x >> 13U)) * 0xC2B2AE35U;           // NOLINT(readability-magic-numbers)
+    x ^= x >> 16U;                                // NOLINT(readability-magic-numbers)
+    return x != 0 ? x : 1;
+}
+
+static uint32_t xorshift32(uint32_t &state)
+{
+    state ^= state << 13U; // NOLINT(readability-magic-numbers)
+    state ^= state >> 17U; // NOLINT(readability-magic-numbers)
+    state ^= state << 5U;  // NOLINT(readability-magic-numbers)
+    return state;
+}
+
+// Tone ----------------------------------------------------------------------------------
+
+void ToneGenerator::setTone(double frequency)
+{
+    setSweep(frequency, frequency, 0);
+}
+
+void ToneGenerator::setSweep(double startFrequency, double endFrequency,
+                             double sweepSamples)
+{
+    startIncrement_ = twoPi * startFrequency;
+    endIncrement_ = twoPi * endFrequency;
+    step_ = sweepSamples > 0 ? (endIncrement_ - startIncrement_) / sweepSamples : 0;
+    increment_ = startIncrement_;
+}
+
+void ToneGenerator::reset()
+{
+    phase_ = 0;
+    increment_ = startIncrement_;
+}
+
+void ToneGenerator::generate(std::complex<float> *out, size_t count, float amplitude)
+{
+    run(out, count, amplitude, false);
+}
+
+void ToneGenerator::mix(std::complex<float> *data, size_t count)
+{
+    run(data, count, 1.0F, true);
+}
+
+void ToneGenerator::run(std::complex<float> *data, size_t count, float amplitude,
+                        bool mix)
+{
+    // phase(n) = phase + increment * n + step * n^2 / 2
+    auto phaseAt = [&](double n) { return phase_ + increment_ * n + step_ * n * n / 2; };
+
+    while (count > 0)
+    {
+        auto n = std::min(count, chunkSamples);
+
+        // A sweep jumps back to its start, which mustn't happen inside a chunk
+        if (step_ != 0)
+        {
+            auto left = std::ceil((endIncrement_ - increment_) / step_);
+            n = std::min(n, static_cast<size_t>(std::max(left, 1.0)));
+        }
+
+        // Lane k starts at sample k and moves `lanes` samples on per step. Its rotation
+        // per step grows by `step * lanes^2` every step (nothing for a tone).
+        std::complex<float> start[lanes];    // NOLINT(modernize-avoid-c-arrays)
+        std::complex<float> rotation[lanes]; // NOLINT(modernize-avoid-c-arrays)
+        for (auto k = 0U; k < lanes; k++)
+        {
+            start[k] = std::polar(static_cast<double>(amplitude), phaseAt(k));
+            rotation[k] = std::polar(1.0, phaseAt(k + lanes) - phaseAt(k));
+        }
+        auto growth = std::polar(1.0, step_ * lanes * lanes);
+
+        ComplexBatch value;
+        ComplexBatch step;
+        value.load_unaligned(start);
+        step.load_unaligned(rotation);
+        const ComplexBatch grow(FloatBatch(static_cast<float>(growth.real())),
+                                FloatBatch(static_cast<float>(growth.imag())));
+        const auto sweeping = step_ != 0;
+
+        size_t i = 0;
+        for (; i + lanes <= n; i += lanes)
+        {
+            if (mix)
+            {
+                ComplexBatch samples;
+                samples.load_unaligned(data + i);
+                (samples * value).store_unaligned(data + i);
+            }
+            else
+            {
+                value.store_unaligned(data + i);
+            }
+            value = value * step;
+            if (sweeping)
+            {
+                step = step * grow;
+            }
+        }
+        for (; i < n; i++)
+        {
+            auto exact = std::polar(static_cast<double>(amplitude), phaseAt(i));
+            auto sample = std::complex<float>(exact);
+            data[i] = mix ? data[i] * sample : sample;
+        }
+
+        phase_ = std::fmod(phaseAt(n), twoPi);
+        increment_ += step_ * n;
+        if ((step_ > 0 && increment_ >= endIncrement_) ||
+            (step_ < 0 && increment_ <= endIncrement_))
+        {
+            increment_ = startIncrement_;
+        }
+
+        data += n;
+        count -= n;
+    }
+}
+
+// Noise ---------------------------------------------------------------------------------
+
+NoiseGenerator::NoiseGenerator(uint32_t seed)
+    : state_(lanes), uniforms_(2 * chunkSamples)
+{
+    this->seed(seed);
+}
+
+void NoiseGenerator::seed(uint32_t seed)
+{
+    for (auto k = 0U; k < lanes; k++)
+    {
+        state_[k] = mixSeed(seed, k);
+    }
+}
+
+void NoiseGenerator::generate(std::complex<float> *out, size_t count, float rms)
+{
+    run(out, count, rms, false);
+}
+
+void NoiseGenerator::add(std::complex<float> *data, size_t count, float rms)
+{
+    run(data, count, rms, true);
+}
+
+void NoiseGenerator::run(std::complex<float> *data, size_t count, float rms, bool add)
+{
+    // Half of the power goes to I and half to Q
+    const FloatBatch sigma(rms / std::sqrt(2.0F));
+    const FloatBatch minusTwo(-2.0F);
+    const FloatBatch twoPiBatch(static_cast<float>(twoPi));
+    auto *u1 = uniforms_.data();
+
+    while (count > 0)
+    {
+        auto n = std::min(count, chunkSamples);
+
+        // Uniforms in (0, 1], 24 bits each. One generator per lane, so the compiler can
+        // vectorise this.
+        auto padded = (n + lanes - 1) / lanes * lanes;
+        auto *u2 = u1 + padded;
+        for (size_t j = 0; j < 2 * padded; j += lanes)
+        {
+            for (auto k = 0U; k < lanes; k++)
+            {
+                // NOLINTNEXTLINE(readability-magic-numbers)
+                auto bits = xorshift32(state_[k]) >> 8U;
+                uniforms_[j + k] = static_cast<float>(bits + 1) * uniformScale;
+            }
+        }
+
+        // Box-Muller: every pair of uniforms gives an I and a Q
+        size_t i = 0;
+        for (; i + lanes <= n; i += lanes)
+        {
+            FloatBatch a;
+            FloatBatch b;
+            a.load_unaligned(u1 + i);
+            b.load_unaligned(u2 + i);
+            auto radius = xsimd::sqrt(minusTwo * xsimd::log(a)) * sigma;
+            FloatBatch sine;
+            FloatBatch cosine;
+            xsimd::sincos(twoPiBatch * b, sine, cosine);
+            ComplexBatch noise(radius * cosine, radius * sine);
+            if (add)
+            {
+                ComplexBatch samples;
+                samples.load_unaligned(data + i);
+                noise = noise + samples;
+            }
+            noise.store_unaligned(data + i);
+        }
+        for (; i < n; i++)
+        {
+            auto radius = std::sqrt(-2.0F * std::log(u1[i])) * (rms / std::sqrt(2.0F));
+            auto noise = std::polar(radius, static_cast<float>(twoPi) * u2[i]);
+            data[i] = add ? data[i] + noise : noise;
+        }
+
+        data += n;
+        count -= n;
+    }
+}
+
+// FM ------------------------------------------------------------------------------------
+
+void FmGenerator::configure(double carrierFrequency, double deviation,
+                            double modulationFrequency)
+{
+    carrier_.setTone(carrierFrequency);
+    modulation_.setTone(modulationFrequency);
+    modulationIndex_ = modulationFrequency != 0
+                           ? static_cast<float>(deviation / modulationFrequency)
+                           : 0.0F;
+}
+
+void FmGenerator::reset()
+{
+    carrier_.reset();
+    modulation_.reset();
+}
+
+void FmGenerator::generate(std::complex<float> *out, size_t count, float amplitude)
+{
+    // exp(j (carrier + index * sin(modulation))): the modulating tone's imaginary part is
+    // the sine, which sets the phase around the carrier.
+    scratch_.resize(count);
+    modulation_.generate(scratch_.data(), count, modulationIndex_);
+
+    const FloatBatch amplitudeBatch(amplitude);
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+    {
+        ComplexBatch modulation;
+        modulation.load_unaligned(scratch_.data() + i);
+        FloatBatch sine;
+        FloatBatch cosine;
+        xsimd::sincos(modulation.imag(), sine, cosine);
+        ComplexBatch samples(amplitudeBatch * cosine, amplitudeBatch * sine);
+        samples.store_unaligned(out + i);
+    }
+    for (; i < count; i++)
+    {
+        out[i] = std::polar(amplitude, scratch_[i].imag());
+    }
+
+    carrier_.mix(out, count);
+}
+
+// QPSK ----------------------------------------------------------------------------------
+
+QpskGenerator::QpskGenerator(uint32_t seed) : state_(mixSeed(seed, 0))
+{
+    nextSymbol();
+}
+
+void QpskGenerator::configure(double carrierFrequency, double symbolRate)
+{
+    carrier_.setTone(carrierFrequency);
+    symbolRate_ = std::clamp(symbolRate, 1e-9, 1.0); // NOLINT(readability-magic-numbers)
+}
+
+void QpskGenerator::reset(uint32_t seed)
+{
+    carrier_.reset();
+    symbolPhase_ = 0;
+    state_ = mixSeed(seed, 0);
+    nextSymbol();
+}
+
+void QpskGenerator::nextSymbol()
+{
+    static const float level = 1.0F / std::sqrt(2.0F);
+    auto bits = xorshift32(state_);
+    symbol_ = {(bits & 1U) != 0 ? level : -level, (bits & 2U) != 0 ? level : -level};
+}
+
+void QpskGenerator::generate(std::complex<float> *out, size_t count, float amplitude)
+{
+    size_t i = 0;
+    while (i < count)
+    {
+        // Samples left in the current symbol
+        auto left = std::ceil((1.0 - symbolPhase_) / symbolRate_);
+        auto n = std::min(count - i, static_cast<size_t>(std::max(left, 1.0)));
+        std::fill_n(out + i, n, symbol_ * amplitude);
+
+        symbolPhase_ += static_cast<double>(n) * symbolRate_;
+        if (symbolPhase_ >= 1.0)
+        {
+            symbolPhase_ -= std::floor(symbolPhase_);
+            nextSymbol();
+        }
+        i += n;
+    }
+
+    carrier_.mix(out, count);
+}
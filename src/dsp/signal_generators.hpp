@@ -0,0 +1,105 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vectorised test signal generators. Frequencies are normalised to the sample rate
+// (cycles per sample) and every generator is phase continuous across calls, so a stream
+// can be generated block by block. Generators with a seed always produce the same
+// samples for the same seed.
+
+// Complex exponential whose frequency may sweep linearly from `start` to `end` and jump
+// back (a chirp). With no sweep it is a plain tone.
+class ToneGenerator
+{
+  public:
+    ToneGenerator() = default;
+
+    void setTone(double frequency);
+    void setSweep(double startFrequency, double endFrequency, double sweepSamples);
+    // Back to phase 0 and the start of the sweep
+    void reset();
+
+    // out = amplitude * exp(j phase)
+    void generate(std::complex<float> *out, size_t count, float amplitude);
+    // data *= exp(j phase), i.e. shifts `data` up by the tone's frequency
+    void mix(std::complex<float> *data, size_t count);
+
+  private:
+    void run(std::complex<float> *data, size_t count, float amplitude, bool mix);
+
+    // In radians per sample (and per sample squared)
+    double startIncrement_{0};
+    double endIncrement_{0};
+    double step_{0};
+
+    double phase_{0};
+    double increment_{0};
+};
+
+// Complex white Gaussian noise, `rms` being the RMS amplitude of the complex samples
+class NoiseGenerator
+{
+  public:
+    explicit NoiseGenerator(uint32_t seed = 1);
+
+    void seed(uint32_t seed);
+
+    void generate(std::complex<float> *out, size_t count, float rms);
+    void add(std::complex<float> *data, size_t count, float rms);
+
+  private:
+    void run(std::complex<float> *data, size_t count, float rms, bool add);
+
+    std::vector<uint32_t> state_; // One xorshift32 generator per SIMD lane
+    std::vector<float> uniforms_; // Scratch, one chunk
+};
+
+// Carrier frequency modulated by a tone
+class FmGenerator
+{
+  public:
+    FmGenerator() = default;
+
+    void configure(double carrierFrequency, double deviation, double modulationFrequency);
+    void reset();
+
+    void generate(std::complex<float> *out, size_t count, float amplitude);
+
+  private:
+    ToneGenerator carrier_;
+    ToneGenerator modulation_;
+    float modulationIndex_{0};
+    std::vector<std::complex<float>> scratch_;
+};
+
+// Random QPSK symbols with rectangular pulses, on a carrier
+class QpskGenerator
+{
+  public:
+    explicit QpskGenerator(uint32_t seed = 1);
+
+    // `symbolRate` in symbols per sample, up to 1
+    void configure(double carrierFrequency, double symbolRate);
+    void reset(uint32_t seed);
+
+    void generate(std::complex<float> *out, size_t count, float amplitude);
+
+  private:
+    ToneGenerator carrier_;
+    double symbolRate_{1};
+    double symbolPhase_{0}; // How far into the current symbol, in symbols
+    uint32_t state_;
+    std::complex<float> symbol_;
+    void nextSymbol();
+};
@@ -0,0 +1,174 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "spectrum_kernels.hpp"
+
+#include <xsimd/xsimd.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+using FloatBatch = xsimd::simd_type<float>;
+using ComplexBatch = xsimd::simd_type<std::complex<float>>;
+
+static constexpr size_t lanes = FloatBatch::size;
+static constexpr double twoPi = 6.283185307179586;
+
+bool parseWindowFunction(const std::string &text, WindowFunction &window)
+{
+    static const std::map<std::string, WindowFunction> names{
+        {"rectangular", WindowFunction::Rectangular},
+        {"hann", WindowFunction::Hann},
+        {"hamming", WindowFunction::Hamming},
+        {"blackman_harris", WindowFunction::BlackmanHarris},
+        {"flat_top", WindowFunction::FlatTop}};
+    auto it = names.find(text);
+    if (it == names.end())
+    {
+        return false;
+    }
+    window = it->second;
+    return true;
+}
+
+std::vector<float> makeWindow(WindowFunction window, size_t size)
+{
+    // Every window here is a sum of cosines: w[i] = sum_k (-1)^k a_k cos(2 pi k i / N)
+    // NOLINTBEGIN(readability-magic-numbers)
+    std::vector<double> terms;
+    switch (window)
+    {
+    case WindowFunction::Rectangular:
+        terms = {1};
+        break;
+    case WindowFunction::Hann:
+        terms = {0.5, 0.5};
+        break;
+    case WindowFunction::Hamming:
+        terms = {0.54, 0.46};
+        break;
+    case WindowFunction::BlackmanHarris:
+        terms = {0.35875, 0.48829, 0.14128, 0.01168};
+        break;
+    case WindowFunction::FlatTop:
+        terms = {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368};
+        break;
+    }
+    // NOLINTEND(readability-magic-numbers)
+
+    std::vector<float> points(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        auto phase = twoPi * static_cast<double>(i) / static_cast<double>(size);
+        double value = 0;
+        for (size_t k = 0; k < terms.size(); k++)
+        {
+            auto sign = k % 2 == 0 ? 1.0 : -1.0;
+            value += sign * terms[k] * std::cos(phase * static_cast<double>(k));
+        }
+        points[i] = static_cast<float>(value);
+    }
+    return points;
+}
+
+void applyWindow(const std::complex<float> *in, const float *window,
+                 std::complex<float> *out, size_t count)
+{
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+    {
+        ComplexBatch samples;
+        FloatBatch weights;
+        samples.load_unaligned(in + i);
+        weights.load_unaligned(window + i);
+        ComplexBatch(samples.real() * weights, samples.imag() * weights)
+            .store_unaligned(out + i);
+    }
+    for (; i < count; i++)
+    {
+        out[i] = in[i] * window[i];
+    }
+}
+
+void powerSpectrum(const std::complex<float> *in, float *power, size_t count)
+{
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+    {
+        ComplexBatch bins;
+        bins.load_unaligned(in + i);
+        auto norm = bins.real() * bins.real() + bins.imag() * bins.imag();
+        norm.store_unaligned(power + i);
+    }
+    for (; i < count; i++)
+    {
+        power[i] = std::norm(in[i]);
+    }
+}
+
+void accumulatePower(const std::complex<float> *in, float *sum, size_t count)
+{
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+    {
+        ComplexBatch bins;
+        FloatBatch total;
+        bins.load_unaligned(in + i);
+        total.load_unaligned(sum + i);
+        total += bins.real() * bins.real() + bins.imag() * bins.imag();
+        total.store_unaligned(sum + i);
+    }
+    for (; i < count; i++)
+    {
+        sum[i] += std::norm(in[i]);
+    }
+}
+
+void smoothPower(const std::complex<float> *in, float *average, size_t count,
+                 float alpha)
+{
+    const FloatBatch alphaBatch(alpha);
+
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+    {
+        ComplexBatch bins;
+        FloatBatch mean;
+        bins.load_unaligned(in + i);
+        mean.load_unaligned(average + i);
+        auto norm = bins.real() * bins.real() + bins.imag() * bins.imag();
+        (mean + alphaBatch * (norm - mean)).store_unaligned(average + i);
+    }
+    for (; i < count; i++)
+    {
+        average[i] += alpha * (std::norm(in[i]) - average[i]);
+    }
+}
+
+void powerToDb(const float *power, float *out, size_t count, float scale)
+{
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    const FloatBatch ten(10.0F);
+    const FloatBatch scaleBatch(scale);
+    const FloatBatch floor(SPECTRUM_POWER_FLOOR);
+
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+    {
+        FloatBatch values;
+        values.load_unaligned(power + i);
+        (ten * xsimd::log10(xsimd::max(values * scaleBatch, floor)))
+            .store_unaligned(out + i);
+    }
+    for (; i < count; i++)
+    {
+        // NOLINTNEXTLINE(readability-magic-numbers)
+        out[i] = 10.0F * std::log10(std::max(power[i] * scale, SPECTRUM_POWER_FLOOR));
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define SPECTRUM_POWER_FLOOR 1e-20F // -200 dB, instead of log10(0)
+
+enum class WindowFunction
+{
+    Rectangular,
+    Hann,
+    Hamming,
+    BlackmanHarris, // 4 terms, sidelobes under -92 dB
+    FlatTop         // For measuring levels, not resolving signals
+};
+
+// "rectangular", "hann", "hamming", "blackman_harris" or "flat_top", for config files.
+// False if none.
+bool parseWindowFunction(const std::string &text, WindowFunction &window);
+
+// Periodic (DFT-even) window of `size` points
+std::vector<float> makeWindow(WindowFunction window, size_t size);
+
+// Vectorised kernels of a power spectrum. `count` is in complex samples or bins.
+
+// out = in * window
+void applyWindow(const std::complex<float> *in, const float *window,
+                 std::complex<float> *out, size_t count);
+// power = |in|^2
+void powerSpectrum(const std::complex<float> *in, float *power, size_t count);
+// sum += |in|^2
+void accumulatePower(const std::complex<float> *in, float *sum, size_t count);
+// average += alpha * (|in|^2 - average)
+void smoothPower(const std::complex<float> *in, float *average, size_t count,
+                 float alpha);
+// out = 10 * log10(power * scale), floored at SPECTRUM_POWER_FLOOR. May run in place.
+void powerToDb(const float *power, float *out, size_t count, float scale);
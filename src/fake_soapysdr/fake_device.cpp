@@ -0,0 +1,395 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "fake_device.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstring>
+#include <thread>
+
+static constexpr double twoPi = 6.283185307179586;
+
+static std::string trim(const std::string &text)
+{
+    auto first = text.find_first_not_of(" \t");
+    if (first == std::string::npos)
+    {
+        return {};
+    }
+    auto last = text.find_last_not_of(" \t");
+    return text.substr(first, last - first + 1);
+}
+
+FakeArgs parseFakeArgs(const std::string &args)
+{
+    FakeArgs parsed;
+    size_t begin = 0;
+    while (begin <= args.size())
+    {
+        auto end = std::min(args.find(',', begin), args.size());
+        auto pair = args.substr(begin, end - begin);
+        auto equals = pair.find('=');
+        auto key = trim(pair.substr(0, equals));
+        if (!key.empty())
+        {
+            parsed[key] =
+                equals != std::string::npos ? trim(pair.substr(equals + 1)) : "";
+        }
+        begin = end + 1;
+    }
+    return parsed;
+}
+
+std::string fakeArgsToString(const FakeArgs &args)
+{
+    std::string text;
+    for (const auto &arg : args)
+    {
+        if (!text.empty())
+        {
+            text += ", ";
+        }
+        text += arg.first + "=" + arg.second;
+    }
+    return text;
+}
+
+FakeDeviceOptions FakeDeviceOptions::fromArgs(const FakeArgs &args)
+{
+    FakeDeviceOptions options;
+    auto number = [&](const char *key, double fallback) {
+        auto it = args.find(key);
+        return it != args.end() ? std::strtod(it->second.c_str(), nullptr) : fallback;
+    };
+
+    auto count = [&](const char *key, size_t fallback) {
+        auto value = number(key, static_cast<double>(fallback));
+        return static_cast<size_t>(std::max(value, 0.0));
+    };
+
+    options.channels = std::max<size_t>(count("channels", options.channels), 1);
+    options.mtu = std::max<size_t>(count("mtu", options.mtu), 1);
+    options.sampleRate = number("rate", options.sampleRate);
+    options.realTime = number("realtime", 1) != 0;
+    options.latencyUs = std::max(number("latency", 0), 0.0);
+    options.jitterUs = std::max(number("jitter", 0), 0.0);
+    options.overflowEvery = count("overflow_every", 0);
+    options.tuneDelayUs = std::max(number("tune_delay", 0), 0.0);
+    options.seed = static_cast<uint32_t>(number("seed", options.seed));
+
+    auto native = args.find("native");
+    if (native != args.end() && (native->second == SOAPY_SDR_CF32 ||
+                                 native->second == SOAPY_SDR_CS16 ||
+                                 native->second == SOAPY_SDR_CS8))
+    {
+        options.nativeFormat = native->second;
+    }
+    return options;
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init, hicpp-member-init)
+FakeDevice::FakeDevice(const FakeDeviceOptions &options)
+    : options_(options), frequencies_(options.channels, 0),
+      sampleRate_(options.sampleRate), bandwidth_(options.sampleRate), antenna_("RX"),
+      agc_(false), lna_(0), vga_(0), sampleBytes_(0), streaming_(false), samples_(0),
+      reads_(0), random_(options.seed != 0 ? options.seed : 1)
+{
+}
+
+// Settings ------------------------------------------------------------------------------
+
+int FakeDevice::setFrequency(size_t channel, double frequency)
+{
+    if (channel >= options_.channels)
+    {
+        return SOAPY_SDR_NOT_SUPPORTED;
+    }
+
+    // A PLL takes a while to lock
+    if (options_.tuneDelayUs > 0)
+    {
+        std::this_thread::sleep_for(
+            std::chrono::duration<double, std::micro>(options_.tuneDelayUs));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    frequencies_[channel] = frequency;
+    return 0;
+}
+
+double FakeDevice::getFrequency(size_t channel)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return channel < options_.channels ? frequencies_[channel] : 0;
+}
+
+int FakeDevice::setSampleRate(size_t channel, double sampleRate)
+{
+    if (channel >= options_.channels || sampleRate < FAKE_SOAPY_MIN_RATE ||
+        sampleRate > FAKE_SOAPY_MAX_RATE)
+    {
+        return SOAPY_SDR_NOT_SUPPORTED;
+    }
+
+    // The channels share one clock
+    std::lock_guard<std::mutex> lock(mutex_);
+    sampleRate_ = sampleRate;
+    return 0;
+}
+
+double FakeDevice::getSampleRate()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sampleRate_;
+}
+
+int FakeDevice::setBandwidth(size_t channel, double bandwidth)
+{
+    if (channel >= options_.channels)
+    {
+        return SOAPY_SDR_NOT_SUPPORTED;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    bandwidth_ = bandwidth;
+    return 0;
+}
+
+double FakeDevice::getBandwidth()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bandwidth_;
+}
+
+int FakeDevice::setAntenna(size_t channel, const std::string &antenna)
+{
+    if (channel >= options_.channels || (antenna != "RX" && antenna != "RX2"))
+    {
+        return SOAPY_SDR_NOT_SUPPORTED;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    antenna_ = antenna;
+    return 0;
+}
+
+std::string FakeDevice::getAntenna()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return antenna_;
+}
+
+int FakeDevice::setGainMode(bool automatic)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    agc_ = automatic;
+    return 0;
+}
+
+bool FakeDevice::getGainMode()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return agc_;
+}
+
+int FakeDevice::setGain(double gain)
+{
+    // Like most drivers: the LNA first, then the VGA
+    std::lock_guard<std::mutex> lock(mutex_);
+    lna_ = std::clamp(gain, 0.0, FAKE_SOAPY_LNA_MAX);
+    vga_ = std::clamp(gain - lna_, 0.0, FAKE_SOAPY_VGA_MAX);
+    return 0;
+}
+
+double FakeDevice::getGain()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lna_ + vga_;
+}
+
+int FakeDevice::setGainElement(const std::string &name, double gain)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (name == "LNA")
+    {
+        lna_ = std::clamp(gain, 0.0, FAKE_SOAPY_LNA_MAX);
+        return 0;
+    }
+    if (name == "VGA")
+    {
+        vga_ = std::clamp(gain, 0.0, FAKE_SOAPY_VGA_MAX);
+        return 0;
+    }
+    return SOAPY_SDR_NOT_SUPPORTED;
+}
+
+double FakeDevice::getGainElement(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (name == "LNA")
+    {
+        return lna_;
+    }
+    return name == "VGA" ? vga_ : 0;
+}
+
+// Stream --------------------------------------------------------------------------------
+
+void FakeDevice::buildTables(const std::string &format,
+                             const std::vector<size_t> &channels)
+{
+    // One MTU starting anywhere in the first period is a single copy
+    auto length = static_cast<size_t>(FAKE_SOAPY_TONE_PERIOD) + options_.mtu;
+
+    tables_.clear();
+    for (auto channel : channels)
+    {
+        std::vector<uint8_t> table(length * sampleBytes_);
+        for (size_t i = 0; i < length; i++)
+        {
+            auto phase = twoPi * static_cast<double>((channel + 1) * i) /
+                         FAKE_SOAPY_TONE_PERIOD;
+            auto sample = std::polar(FAKE_SOAPY_TONE_LEVEL, phase);
+            if (format == SOAPY_SDR_CS16)
+            {
+                auto scale = static_cast<double>(INT16_MAX);
+                int16_t iq[2] = {
+                    static_cast<int16_t>(std::lround(sample.real() * scale)),
+                    static_cast<int16_t>(std::lround(sample.imag() * scale))};
+                std::memcpy(table.data() + i * sampleBytes_, iq, sampleBytes_);
+            }
+            else if (format == SOAPY_SDR_CS8)
+            {
+                auto scale = static_cast<double>(INT8_MAX);
+                int8_t iq[2] = {static_cast<int8_t>(std::lround(sample.real() * scale)),
+                                static_cast<int8_t>(std::lround(sample.imag() * scale))};
+                std::memcpy(table.data() + i * sampleBytes_, iq, sampleBytes_);
+            }
+            else
+            {
+                std::complex<float> iq(sample);
+                std::memcpy(table.data() + i * sampleBytes_, &iq, sampleBytes_);
+            }
+        }
+        tables_.push_back(std::move(table));
+    }
+}
+
+bool FakeDevice::setupStream(const std::string &format,
+                             const std::vector<size_t> &channels)
+{
+    if (format == SOAPY_SDR_CF32)
+    {
+        sampleBytes_ = 2 * sizeof(float);
+    }
+    else if (format == SOAPY_SDR_CS16)
+    {
+        sampleBytes_ = 2 * sizeof(int16_t);
+    }
+    else if (format == SOAPY_SDR_CS8)
+    {
+        sampleBytes_ = 2 * sizeof(int8_t);
+    }
+    else
+    {
+        return false;
+    }
+
+    if (channels.empty() ||
+        std::any_of(channels.begin(), channels.end(),
+                    [&](size_t channel) { return channel >= options_.channels; }))
+    {
+        return false;
+    }
+
+    // Samples are only ever copied out of these, so reading costs next to nothing
+    buildTables(format, channels);
+    streaming_ = false;
+    return true;
+}
+
+void FakeDevice::activateStream()
+{
+    start_ = std::chrono::steady_clock::now();
+    samples_ = 0;
+    reads_ = 0;
+    streaming_ = true;
+}
+
+void FakeDevice::deactivateStream()
+{
+    streaming_ = false;
+}
+
+void FakeDevice::closeStream()
+{
+    streaming_ = false;
+    tables_.clear();
+}
+
+int FakeDevice::readStream(void *const *buffs, size_t numElems, int *flags,
+                           long long *timeNs, long timeoutUs)
+{
+    if (!streaming_)
+    {
+        return SOAPY_SDR_STREAM_ERROR;
+    }
+
+    auto rate = getSampleRate();
+    auto count = std::min(numElems, options_.mtu);
+    reads_++;
+
+    // The host was too slow: the device's buffer wrapped and these samples are gone
+    if (options_.overflowEvery > 0 && reads_ % options_.overflowEvery == 0)
+    {
+        samples_ += count;
+        return SOAPY_SDR_OVERFLOW;
+    }
+
+    if (options_.realTime)
+    {
+        auto delayUs = options_.latencyUs;
+        if (options_.jitterUs > 0)
+        {
+            // xorshift32
+            random_ ^= random_ << 13U; // NOLINT(readability-magic-numbers)
+            random_ ^= random_ >> 17U; // NOLINT(readability-magic-numbers)
+            random_ ^= random_ << 5U;  // NOLINT(readability-magic-numbers)
+            delayUs += options_.jitterUs * random_ / UINT32_MAX;
+        }
+
+        // The buffer is full once its last sample arrived
+        // NOLINTNEXTLINE(readability-magic-numbers)
+        auto dueUs = static_cast<double>(samples_ + count) / rate * 1e6 + delayUs;
+        auto due = start_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::duration<double, std::micro>(dueUs));
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::microseconds(timeoutUs);
+        if (due > deadline)
+        {
+            std::this_thread::sleep_until(deadline);
+            return SOAPY_SDR_TIMEOUT;
+        }
+        std::this_thread::sleep_until(due);
+    }
+
+    auto offset = (samples_ % FAKE_SOAPY_TONE_PERIOD) * sampleBytes_;
+    for (size_t c = 0; c < tables_.size(); c++)
+    {
+        std::memcpy(buffs[c], tables_[c].data() + offset, count * sampleBytes_);
+    }
+
+    // Device time of the first sample, as hardware with a sample counter would report it
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    *timeNs = static_cast<long long>(static_cast<double>(samples_) * 1e9 / rate);
+    *flags = SOAPY_SDR_HAS_TIME;
+    samples_ += count;
+    return static_cast<int>(count);
+}
@@ -0,0 +1,120 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "soapysdr_types.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define FAKE_SOAPY_API_VERSION "0.8.0"
+#define FAKE_SOAPY_ARGS_ENV "AETHER_FAKE_SOAPY_ARGS" // Defaults for every device
+#define FAKE_SOAPY_TONE_PERIOD 64 // Samples; channel c carries (c + 1) cycles per period
+#define FAKE_SOAPY_TONE_LEVEL 0.5
+#define FAKE_SOAPY_MIN_RATE 10'000.0
+#define FAKE_SOAPY_MAX_RATE 1'000'000'000.0
+#define FAKE_SOAPY_LNA_MAX 40.0
+#define FAKE_SOAPY_VGA_MAX 30.0
+
+using FakeArgs = std::map<std::string, std::string>;
+
+FakeArgs parseFakeArgs(const std::string &args);
+std::string fakeArgsToString(const FakeArgs &args);
+
+// What a fake device emulates, from its device arguments:
+//   channels=2        RX channels
+//   mtu=8192          Samples per `readStream`
+//   rate=2e6          Initial sample rate
+//   realtime=1        0 delivers samples as fast as they are read
+//   latency=0         us, added to when every buffer is due
+//   jitter=0          us, random extra delay of every buffer, up to this
+//   overflow_every=0  Every Nth read overflows, losing one MTU of samples
+//   tune_delay=0      us, a retune blocks this long
+//   native=CS16       Native stream format (CF32, CS16 or CS8)
+//   seed=1            For the jitter
+struct FakeDeviceOptions
+{
+    size_t channels{2};
+    size_t mtu{8192};
+    double sampleRate{2'000'000};
+    bool realTime{true};
+    double latencyUs{0};
+    double jitterUs{0};
+    size_t overflowEvery{0};
+    double tuneDelayUs{0};
+    std::string nativeFormat{SOAPY_SDR_CS16};
+    uint32_t seed{1};
+
+    static FakeDeviceOptions fromArgs(const FakeArgs &args);
+};
+
+class FakeDevice
+{
+  public:
+    explicit FakeDevice(const FakeDeviceOptions &options);
+
+    [[nodiscard]] const FakeDeviceOptions &options() const
+    {
+        return options_;
+    };
+
+    // Settings -------------------------------------------------------------------------
+    // Any thread, like a real driver
+    int setFrequency(size_t channel, double frequency);
+    double getFrequency(size_t channel);
+    int setSampleRate(size_t channel, double sampleRate);
+    double getSampleRate();
+    int setBandwidth(size_t channel, double bandwidth);
+    double getBandwidth();
+    int setAntenna(size_t channel, const std::string &antenna);
+    std::string getAntenna();
+    int setGainMode(bool automatic);
+    bool getGainMode();
+    int setGain(double gain);
+    double getGain();
+    int setGainElement(const std::string &name, double gain);
+    double getGainElement(const std::string &name);
+
+    // Stream ---------------------------------------------------------------------------
+    // Only one stream at a time, read from one thread
+    bool setupStream(const std::string &format, const std::vector<size_t> &channels);
+    void activateStream();
+    void deactivateStream();
+    void closeStream();
+    int readStream(void *const *buffs, size_t numElems, int *flags, long long *timeNs,
+                   long timeoutUs);
+
+  private:
+    FakeDeviceOptions options_;
+
+    std::mutex mutex_;
+    std::vector<double> frequencies_;
+    double sampleRate_;
+    double bandwidth_;
+    std::string antenna_;
+    bool agc_;
+    double lna_;
+    double vga_;
+
+    // Stream state, worker only
+    size_t sampleBytes_;
+    std::vector<std::vector<uint8_t>> tables_; // Per streamed channel, in the format
+    bool streaming_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t samples_;
+    uint64_t reads_;
+    uint32_t random_;
+
+    void buildTables(const std::string &format, const std::vector<size_t> &channels);
+};
@@ -0,0 +1,498 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+// The subset of SoapySDR's C API `SoapySdrRadio` resolves, backed by `FakeDevice`s.
+// Point AETHER_SOAPY_LIBRARY at this library to run the radio with no hardware.
+// Memory is handed out with malloc, as SoapySDR does.
+
+#include "fake_device.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define FAKE_SOAPY_EXPORT extern "C" __declspec(dllexport)
+#else
+#define FAKE_SOAPY_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+// NOLINTBEGIN(cppcoreguidelines-owning-memory, cppcoreguidelines-no-malloc)
+// NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+static thread_local std::string lastError;
+
+static FakeDevice *fake(SoapySDRDevice *device)
+{
+    return reinterpret_cast<FakeDevice *>(device);
+}
+
+static FakeDevice *fake(const SoapySDRDevice *device)
+{
+    return fake(const_cast<SoapySDRDevice *>(device));
+}
+
+static int fail(int code, const std::string &error)
+{
+    lastError = error;
+    return code;
+}
+
+static char *copyString(const std::string &text)
+{
+    auto *copy = static_cast<char *>(std::malloc(text.size() + 1));
+    std::memcpy(copy, text.c_str(), text.size() + 1);
+    return copy;
+}
+
+static char **copyStrings(const std::vector<std::string> &texts, size_t *length)
+{
+    auto **copy = static_cast<char **>(std::malloc(texts.size() * sizeof(char *)));
+    for (size_t i = 0; i < texts.size(); i++)
+    {
+        copy[i] = copyString(texts[i]);
+    }
+    *length = texts.size();
+    return copy;
+}
+
+static SoapySDRRange *copyRange(const SoapySDRRange &range, size_t *length)
+{
+    auto *copy = static_cast<SoapySDRRange *>(std::malloc(sizeof(SoapySDRRange)));
+    *copy = range;
+    *length = 1;
+    return copy;
+}
+
+static double *copyValues(const std::vector<double> &values, size_t *length)
+{
+    auto *copy = static_cast<double *>(std::malloc(values.size() * sizeof(double)));
+    std::memcpy(copy, values.data(), values.size() * sizeof(double));
+    *length = values.size();
+    return copy;
+}
+
+static SoapySDRKwargs toKwargs(const FakeArgs &args)
+{
+    SoapySDRKwargs kwargs{0, nullptr, nullptr};
+    kwargs.keys = static_cast<char **>(std::malloc(args.size() * sizeof(char *)));
+    kwargs.vals = static_cast<char **>(std::malloc(args.size() * sizeof(char *)));
+    for (const auto &arg : args)
+    {
+        kwargs.keys[kwargs.size] = copyString(arg.first);
+        kwargs.vals[kwargs.size] = copyString(arg.second);
+        kwargs.size++;
+    }
+    return kwargs;
+}
+
+static FakeArgs fromKwargs(const SoapySDRKwargs *kwargs)
+{
+    FakeArgs args;
+    for (size_t i = 0; kwargs != nullptr && i < kwargs->size; i++)
+    {
+        args[kwargs->keys[i]] = kwargs->vals[i];
+    }
+    return args;
+}
+
+// Explicit arguments win over the ones from the environment
+static FakeArgs withDefaults(const FakeArgs &args)
+{
+    const auto *env = std::getenv(FAKE_SOAPY_ARGS_ENV);
+    auto merged = parseFakeArgs(env != nullptr ? env : "");
+    for (const auto &arg : args)
+    {
+        merged[arg.first] = arg.second;
+    }
+    merged["driver"] = "fake";
+    return merged;
+}
+
+// Library and arguments -----------------------------------------------------------------
+
+FAKE_SOAPY_EXPORT const char *SoapySDR_getAPIVersion()
+{
+    return FAKE_SOAPY_API_VERSION;
+}
+
+FAKE_SOAPY_EXPORT const char *SoapySDR_errToStr(const int errorCode)
+{
+    switch (errorCode)
+    {
+    case SOAPY_SDR_TIMEOUT:
+        return "TIMEOUT";
+    case SOAPY_SDR_STREAM_ERROR:
+        return "STREAM_ERROR";
+    case SOAPY_SDR_OVERFLOW:
+        return "OVERFLOW";
+    case SOAPY_SDR_NOT_SUPPORTED:
+        return "NOT_SUPPORTED";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+FAKE_SOAPY_EXPORT const char *SoapySDRDevice_lastError()
+{
+    return lastError.c_str();
+}
+
+FAKE_SOAPY_EXPORT SoapySDRKwargs SoapySDRKwargs_fromString(const char *markup)
+{
+    return toKwargs(parseFakeArgs(markup != nullptr ? markup : ""));
+}
+
+FAKE_SOAPY_EXPORT char *SoapySDRKwargs_toString(const SoapySDRKwargs *args)
+{
+    return copyString(fakeArgsToString(fromKwargs(args)));
+}
+
+FAKE_SOAPY_EXPORT const char *SoapySDRKwargs_get(const SoapySDRKwargs *args,
+                                                 const char *key)
+{
+    for (size_t i = 0; i < args->size; i++)
+    {
+        if (std::strcmp(args->keys[i], key) == 0)
+        {
+            return args->vals[i];
+        }
+    }
+    return nullptr;
+}
+
+FAKE_SOAPY_EXPORT void SoapySDRKwargsList_clear(SoapySDRKwargs *args, const size_t length)
+{
+    for (size_t i = 0; args != nullptr && i < length; i++)
+    {
+        for (size_t j = 0; j < args[i].size; j++)
+        {
+            std::free(args[i].keys[j]);
+            std::free(args[i].vals[j]);
+        }
+        std::free(args[i].keys);
+        std::free(args[i].vals);
+    }
+    std::free(args);
+}
+
+// Devices -------------------------------------------------------------------------------
+
+FAKE_SOAPY_EXPORT SoapySDRKwargs *SoapySDRDevice_enumerate(
+    const SoapySDRKwargs * /*args*/, size_t *length)
+{
+    auto args = withDefaults({});
+    auto count = std::max<size_t>(std::strtoul(args["count"].c_str(), nullptr, 10), 1);
+    args.erase("count");
+
+    auto *devices =
+        static_cast<SoapySDRKwargs *>(std::malloc(count * sizeof(SoapySDRKwargs)));
+    for (size_t i = 0; i < count; i++)
+    {
+        args["serial"] = std::to_string(i);
+        args["label"] = "Fake SDR #" + std::to_string(i);
+        devices[i] = toKwargs(args);
+    }
+    *length = count;
+    return devices;
+}
+
+FAKE_SOAPY_EXPORT SoapySDRDevice *SoapySDRDevice_make(const SoapySDRKwargs *args)
+{
+    auto options = FakeDeviceOptions::fromArgs(withDefaults(fromKwargs(args)));
+    return reinterpret_cast<SoapySDRDevice *>(new FakeDevice(options));
+}
+
+FAKE_SOAPY_EXPORT SoapySDRDevice *SoapySDRDevice_makeStrArgs(const char *args)
+{
+    auto options = FakeDeviceOptions::fromArgs(withDefaults(parseFakeArgs(args)));
+    return reinterpret_cast<SoapySDRDevice *>(new FakeDevice(options));
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_unmake(SoapySDRDevice *device)
+{
+    delete fake(device);
+    return 0;
+}
+
+FAKE_SOAPY_EXPORT SoapySDRKwargs
+SoapySDRDevice_getHardwareInfo(const SoapySDRDevice *device)
+{
+    const auto &options = fake(device)->options();
+    return toKwargs({{"channels", std::to_string(options.channels)},
+                     {"mtu", std::to_string(options.mtu)}});
+}
+
+FAKE_SOAPY_EXPORT size_t SoapySDRDevice_getNumChannels(const SoapySDRDevice *device,
+                                                       const int /*direction*/)
+{
+    return fake(device)->options().channels;
+}
+
+FAKE_SOAPY_EXPORT SoapySDRKwargs SoapySDRDevice_getChannelInfo(
+    const SoapySDRDevice * /*device*/, const int /*direction*/, const size_t channel)
+{
+    return toKwargs({{"name", "RX" + std::to_string(channel)}});
+}
+
+// Frequency, sample rate and bandwidth --------------------------------------------------
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_setFrequency(SoapySDRDevice *device,
+                                                  const int /*direction*/,
+                                                  const size_t channel,
+                                                  const double frequency,
+                                                  const SoapySDRKwargs * /*args*/)
+{
+    auto res = fake(device)->setFrequency(channel, frequency);
+    return res != 0 ? fail(res, "Invalid channel") : 0;
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_setSampleRate(SoapySDRDevice *device,
+                                                   const int /*direction*/,
+                                                   const size_t channel,
+                                                   const double rate)
+{
+    auto res = fake(device)->setSampleRate(channel, rate);
+    return res != 0 ? fail(res, "Invalid channel or sample rate") : 0;
+}
+
+FAKE_SOAPY_EXPORT double SoapySDRDevice_getSampleRate(const SoapySDRDevice *device,
+                                                      const int /*direction*/,
+                                                      const size_t /*channel*/)
+{
+    return fake(device)->getSampleRate();
+}
+
+FAKE_SOAPY_EXPORT SoapySDRRange *SoapySDRDevice_getSampleRateRange(
+    const SoapySDRDevice * /*device*/, const int /*direction*/, const size_t /*channel*/,
+    size_t *length)
+{
+    return copyRange({FAKE_SOAPY_MIN_RATE, FAKE_SOAPY_MAX_RATE, 0}, length);
+}
+
+FAKE_SOAPY_EXPORT double *SoapySDRDevice_listSampleRates(
+    const SoapySDRDevice * /*device*/, const int /*direction*/, const size_t /*channel*/,
+    size_t *length)
+{
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    return copyValues({1e6, 2e6, 10e6, 20e6, 50e6, 100e6}, length);
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_setBandwidth(SoapySDRDevice *device,
+                                                  const int /*direction*/,
+                                                  const size_t channel, const double bw)
+{
+    auto res = fake(device)->setBandwidth(channel, bw);
+    return res != 0 ? fail(res, "Invalid channel") : 0;
+}
+
+FAKE_SOAPY_EXPORT double SoapySDRDevice_getBandwidth(const SoapySDRDevice *device,
+                                                     const int /*direction*/,
+                                                     const size_t /*channel*/)
+{
+    return fake(device)->getBandwidth();
+}
+
+FAKE_SOAPY_EXPORT SoapySDRRange *SoapySDRDevice_getBandwidthRange(
+    const SoapySDRDevice * /*device*/, const int /*direction*/, const size_t /*channel*/,
+    size_t *length)
+{
+    return copyRange({FAKE_SOAPY_MIN_RATE, FAKE_SOAPY_MAX_RATE, 0}, length);
+}
+
+FAKE_SOAPY_EXPORT double *SoapySDRDevice_listBandwidths(const SoapySDRDevice * /*device*/,
+                                                        const int /*direction*/,
+                                                        const size_t /*channel*/,
+                                                        size_t *length)
+{
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    return copyValues({1e6, 2e6, 10e6, 20e6, 50e6, 100e6}, length);
+}
+
+// Antennas and gains --------------------------------------------------------------------
+
+FAKE_SOAPY_EXPORT char **SoapySDRDevice_listAntennas(const SoapySDRDevice * /*device*/,
+                                                     const int /*direction*/,
+                                                     const size_t /*channel*/,
+                                                     size_t *length)
+{
+    return copyStrings({"RX", "RX2"}, length);
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_setAntenna(SoapySDRDevice *device,
+                                                const int /*direction*/,
+                                                const size_t channel, const char *name)
+{
+    auto res = fake(device)->setAntenna(channel, name);
+    return res != 0 ? fail(res, "Invalid channel or antenna") : 0;
+}
+
+FAKE_SOAPY_EXPORT char *SoapySDRDevice_getAntenna(const SoapySDRDevice *device,
+                                                  const int /*direction*/,
+                                                  const size_t /*channel*/)
+{
+    return copyString(fake(device)->getAntenna());
+}
+
+FAKE_SOAPY_EXPORT char **SoapySDRDevice_listGains(const SoapySDRDevice * /*device*/,
+                                                  const int /*direction*/,
+                                                  const size_t /*channel*/,
+                                                  size_t *length)
+{
+    return copyStrings({"LNA", "VGA"}, length);
+}
+
+FAKE_SOAPY_EXPORT bool SoapySDRDevice_hasGainMode(const SoapySDRDevice * /*device*/,
+                                                  const int /*direction*/,
+                                                  const size_t /*channel*/)
+{
+    return true;
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_setGainMode(SoapySDRDevice *device,
+                                                 const int /*direction*/,
+                                                 const size_t /*channel*/,
+                                                 const bool automatic)
+{
+    return fake(device)->setGainMode(automatic);
+}
+
+FAKE_SOAPY_EXPORT bool SoapySDRDevice_getGainMode(const SoapySDRDevice *device,
+                                                  const int /*direction*/,
+                                                  const size_t /*channel*/)
+{
+    return fake(device)->getGainMode();
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_setGain(SoapySDRDevice *device,
+                                             const int /*direction*/,
+                                             const size_t /*channel*/, const double value)
+{
+    return fake(device)->setGain(value);
+}
+
+FAKE_SOAPY_EXPORT double SoapySDRDevice_getGain(const SoapySDRDevice *device,
+                                                const int /*direction*/,
+                                                const size_t /*channel*/)
+{
+    return fake(device)->getGain();
+}
+
+FAKE_SOAPY_EXPORT SoapySDRRange SoapySDRDevice_getGainRange(
+    const SoapySDRDevice * /*device*/, const int /*direction*/, const size_t /*channel*/)
+{
+    return {0, FAKE_SOAPY_LNA_MAX + FAKE_SOAPY_VGA_MAX, 1};
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_setGainElement(SoapySDRDevice *device,
+                                                    const int /*direction*/,
+                                                    const size_t /*channel*/,
+                                                    const char *name, const double value)
+{
+    auto res = fake(device)->setGainElement(name, value);
+    return res != 0 ? fail(res, "Invalid gain element") : 0;
+}
+
+FAKE_SOAPY_EXPORT double SoapySDRDevice_getGainElement(const SoapySDRDevice *device,
+                                                       const int /*direction*/,
+                                                       const size_t /*channel*/,
+                                                       const char *name)
+{
+    return fake(device)->getGainElement(name);
+}
+
+FAKE_SOAPY_EXPORT SoapySDRRange SoapySDRDevice_getGainElementRange(
+    const SoapySDRDevice * /*device*/, const int /*direction*/, const size_t /*channel*/,
+    const char *name)
+{
+    auto lna = std::strcmp(name, "LNA") == 0;
+    return {0, lna ? FAKE_SOAPY_LNA_MAX : FAKE_SOAPY_VGA_MAX, 1};
+}
+
+// Streams -------------------------------------------------------------------------------
+
+FAKE_SOAPY_EXPORT char **SoapySDRDevice_getStreamFormats(
+    const SoapySDRDevice * /*device*/, const int /*direction*/, const size_t /*channel*/,
+    size_t *length)
+{
+    return copyStrings({SOAPY_SDR_CF32, SOAPY_SDR_CS16, SOAPY_SDR_CS8}, length);
+}
+
+FAKE_SOAPY_EXPORT char *SoapySDRDevice_getNativeStreamFormat(const SoapySDRDevice *device,
+                                                             const int /*direction*/,
+                                                             const size_t /*channel*/,
+                                                             double *fullScale)
+{
+    const auto &format = fake(device)->options().nativeFormat;
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    *fullScale = format == SOAPY_SDR_CS16 ? 32768 : format == SOAPY_SDR_CS8 ? 128 : 1;
+    return copyString(format);
+}
+
+// The device is its own (only) stream
+FAKE_SOAPY_EXPORT SoapySDRStream *SoapySDRDevice_setupStream(
+    SoapySDRDevice *device, const int /*direction*/, const char *format,
+    const size_t *channels, const size_t numChans, const SoapySDRKwargs * /*args*/)
+{
+    std::vector<size_t> channelList(channels, channels + numChans);
+    if (channelList.empty())
+    {
+        channelList.push_back(0);
+    }
+    if (!fake(device)->setupStream(format, channelList))
+    {
+        fail(SOAPY_SDR_NOT_SUPPORTED, "Unsupported stream format or channels");
+        return nullptr;
+    }
+    return reinterpret_cast<SoapySDRStream *>(device);
+}
+
+FAKE_SOAPY_EXPORT size_t SoapySDRDevice_getStreamMTU(const SoapySDRDevice *device,
+                                                     SoapySDRStream * /*stream*/)
+{
+    return fake(device)->options().mtu;
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_activateStream(SoapySDRDevice *device,
+                                                    SoapySDRStream * /*stream*/,
+                                                    const int /*flags*/,
+                                                    const long long /*timeNs*/,
+                                                    const size_t /*numElems*/)
+{
+    fake(device)->activateStream();
+    return 0;
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_deactivateStream(SoapySDRDevice *device,
+                                                      SoapySDRStream * /*stream*/,
+                                                      const int /*flags*/,
+                                                      const long long /*timeNs*/)
+{
+    fake(device)->deactivateStream();
+    return 0;
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_closeStream(SoapySDRDevice *device,
+                                                 SoapySDRStream * /*stream*/)
+{
+    fake(device)->closeStream();
+    return 0;
+}
+
+FAKE_SOAPY_EXPORT int SoapySDRDevice_readStream(SoapySDRDevice *device,
+                                                SoapySDRStream * /*stream*/,
+                                                void *const *buffs, const size_t numElems,
+                                                int *flags, long long *timeNs,
+                                                const long timeoutUs)
+{
+    return fake(device)->readStream(buffs, numElems, flags, timeNs, timeoutUs);
+}
+
+// NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+// NOLINTEND(cppcoreguidelines-owning-memory, cppcoreguidelines-no-malloc)
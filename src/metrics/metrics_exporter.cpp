@@ -0,0 +1,107 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "metrics_exporter.hpp"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QHostAddress>
+#include <QSaveFile>
+#include <QTcpSocket>
+
+MetricsExporter::MetricsExporter(MetricsRegistry *registry) : registry_(registry)
+{
+    QObject::connect(&server_, &QTcpServer::newConnection, [this]() {
+        while (auto *socket = server_.nextPendingConnection())
+        {
+            serve(socket);
+        }
+    });
+    QObject::connect(&fileTimer_, &QTimer::timeout, [this]() { saveFile(); });
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+bool MetricsExporter::listen(uint16_t port)
+{
+    // Never exposed beyond this machine
+    if (!server_.listen(QHostAddress::LocalHost, port))
+    {
+        qDebug() << "Couldn't serve metrics on port " << port << ": "
+                 << server_.errorString();
+        return false;
+    }
+    qDebug() << "Serving metrics on http://127.0.0.1:" << server_.serverPort()
+             << "/metrics";
+    return true;
+}
+
+bool MetricsExporter::writeFile(const QString &path, double interval)
+{
+    path_ = path;
+    if (!saveFile())
+    {
+        return false;
+    }
+    if (interval > 0)
+    {
+        // NOLINTNEXTLINE(readability-magic-numbers)
+        fileTimer_.start(static_cast<int>(interval * 1000));
+    }
+    return true;
+}
+
+void MetricsExporter::stop()
+{
+    server_.close();
+    fileTimer_.stop();
+    if (!path_.isEmpty())
+    {
+        saveFile();
+        path_.clear();
+    }
+}
+
+void MetricsExporter::serve(QTcpSocket *socket)
+{
+    QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() {
+        // Whatever was asked, once the headers are in, the answer is the metrics
+        auto request = socket->peek(METRICS_MAX_REQUEST);
+        if (!request.contains("\r\n\r\n") && request.size() < METRICS_MAX_REQUEST)
+        {
+            return;
+        }
+        socket->readAll();
+
+        auto body = QByteArray::fromStdString(registry_->render());
+        QByteArray response;
+        response += "HTTP/1.0 200 OK\r\n";
+        response += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+        response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        response += "Connection: close\r\n\r\n";
+        response += body;
+        socket->write(response);
+        socket->disconnectFromHost();
+    });
+}
+
+bool MetricsExporter::saveFile()
+{
+    QSaveFile file(path_);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Couldn't write metrics to " << path_ << ": " << file.errorString();
+        return false;
+    }
+    file.write(QByteArray::fromStdString(registry_->render()));
+    return file.commit();
+}
@@ -0,0 +1,50 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "metrics_registry.hpp"
+
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <cstdint>
+
+#define METRICS_DEFAULT_PORT 9464
+#define METRICS_MAX_REQUEST 8192 // Bytes of a scrape request we bother reading
+
+// Exposes a registry to scrapers, from the thread that owns it (which needs an event
+// loop), so rendering never runs on the pipeline's threads:
+// - over HTTP on localhost only, answering any GET with the Prometheus text format;
+// - and/or by rewriting a file every so often, for node_exporter's textfile collector
+//   or for whoever wants to `cat` it. The file is replaced atomically.
+class MetricsExporter
+{
+  public:
+    explicit MetricsExporter(MetricsRegistry *registry = &MetricsRegistry::shared());
+    MetricsExporter(const MetricsExporter &) = delete;
+    MetricsExporter &operator=(const MetricsExporter &) = delete;
+    ~MetricsExporter();
+
+    bool listen(uint16_t port = METRICS_DEFAULT_PORT);
+    // Every `interval` s, and once more on stop()
+    bool writeFile(const QString &path, double interval);
+    void stop();
+
+  private:
+    MetricsRegistry *registry_;
+
+    QTcpServer server_;
+    void serve(QTcpSocket *socket);
+
+    QString path_;
+    QTimer fileTimer_;
+    bool saveFile();
+};
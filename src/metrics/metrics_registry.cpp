@@ -0,0 +1,228 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "metrics_registry.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <locale>
+#include <sstream>
+
+void MetricHistogram::observe(std::chrono::nanoseconds duration)
+{
+    auto ns = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+
+    // The first bucket whose bound (2^i us) isn't below the duration
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    auto us = (ns + 999) / 1000;
+    size_t bucket = 0;
+    while (bucket < METRICS_HISTOGRAM_BUCKETS && (uint64_t{1} << bucket) < us)
+    {
+        bucket++;
+    }
+
+    counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+    sumNs_.fetch_add(ns, std::memory_order_relaxed);
+}
+
+MetricHistogram::Snapshot MetricHistogram::snapshot() const
+{
+    Snapshot snap;
+    for (size_t i = 0; i < counts_.size(); i++)
+    {
+        snap.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        snap.count += snap.counts[i];
+    }
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    snap.sum = static_cast<double>(sumNs_.load(std::memory_order_relaxed)) * 1e-9;
+    return snap;
+}
+
+double MetricHistogram::upperBound(size_t bucket)
+{
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    return static_cast<double>(uint64_t{1} << bucket) * 1e-6;
+}
+
+MetricsRegistry &MetricsRegistry::shared()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+static std::string escapeLabel(const std::string &value)
+{
+    std::string escaped;
+    for (auto c : value)
+    {
+        switch (c)
+        {
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        default:
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// Without the braces, so that histograms can add `le`
+static std::string renderLabels(const MetricLabels &labels)
+{
+    std::string text;
+    for (const auto &label : labels)
+    {
+        text += text.empty() ? "" : ",";
+        text += label.first + "=\"" + escapeLabel(label.second) + "\"";
+    }
+    return text;
+}
+
+static std::string braced(const std::string &labels)
+{
+    return labels.empty() ? std::string() : "{" + labels + "}";
+}
+
+template <typename Metric>
+std::shared_ptr<Metric>
+MetricsRegistry::find(std::map<std::string, Family<Metric>> &families,
+                      const std::string &name, const std::string &help,
+                      const MetricLabels &labels)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &family = families[name];
+    if (family.help.empty())
+    {
+        family.help = help;
+    }
+
+    auto &series = family.series[renderLabels(labels)];
+    auto metric = series.lock();
+    if (metric == nullptr)
+    {
+        metric = std::make_shared<Metric>();
+        series = metric;
+    }
+    return metric;
+}
+
+std::shared_ptr<MetricCounter> MetricsRegistry::counter(const std::string &name,
+                                                        const std::string &help,
+                                                        const MetricLabels &labels)
+{
+    return find(counters_, name, help, labels);
+}
+
+std::shared_ptr<MetricGauge> MetricsRegistry::gauge(const std::string &name,
+                                                    const std::string &help,
+                                                    const MetricLabels &labels)
+{
+    return find(gauges_, name, help, labels);
+}
+
+std::shared_ptr<MetricHistogram> MetricsRegistry::histogram(const std::string &name,
+                                                            const std::string &help,
+                                                            const MetricLabels &labels)
+{
+    return find(histograms_, name, help, labels);
+}
+
+size_t MetricsRegistry::addCollector(std::function<void()> collector)
+{
+    std::lock_guard<std::mutex> lock(collectorsMutex_);
+    auto id = nextCollector_++;
+    collectors_[id] = std::move(collector);
+    return id;
+}
+
+void MetricsRegistry::removeCollector(size_t id)
+{
+    std::lock_guard<std::mutex> lock(collectorsMutex_);
+    collectors_.erase(id);
+}
+
+// Calls `render` for every live series of every family, dropping the dead ones
+template <typename Families, typename Render>
+static void renderFamilies(std::ostringstream &out, const char *type,
+                           Families &families, Render render)
+{
+    for (auto &family : families)
+    {
+        auto &series = family.second.series;
+        for (auto pos = series.begin(); pos != series.end();)
+        {
+            pos = pos->second.expired() ? series.erase(pos) : std::next(pos);
+        }
+        if (series.empty())
+        {
+            continue;
+        }
+
+        out << "# HELP " << family.first << " " << family.second.help << "\n";
+        out << "# TYPE " << family.first << " " << type << "\n";
+        for (const auto &elem : series)
+        {
+            auto metric = elem.second.lock();
+            if (metric != nullptr)
+            {
+                render(family.first, elem.first, *metric);
+            }
+        }
+    }
+}
+
+std::string MetricsRegistry::render()
+{
+    {
+        std::lock_guard<std::mutex> lock(collectorsMutex_);
+        for (const auto &collector : collectors_)
+        {
+            collector.second();
+        }
+    }
+
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    renderFamilies(out, "counter", counters_,
+                   [&](const std::string &name, const std::string &labels,
+                       const MetricCounter &metric) {
+                       out << name << braced(labels) << " " << metric.value() << "\n";
+                   });
+    renderFamilies(out, "gauge", gauges_,
+                   [&](const std::string &name, const std::string &labels,
+                       const MetricGauge &metric) {
+                       out << name << braced(labels) << " " << metric.value() << "\n";
+                   });
+    renderFamilies(
+        out, "histogram", histograms_,
+        [&](const std::string &name, const std::string &labels,
+            const MetricHistogram &metric) {
+            auto snap = metric.snapshot();
+            auto prefix = labels.empty() ? std::string() : labels + ",";
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+            {
+                cumulative += snap.counts[i];
+                out << name << "_bucket{" << prefix << "le=\""
+                    << MetricHistogram::upperBound(i) << "\"} " << cumulative << "\n";
+            }
+            out << name << "_bucket{" << prefix << "le=\"+Inf\"} " << snap.count << "\n";
+            out << name << "_sum" << braced(labels) << " " << snap.sum << "\n";
+            out << name << "_count" << braced(labels) << " " << snap.count << "\n";
+        });
+    return out.str();
+}
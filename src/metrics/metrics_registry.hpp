@@ -0,0 +1,159 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define METRICS_CACHE_LINE 64
+#define METRICS_HISTOGRAM_BUCKETS 24 // Powers of two from 1 us, the last one ~8 s
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+// Every metric is updated with relaxed atomics on its own cache line, and is meant to
+// have a single writer: each thread gets its own instance (one per source, one per
+// listener...), so updating never contends with another writer.
+class MetricCounter
+{
+  public:
+    void add(uint64_t n = 1)
+    {
+        value_.fetch_add(n, std::memory_order_relaxed);
+    };
+    // For collectors mirroring a counter that's kept elsewhere
+    void set(uint64_t value)
+    {
+        value_.store(value, std::memory_order_relaxed);
+    };
+    [[nodiscard]] uint64_t value() const
+    {
+        return value_.load(std::memory_order_relaxed);
+    };
+
+  private:
+    alignas(METRICS_CACHE_LINE) std::atomic<uint64_t> value_{0};
+};
+
+class MetricGauge
+{
+  public:
+    void set(double value)
+    {
+        value_.store(value, std::memory_order_relaxed);
+    };
+    [[nodiscard]] double value() const
+    {
+        return value_.load(std::memory_order_relaxed);
+    };
+
+  private:
+    alignas(METRICS_CACHE_LINE) std::atomic<double> value_{0};
+};
+
+// Latencies, in fixed power of two buckets so observing is a bit scan and an increment
+class MetricHistogram
+{
+  public:
+    void observe(std::chrono::nanoseconds duration);
+
+    struct Snapshot
+    {
+        std::array<uint64_t, METRICS_HISTOGRAM_BUCKETS + 1> counts{}; // The last: +Inf
+        uint64_t count{0};
+        double sum{0}; // s
+    };
+    [[nodiscard]] Snapshot snapshot() const;
+    // s
+    static double upperBound(size_t bucket);
+
+  private:
+    alignas(METRICS_CACHE_LINE)
+        std::array<std::atomic<uint64_t>, METRICS_HISTOGRAM_BUCKETS + 1> counts_{};
+    std::atomic<uint64_t> sumNs_{0};
+};
+
+// Times a scope into a histogram
+class MetricTimer
+{
+  public:
+    explicit MetricTimer(MetricHistogram *histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()){};
+    ~MetricTimer()
+    {
+        histogram_->observe(std::chrono::steady_clock::now() - start_);
+    };
+    MetricTimer(const MetricTimer &) = delete;
+    MetricTimer &operator=(const MetricTimer &) = delete;
+
+  private:
+    MetricHistogram *histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Where metrics are registered, by name and labels, and rendered for scraping.
+// Registering takes a lock and is meant for setup; the metrics it hands out are then
+// updated without one. The registry only holds on to them weakly: a metric goes away
+// with its last owner. Collectors run right before rendering, for values that are
+// cheaper to read on demand (such as `ISource::getStatistics`) than to keep updated.
+class MetricsRegistry
+{
+  public:
+    MetricsRegistry() = default;
+    ~MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry &) = delete;
+    MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+
+    static MetricsRegistry &shared();
+
+    // The same name and labels give back the same metric while it's alive
+    std::shared_ptr<MetricCounter> counter(const std::string &name,
+                                           const std::string &help,
+                                           const MetricLabels &labels = {});
+    std::shared_ptr<MetricGauge> gauge(const std::string &name, const std::string &help,
+                                       const MetricLabels &labels = {});
+    std::shared_ptr<MetricHistogram> histogram(const std::string &name,
+                                               const std::string &help,
+                                               const MetricLabels &labels = {});
+
+    size_t addCollector(std::function<void()> collector);
+    void removeCollector(size_t id);
+
+    // Prometheus text exposition format
+    std::string render();
+
+  private:
+    template <typename Metric> struct Family
+    {
+        std::string help;
+        std::map<std::string, std::weak_ptr<Metric>> series; // By rendered labels
+    };
+    template <typename Metric>
+    std::shared_ptr<Metric> find(std::map<std::string, Family<Metric>> &families,
+                                 const std::string &name, const std::string &help,
+                                 const MetricLabels &labels);
+
+    std::mutex mutex_;
+    std::map<std::string, Family<MetricCounter>> counters_;
+    std::map<std::string, Family<MetricGauge>> gauges_;
+    std::map<std::string, Family<MetricHistogram>> histograms_;
+
+    std::mutex collectorsMutex_;
+    size_t nextCollector_{0};
+    std::map<size_t, std::function<void()>> collectors_;
+};
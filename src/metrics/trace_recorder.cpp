@@ -0,0 +1,245 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "trace_recorder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <locale>
+#include <utility>
+
+TraceBuffer::TraceBuffer(size_t capacity, uint32_t threadId, std::string threadName,
+                         uint64_t generation)
+    : events_(std::max<size_t>(capacity, 1)), threadId_(threadId),
+      threadName_(std::move(threadName)), generation_(generation)
+{
+}
+
+std::vector<TraceEvent> TraceBuffer::events() const
+{
+    auto written = written_.load(std::memory_order_acquire);
+    auto capacity = events_.size();
+    auto first = written > capacity ? written - capacity : 0;
+
+    std::vector<TraceEvent> events;
+    events.reserve(static_cast<size_t>(written - first));
+    for (auto i = first; i < written; i++)
+    {
+        events.push_back(events_[i % capacity]);
+    }
+    return events;
+}
+
+// A thread as the recorder knows it. `name` is guarded by the recorder's mutex;
+// `prepared`, made by `start` for the thread to pick up, is only accessed atomically.
+struct TraceThread
+{
+    uint32_t id;
+    std::string name;
+    std::shared_ptr<TraceBuffer> prepared;
+};
+
+// What each thread knows about itself
+struct ThreadTrace
+{
+    std::shared_ptr<TraceThread> thread;
+    uint64_t generation{0};
+    std::shared_ptr<TraceBuffer> buffer;
+};
+
+static ThreadTrace &threadTrace()
+{
+    static std::atomic<uint32_t> nextId{1};
+    thread_local ThreadTrace trace{
+        std::make_shared<TraceThread>(
+            TraceThread{nextId.fetch_add(1, std::memory_order_relaxed), {}, nullptr}),
+        0, nullptr};
+    return trace;
+}
+
+static int64_t steadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+TraceRecorder &TraceRecorder::shared()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+void TraceRecorder::start(size_t eventsPerThread)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.clear();
+    eventsPerThread_ = eventsPerThread;
+    auto generation = generation_.load(std::memory_order_relaxed) + 1;
+
+    // Named threads are usually already in their hot loops: make their buffers here
+    threads_.erase(std::remove_if(threads_.begin(), threads_.end(),
+                                  [](const auto &thread) { return thread.expired(); }),
+                   threads_.end());
+    for (const auto &weak : threads_)
+    {
+        if (auto thread = weak.lock())
+        {
+            auto buffer = std::make_shared<TraceBuffer>(eventsPerThread_, thread->id,
+                                                        thread->name, generation);
+            buffers_.push_back(buffer);
+            std::atomic_store(&thread->prepared, std::move(buffer));
+        }
+    }
+
+    generation_.store(generation, std::memory_order_release);
+    epoch_.store(steadyNs(), std::memory_order_relaxed);
+    recording_.store(true, std::memory_order_release);
+}
+
+void TraceRecorder::stop()
+{
+    recording_.store(false, std::memory_order_release);
+}
+
+void TraceRecorder::nameThread(const std::string &name)
+{
+    auto &trace = threadTrace();
+    auto &recorder = shared();
+    std::lock_guard<std::mutex> lock(recorder.mutex_);
+    if (trace.thread->name.empty())
+    {
+        recorder.threads_.push_back(trace.thread);
+    }
+    trace.thread->name = name;
+
+    // Already recording: make the buffer now, unless `start` just did
+    auto generation = recorder.generation_.load(std::memory_order_relaxed);
+    if (recorder.isRecording() &&
+        (trace.buffer == nullptr || trace.generation != generation))
+    {
+        auto prepared = std::atomic_load(&trace.thread->prepared);
+        trace.buffer = prepared != nullptr && prepared->generation() == generation
+                           ? std::move(prepared)
+                           : recorder.makeBuffer(*trace.thread);
+        trace.generation = generation;
+    }
+}
+
+int64_t TraceRecorder::now() const
+{
+    return steadyNs() - epoch_.load(std::memory_order_relaxed);
+}
+
+void TraceRecorder::record(const TraceEvent &event)
+{
+    threadBuffer()->push(event);
+}
+
+// With the mutex held
+std::shared_ptr<TraceBuffer> TraceRecorder::makeBuffer(const TraceThread &thread)
+{
+    auto buffer = std::make_shared<TraceBuffer>(
+        eventsPerThread_, thread.id,
+        thread.name.empty() ? "thread " + std::to_string(thread.id) : thread.name,
+        generation_.load(std::memory_order_relaxed));
+    buffers_.push_back(buffer);
+    return buffer;
+}
+
+TraceBuffer *TraceRecorder::threadBuffer()
+{
+    auto &trace = threadTrace();
+    auto generation = generation_.load(std::memory_order_acquire);
+    if (trace.buffer == nullptr || trace.generation != generation)
+    {
+        // Once per thread and recording. Made by `start` or `nameThread` if the thread
+        // was named; otherwise here, on its first event.
+        auto prepared = std::atomic_load(&trace.thread->prepared);
+        if (prepared != nullptr && prepared->generation() == generation)
+        {
+            trace.buffer = std::move(prepared);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            trace.buffer = makeBuffer(*trace.thread);
+        }
+        trace.generation = trace.buffer->generation();
+    }
+    return trace.buffer.get();
+}
+
+static std::string escapeJson(const std::string &text)
+{
+    std::string escaped;
+    for (auto c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool TraceRecorder::writeChromeTrace(const std::string &path)
+{
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffers = buffers_;
+    }
+
+    std::ofstream out(path);
+    if (!out)
+    {
+        return false;
+    }
+    out.imbue(std::locale::classic());
+    out << std::fixed << std::setprecision(3);
+
+    // Timestamps are in us
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    auto toUs = [](int64_t ns) { return static_cast<double>(ns) * 1e-3; };
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    auto first = true;
+    for (const auto &buffer : buffers)
+    {
+        out << (first ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)"
+            << buffer->threadId() << R"(,"args":{"name":")"
+            << escapeJson(buffer->threadName()) << "\"}}";
+        first = false;
+
+        for (const auto &event : buffer->events())
+        {
+            out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                << "\",\"ph\":\"" << event.phase << "\",\"ts\":" << toUs(event.start)
+                << ",\"pid\":1,\"tid\":" << buffer->threadId();
+            if (event.phase == 'X')
+            {
+                out << ",\"dur\":" << toUs(event.duration);
+            }
+            else if (event.phase == 'i')
+            {
+                out << R"(,"s":"t")";
+            }
+            if (event.argName != nullptr)
+            {
+                out << ",\"args\":{\"" << event.argName << "\":" << event.arg << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,169 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define TRACE_EVENTS_PER_THREAD 65536 // The most recent ones are kept
+
+// Names, categories and argument names must be string literals: only the pointers are
+// recorded.
+struct TraceEvent
+{
+    const char *name;
+    const char *category;
+    char phase;       // 'X' complete, 'i' instant, 'C' counter
+    int64_t start;    // ns since the recorder started
+    int64_t duration; // ns
+    const char *argName;
+    int64_t arg;
+};
+
+// The events of one thread, in a ring only that thread writes to
+class TraceBuffer
+{
+  public:
+    TraceBuffer(size_t capacity, uint32_t threadId, std::string threadName,
+                uint64_t generation);
+
+    void push(const TraceEvent &event)
+    {
+        auto written = written_.load(std::memory_order_relaxed);
+        events_[written % events_.size()] = event;
+        written_.store(written + 1, std::memory_order_release);
+    };
+    // Oldest first
+    [[nodiscard]] std::vector<TraceEvent> events() const;
+    [[nodiscard]] uint32_t threadId() const
+    {
+        return threadId_;
+    };
+    [[nodiscard]] const std::string &threadName() const
+    {
+        return threadName_;
+    };
+    // The recording it belongs to
+    [[nodiscard]] uint64_t generation() const
+    {
+        return generation_;
+    };
+
+  private:
+    std::vector<TraceEvent> events_;
+    std::atomic<uint64_t> written_{0};
+    uint32_t threadId_;
+    std::string threadName_;
+    uint64_t generation_;
+};
+
+struct TraceThread;
+
+// Optional tracing of the pipeline, dumped in the Chrome trace event format (which
+// Perfetto's UI and chrome://tracing both open).
+// While stopped, recording an event is a relaxed load and a branch. While started, each
+// thread records into its own buffer, so recording never locks nor contends. Named
+// threads get theirs when named, or on `start` if they were named before; the others on
+// their first event. Buffers keep the latest `eventsPerThread` events and outlive their
+// threads. Dump once the pipeline is stopped: events still being recorded meanwhile may
+// come out torn.
+class TraceRecorder
+{
+  public:
+    TraceRecorder() = default;
+    ~TraceRecorder() = default;
+    TraceRecorder(const TraceRecorder &) = delete;
+    TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+    static TraceRecorder &shared();
+
+    // Drops whatever was recorded before
+    void start(size_t eventsPerThread = TRACE_EVENTS_PER_THREAD);
+    void stop();
+    [[nodiscard]] bool isRecording() const
+    {
+        return recording_.load(std::memory_order_relaxed);
+    };
+
+    // Of the calling thread, shown in the trace. Can be set before recording starts.
+    // Call it before the thread's hot loop: it also makes the thread's buffer.
+    static void nameThread(const std::string &name);
+
+    [[nodiscard]] int64_t now() const;
+    void record(const TraceEvent &event);
+
+    bool writeChromeTrace(const std::string &path);
+
+  private:
+    std::atomic<bool> recording_{false};
+    std::atomic<int64_t> epoch_{0}; // steady_clock ns
+
+    std::mutex mutex_;
+    size_t eventsPerThread_{TRACE_EVENTS_PER_THREAD};
+    std::atomic<uint64_t> generation_{0}; // Bumped on start, so threads make new buffers
+    std::vector<std::shared_ptr<TraceBuffer>> buffers_;
+    std::vector<std::weak_ptr<TraceThread>> threads_; // Named ones
+    std::shared_ptr<TraceBuffer> makeBuffer(const TraceThread &thread);
+    TraceBuffer *threadBuffer();
+};
+
+// Records the scope it lives in as one complete event
+class TraceScope
+{
+  public:
+    explicit TraceScope(const char *name, const char *category,
+                        const char *argName = nullptr, int64_t arg = 0)
+    {
+        auto &recorder = TraceRecorder::shared();
+        if (recorder.isRecording())
+        {
+            event_ = {name, category, 'X', recorder.now(), 0, argName, arg};
+            active_ = true;
+        }
+    };
+    ~TraceScope()
+    {
+        if (active_)
+        {
+            auto &recorder = TraceRecorder::shared();
+            event_.duration = recorder.now() - event_.start;
+            recorder.record(event_);
+        }
+    };
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+  private:
+    TraceEvent event_{};
+    bool active_{false};
+};
+
+inline void traceInstant(const char *name, const char *category,
+                         const char *argName = nullptr, int64_t arg = 0)
+{
+    auto &recorder = TraceRecorder::shared();
+    if (recorder.isRecording())
+    {
+        recorder.record({name, category, 'i', recorder.now(), 0, argName, arg});
+    }
+}
+
+inline void traceCounter(const char *name, const char *category, int64_t value)
+{
+    auto &recorder = TraceRecorder::shared();
+    if (recorder.isRecording())
+    {
+        recorder.record({name, category, 'C', recorder.now(), 0, "value", value});
+    }
+}
@@ -0,0 +1,265 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "soapysdr_capability_cache.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <utility>
+
+SoapySdrCapabilityCache::SoapySdrCapabilityCache(QString path)
+    : path_(std::move(path)), loaded_(false)
+{
+}
+
+QString SoapySdrCapabilityCache::defaultPath()
+{
+    auto dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return qEnvironmentVariable(SOAPY_CACHE_ENV, dir + "/" + SOAPY_CACHE_FILE_NAME);
+}
+
+QString SoapySdrCapabilityCache::deviceKey(const QString &deviceString, size_t channel)
+{
+    // The serial survives replugging and reordering; the rest of the kwargs may not
+    QString driver;
+    QString serial;
+    for (const auto &pair : deviceString.split(','))
+    {
+        auto equals = pair.indexOf('=');
+        auto key = pair.left(equals).trimmed();
+        if (key == "driver")
+        {
+            driver = pair.mid(equals + 1).trimmed();
+        }
+        else if (key == "serial")
+        {
+            serial = pair.mid(equals + 1).trimmed();
+        }
+    }
+
+    auto identity = serial.isEmpty() ? deviceString.trimmed()
+                                     : "driver=" + driver + ", serial=" + serial;
+    return identity + " @" + QString::number(channel);
+}
+
+static QJsonArray rangesToJson(const std::vector<SoapySDRRange> &ranges)
+{
+    QJsonArray array;
+    for (const auto &range : ranges)
+    {
+        array.append(QJsonArray{range.minimum, range.maximum, range.step});
+    }
+    return array;
+}
+
+static SoapySDRRange rangeFromJson(const QJsonValue &value)
+{
+    auto array = value.toArray();
+    return {array[0].toDouble(), array[1].toDouble(), array[2].toDouble()};
+}
+
+static std::vector<SoapySDRRange> rangesFromJson(const QJsonValue &value)
+{
+    std::vector<SoapySDRRange> ranges;
+    for (const auto &range : value.toArray())
+    {
+        ranges.push_back(rangeFromJson(range));
+    }
+    return ranges;
+}
+
+template <typename T> static QJsonArray listToJson(const std::vector<T> &list)
+{
+    QJsonArray array;
+    for (const auto &elem : list)
+    {
+        array.append(elem);
+    }
+    return array;
+}
+
+QJsonObject SoapySdrCapabilityCache::toJson(const SoapySdrDeviceInfo &info)
+{
+    QJsonObject gainRanges;
+    for (const auto &gain : info.specificGainsRanges)
+    {
+        auto range = gain.second;
+        gainRanges[gain.first] = QJsonArray{range.minimum, range.maximum, range.step};
+    }
+    QJsonObject gains;
+    for (const auto &gain : info.specificGains)
+    {
+        gains[gain.first] = gain.second;
+    }
+
+    auto globalGainRange = info.globalGainRange;
+    return QJsonObject{
+        {"channel_count", static_cast<double>(info.channelCount)},
+        {"antennas", listToJson(info.antennas)},
+        {"antenna", info.antenna},
+        {"stream_formats", listToJson(info.streamFormats)},
+        {"native_stream_format", info.nativeStreamFormat},
+        {"native_full_scale", info.nativeFullScale},
+        {"sample_rates", listToJson(info.sampleRatesDiscrete)},
+        {"sample_rate_ranges", rangesToJson(info.sampleRatesRanges)},
+        {"bandwidths", listToJson(info.bandwidthsDiscrete)},
+        {"bandwidth_ranges", rangesToJson(info.bandwidthsRanges)},
+        {"agc_available", info.agcAvailable},
+        {"agc", info.agc},
+        {"gain_range",
+         QJsonArray{globalGainRange.minimum, globalGainRange.maximum,
+                    globalGainRange.step}},
+        {"gain", info.globalGain},
+        {"gain_element_ranges", gainRanges},
+        {"gain_elements", gains}};
+}
+
+SoapySdrDeviceInfo SoapySdrCapabilityCache::fromJson(const QJsonObject &json)
+{
+    SoapySdrDeviceInfo info;
+    info.channelCount = static_cast<size_t>(json["channel_count"].toDouble());
+    for (const auto &antenna : json["antennas"].toArray())
+    {
+        info.antennas.push_back(antenna.toString());
+    }
+    info.antenna = json["antenna"].toString();
+    for (const auto &format : json["stream_formats"].toArray())
+    {
+        info.streamFormats.push_back(format.toString());
+    }
+    info.nativeStreamFormat = json["native_stream_format"].toString();
+    info.nativeFullScale = json["native_full_scale"].toDouble();
+    for (const auto &sampleRate : json["sample_rates"].toArray())
+    {
+        info.sampleRatesDiscrete.push_back(sampleRate.toDouble());
+    }
+    info.sampleRatesRanges = rangesFromJson(json["sample_rate_ranges"]);
+    for (const auto &bandwidth : json["bandwidths"].toArray())
+    {
+        info.bandwidthsDiscrete.push_back(bandwidth.toDouble());
+    }
+    info.bandwidthsRanges = rangesFromJson(json["bandwidth_ranges"]);
+    info.agcAvailable = json["agc_available"].toBool();
+    info.agc = json["agc"].toBool();
+    info.globalGainRange = rangeFromJson(json["gain_range"]);
+    info.globalGain = json["gain"].toDouble();
+
+    auto gainRanges = json["gain_element_ranges"].toObject();
+    for (auto it = gainRanges.begin(); it != gainRanges.end(); it++)
+    {
+        info.specificGainsRanges[it.key()] = rangeFromJson(it.value());
+    }
+    auto gains = json["gain_elements"].toObject();
+    for (auto it = gains.begin(); it != gains.end(); it++)
+    {
+        info.specificGains[it.key()] = it.value().toDouble();
+    }
+    return info;
+}
+
+void SoapySdrCapabilityCache::load()
+{
+    loaded_ = true;
+    if (path_.isEmpty())
+    {
+        return;
+    }
+
+    QFile file(path_);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return; // Nothing cached yet
+    }
+
+    QJsonParseError error{};
+    auto document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (document.isNull())
+    {
+        qDebug() << "Ignoring the device cache " << path_ << ": " << error.errorString();
+        return;
+    }
+
+    // Anything written by another version is probed again
+    if (document.object()["version"].toInt() != SOAPY_CACHE_VERSION)
+    {
+        return;
+    }
+    devices_ = document.object()["devices"].toObject();
+}
+
+void SoapySdrCapabilityCache::save()
+{
+    if (path_.isEmpty())
+    {
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(path_).absolutePath());
+
+    // Written aside and renamed over, so a crash never leaves half a cache behind
+    QSaveFile file(path_);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Couldn't write the device cache " << path_ << ": "
+                 << file.errorString();
+        return;
+    }
+
+    QJsonObject root{{"version", SOAPY_CACHE_VERSION}, {"devices", devices_}};
+    file.write(QJsonDocument(root).toJson());
+    if (!file.commit())
+    {
+        qDebug() << "Couldn't write the device cache " << path_ << ": "
+                 << file.errorString();
+    }
+}
+
+std::optional<SoapySdrDeviceInfo> SoapySdrCapabilityCache::find(
+    const QString &deviceString, size_t channel)
+{
+    if (!loaded_)
+    {
+        load();
+    }
+
+    auto key = deviceKey(deviceString, channel);
+    if (!devices_.contains(key))
+    {
+        return std::nullopt;
+    }
+    return fromJson(devices_[key].toObject());
+}
+
+bool SoapySdrCapabilityCache::store(const QString &deviceString, size_t channel,
+                                    const SoapySdrDeviceInfo &info)
+{
+    if (!loaded_)
+    {
+        load();
+    }
+
+    auto key = deviceKey(deviceString, channel);
+    auto json = toJson(info);
+    if (devices_[key].toObject() == json)
+    {
+        return false;
+    }
+
+    devices_[key] = json;
+    save();
+    return true;
+}
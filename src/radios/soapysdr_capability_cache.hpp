@@ -0,0 +1,47 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "soapysdr_device_info.hpp"
+
+#include <QJsonObject>
+#include <QString>
+
+#include <optional>
+
+// What was probed from every device ever opened, kept on disk so that reopening a known
+// device doesn't wait for the slow probe. Entries are keyed by device identity (driver
+// and serial when there is one, all the kwargs otherwise) and channel. Not thread safe:
+// the radio only uses it from its device thread.
+class SoapySdrCapabilityCache
+{
+  public:
+    // An empty path keeps the cache in memory only
+    explicit SoapySdrCapabilityCache(QString path);
+    SoapySdrCapabilityCache() = delete;
+
+    // The file is read on first use
+    std::optional<SoapySdrDeviceInfo> find(const QString &deviceString, size_t channel);
+    // Returns false if `info` was already cached as it is; the file is only rewritten
+    // when something changed
+    bool store(const QString &deviceString, size_t channel,
+               const SoapySdrDeviceInfo &info);
+
+    [[nodiscard]] static QString defaultPath();
+    [[nodiscard]] static QString deviceKey(const QString &deviceString, size_t channel);
+    [[nodiscard]] static QJsonObject toJson(const SoapySdrDeviceInfo &info);
+    [[nodiscard]] static SoapySdrDeviceInfo fromJson(const QJsonObject &json);
+
+  private:
+    QString path_;
+    bool loaded_;
+    QJsonObject devices_; // Key: info
+    void load();
+    void save();
+};
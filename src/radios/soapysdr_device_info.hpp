@@ -0,0 +1,55 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "soapysdr_types.hpp"
+
+#include <QString>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Everything read from a device when it's opened, for the channel being configured.
+// Gathering it takes many driver calls, so it's done away from the GUI thread.
+struct SoapySdrDeviceInfo
+{
+    size_t channelCount{0};
+    std::vector<QString> antennas;
+    QString antenna;
+    std::vector<QString> streamFormats; // Only the ones we can convert
+    QString nativeStreamFormat;
+    double nativeFullScale{0};
+    std::vector<double> sampleRatesDiscrete;
+    std::vector<SoapySDRRange> sampleRatesRanges;
+    std::vector<double> bandwidthsDiscrete;
+    std::vector<SoapySDRRange> bandwidthsRanges;
+    bool agcAvailable{false};
+    bool agc{false};
+    SoapySDRRange globalGainRange{0, 0, 0};
+    double globalGain{0};
+    std::map<QString, SoapySDRRange> specificGainsRanges;
+    std::map<QString, double> specificGains;
+};
+
+// What the device was last set to, as published for readers on any thread
+struct SoapySdrState
+{
+    bool running{false};
+    size_t channel{0};
+    std::vector<size_t> channels; // Streamed
+    QString antenna;
+    double centreFrequency{0};
+    double sampleRate{0};
+    double bandwidth{0};
+    bool agc{false};
+    double globalGain{0};
+    std::map<QString, double> specificGains;
+    uint64_t controls{0}; // Control changes applied up to this state
+};
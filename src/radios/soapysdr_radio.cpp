@@ -9,22 +9,38 @@
 #include "soapysdr_radio.hpp"
 
 #include "qdebug.h"
+#include "sample_conversion.hpp"
 #include "soapysdr_widget.hpp"
+#include "thread_scheduling.hpp"
+#include "trace_recorder.hpp"
 
 #include <QDebug>
+#include <QJsonArray>
 #include <QVersionNumber>
+#include <QtGlobal>
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <memory>
+#include <utility>
 
 // NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init, hicpp-member-init)
 SoapySdrRadio::SoapySdrRadio()
-    : sdr_(nullptr), worker_(nullptr), running_(false), channelCount_(0), channel_(0),
-      centreFrequency_(SOAPY_INITIAL_CENTRE_FREQUENCY),
-      sampleRate_(SOAPY_INITIAL_SAMPLE_RATE), bandwidth_(SOAPY_INITIAL_SAMPLE_RATE),
-      agcAvailable_(false), agc_(false), globalGainRange_{0, 0, 0}, globalGain_(0),
-      widget_(nullptr), library_(SOAPY_LIBRARY_NAME), initialised_(initialiseLibrary())
+    : devicesEnumerated_(false), sdr_(nullptr), deviceRequest_(0),
+      capabilityCache_(SoapySdrCapabilityCache::defaultPath()), worker_(nullptr),
+      running_(false), dispatcher_(nullptr), acquiring_(false), overflows_(0),
+      timeouts_(0), streamErrors_(0), channelCount_(0), channel_(0), nativeFullScale_(0),
+      streamFormat_(SOAPY_SDR_CF32), centreFrequency_(SOAPY_INITIAL_CENTRE_FREQUENCY),
+      retuneSettle_(0), retunes_(0), sampleRate_(SOAPY_INITIAL_SAMPLE_RATE),
+      bandwidth_(SOAPY_INITIAL_SAMPLE_RATE), agcAvailable_(false), agc_(false),
+      globalGainRange_{0, 0, 0}, globalGain_(0), controls_(SOAPY_CONTROL_MAILBOX),
+      controlsSubmitted_(0), consuming_(false), waiting_(0), widget_(nullptr),
+      library_(qEnvironmentVariable(SOAPY_LIBRARY_ENV, SOAPY_LIBRARY_NAME)),
+      initialised_(initialiseLibrary())
 {
+    state_ = std::make_shared<const SoapySdrState>(makeState());
+
     if (!initialised_)
     {
         qDebug() << "Couldn't load the runtime library!";
@@ -42,117 +58,307 @@ SoapySdrRadio::SoapySdrRadio()
         return;
     }
 
-    widget_ = std::make_unique<SoapySdrWidget>(this);
-
-    discoverDevices();
+    // Enumerating can take seconds (network devices, USB timeouts): the widget fills in
+    // once it's done
+    discoverDevicesAsync();
+    deviceTasks_.setIdleTask(std::chrono::milliseconds(SOAPY_HOTPLUG_INTERVAL),
+                             [this]() { pollHotplug(); });
 }
 
 SoapySdrRadio::~SoapySdrRadio()
 {
+    // Let the device thread finish what it's doing before anything goes away
+    deviceTasks_.stop();
     stop();
+
+    // Pending closes, devices opened for a stale request and the current one; the
+    // device thread is gone, so this is the only thread left calling the driver
+    auto openDevices = std::exchange(openDevices_, {});
+    for (auto *sdr : openDevices)
+    {
+        closeDevice(sdr);
+    }
 }
 
-void SoapySdrRadio::discoverDevices()
+static SampleFormat toSampleFormat(const QString &format)
 {
-    if (!initialised_)
+    if (format == SOAPY_SDR_CS16)
     {
-        qDebug() << "Function `discoverDevices` not called for failing to load DLL.";
-        return;
+        return SampleFormat::CS16;
     }
-
-    if (running_)
+    if (format == SOAPY_SDR_CS8)
     {
-        qDebug() << "Can't discover devices while running.";
-        return;
+        return SampleFormat::CS8;
     }
+    return SampleFormat::CF32;
+}
 
-    sdr_ = nullptr;
+void SoapySdrRadio::postToOwner(std::function<void()> task)
+{
+    // Posted events die with `owner_`, so this never outlives the radio
+    QMetaObject::invokeMethod(&owner_, std::move(task), Qt::QueuedConnection);
+}
 
+std::map<QString, QString> SoapySdrRadio::enumerateDevices()
+{
     size_t ndevs(0);
-    auto *devs_found = SoapySDRDevice_enumerate(nullptr, &ndevs);
-
-    devicesFound_.clear();
-    devicesFound_.assign(devs_found, devs_found + ndevs);
+    auto *devsFound = SoapySDRDevice_enumerate(nullptr, &ndevs);
 
-    deviceStrings_.clear();
-    for (const auto &devf : devicesFound_)
+    std::map<QString, QString> deviceStrings;
+    for (auto i = 0U; i < ndevs; i++)
     {
-        deviceStrings_[QString::fromLocal8Bit(SoapySDRKwargs_get(&devf, "label"))] =
-            QString::fromLocal8Bit(SoapySDRKwargs_toString(&devf));
+        auto label = QString::fromLocal8Bit(SoapySDRKwargs_get(&devsFound[i], "label"));
+        deviceStrings[label] =
+            QString::fromLocal8Bit(SoapySDRKwargs_toString(&devsFound[i]));
     }
 
-    SoapySDRKwargsList_clear(devs_found, ndevs);
+    SoapySDRKwargsList_clear(devsFound, ndevs);
+    return deviceStrings;
+}
+
+void SoapySdrRadio::devicesDiscovered(const std::map<QString, QString> &deviceStrings)
+{
+    deviceStrings_ = deviceStrings;
+    devicesEnumerated_ = true;
 
-    widget_->devicesDiscovered();
+    if (widget_ != nullptr)
+    {
+        widget_->devicesDiscovered();
+    }
 }
 
-void SoapySdrRadio::readDevice()
+void SoapySdrRadio::discoverDevicesAsync()
 {
     if (!initialised_)
     {
-        qDebug() << "Function `readDevice` not called for failing to load DLL.";
+        qDebug() << "Function `discoverDevicesAsync` not called for failing to load DLL.";
         return;
     }
 
-    if (sdr_ == nullptr)
+    if (running_)
     {
-        qDebug() << "No device to read.";
+        qDebug() << "Can't discover devices while running.";
+        return;
+    }
+
+    deviceTasks_.post([this]() {
+        auto deviceStrings = enumerateDevices();
+        postToOwner([this, deviceStrings]() { devicesDiscovered(deviceStrings); });
+    });
+}
+
+void SoapySdrRadio::discoverDevices()
+{
+    if (!initialised_)
+    {
+        qDebug() << "Function `discoverDevices` not called for failing to load DLL.";
         return;
     }
 
     if (running_)
     {
-        qDebug() << "Can't read devices while running.";
+        qDebug() << "Can't discover devices while running.";
         return;
     }
 
-    // Channels
-    channelCount_ = SoapySDRDevice_getNumChannels(sdr_, SOAPY_SDR_RX);
-    if (channel_ > channelCount_)
+    devicesDiscovered(deviceTasks_.call([this]() { return enumerateDevices(); }));
+}
+
+void SoapySdrRadio::pollHotplug()
+{
+    // Some drivers don't like being enumerated while they stream
+    if (acquiring_)
     {
-        channel_ = 0;
+        return;
     }
 
+    // Only bother the widget when a device came or went
+    auto deviceStrings = enumerateDevices();
+    postToOwner([this, deviceStrings]() {
+        if (!running_ && deviceStrings != deviceStrings_)
+        {
+            qDebug() << "Devices changed, found " << deviceStrings.size() << ".";
+            devicesDiscovered(deviceStrings);
+        }
+    });
+}
+
+SoapySDRDevice *SoapySdrRadio::openDevice(const QString &sourceString)
+{
+    // Try to make the device. This can fail because I'll allow the widget to give invalid
+    // input.
+    auto *sdr = SoapySDRDevice_makeStrArgs(sourceString.toLocal8Bit());
+    if (sdr == nullptr)
+    {
+        qDebug() << "SoapySDRDevice_makeStrArgs failed: " << SoapySDRDevice_lastError();
+        return nullptr;
+    }
+    openDevices_.insert(sdr);
+    return sdr;
+}
+
+size_t SoapySdrRadio::validChannel(SoapySDRDevice *sdr, size_t channel)
+{
+    return channel < SoapySDRDevice_getNumChannels(sdr, SOAPY_SDR_RX) ? channel : 0;
+}
+
+void SoapySdrRadio::tuneDevice(SoapySDRDevice *sdr, size_t channel,
+                               const std::vector<size_t> &channels,
+                               double centreFrequency)
+{
+    // Every channel that's going to stream
+    auto channelCount = SoapySDRDevice_getNumChannels(sdr, SOAPY_SDR_RX);
+    auto tuned = channels.empty() ? std::vector<size_t>{channel} : channels;
+    for (auto chan : tuned)
+    {
+        if (chan >= channelCount)
+        {
+            continue;
+        }
+        auto res = SoapySDRDevice_setFrequency(sdr, SOAPY_SDR_RX, chan, centreFrequency,
+                                               nullptr);
+        if (res != 0)
+        {
+            qDebug() << "SoapySDRDevice_setFrequency failed with error: "
+                     << SoapySDRDevice_lastError();
+        }
+    }
+}
+
+SoapySdrDeviceInfo SoapySdrRadio::probeDevice(SoapySDRDevice *sdr, size_t channel)
+{
+    SoapySdrDeviceInfo info;
+
+    // Channels
+    info.channelCount = SoapySDRDevice_getNumChannels(sdr, SOAPY_SDR_RX);
+
     // Antennas
-    availableAntennas_.clear();
     size_t nant(0);
     auto *antennaCharList =
-        SoapySDRDevice_listAntennas(sdr_, SOAPY_SDR_RX, channel_, &nant);
+        SoapySDRDevice_listAntennas(sdr, SOAPY_SDR_RX, channel, &nant);
     for (auto j = 0U; j < nant; j++)
     {
-        availableAntennas_.emplace_back(antennaCharList[j]);
+        info.antennas.emplace_back(antennaCharList[j]);
     }
 
-    antenna_ = QString{SoapySDRDevice_getAntenna(sdr_, SOAPY_SDR_RX, channel_)};
+    info.antenna = QString{SoapySDRDevice_getAntenna(sdr, SOAPY_SDR_RX, channel)};
 
-    // Frequency
-    auto res = SoapySDRDevice_setFrequency(sdr_, SOAPY_SDR_RX, channel_, centreFrequency_,
-                                           nullptr);
-    if (res != 0)
+    // Stream formats: only the ones we know how to convert, preferring the native one
+    size_t nformats(0);
+    auto *formats =
+        SoapySDRDevice_getStreamFormats(sdr, SOAPY_SDR_RX, channel, &nformats);
+    for (auto j = 0U; j < nformats; j++)
     {
-        qDebug() << "SoapySDRDevice_setFrequency failed with error: "
-                 << SoapySDRDevice_lastError();
+        QString format{formats[j]};
+        if (format == SOAPY_SDR_CF32 || format == SOAPY_SDR_CS16 ||
+            format == SOAPY_SDR_CS8)
+        {
+            info.streamFormats.push_back(format);
+        }
+    }
+    if (std::none_of(info.streamFormats.begin(), info.streamFormats.end(),
+                     [](const QString &format) { return format == SOAPY_SDR_CF32; }))
+    {
+        info.streamFormats.emplace_back(SOAPY_SDR_CF32); // Always offered by Soapy
     }
 
-    // Sample rate
-    supportedSampleRatesDiscrete_.clear();
-    supportedSampleRatesRanges_.clear();
+    info.nativeStreamFormat = QString{SoapySDRDevice_getNativeStreamFormat(
+        sdr, SOAPY_SDR_RX, channel, &info.nativeFullScale)};
 
+    // Sample rate
     size_t nfss(0);
-    auto *fsranges =
-        SoapySDRDevice_getSampleRateRange(sdr_, SOAPY_SDR_RX, channel_, &nfss);
+    auto *fsranges = SoapySDRDevice_getSampleRateRange(sdr, SOAPY_SDR_RX, channel, &nfss);
     for (auto j = 0U; j < nfss; j++)
     {
         if (fsranges[j].minimum == fsranges[j].maximum)
         {
-            supportedSampleRatesDiscrete_.push_back(fsranges[j].minimum);
+            info.sampleRatesDiscrete.push_back(fsranges[j].minimum);
+        }
+        else
+        {
+            info.sampleRatesRanges.push_back(fsranges[j]);
+        }
+    }
+
+    // Bandwidth
+    size_t nbws(0);
+    auto *bwranges = SoapySDRDevice_getBandwidthRange(sdr, SOAPY_SDR_RX, channel, &nbws);
+    for (auto j = 0U; j < nbws; j++)
+    {
+        if (bwranges[j].minimum == bwranges[j].maximum)
+        {
+            info.bandwidthsDiscrete.push_back(bwranges[j].minimum);
         }
         else
         {
-            supportedSampleRatesRanges_.push_back(fsranges[j]);
+            info.bandwidthsRanges.push_back(bwranges[j]);
         }
     }
 
+    // AGC
+    info.agcAvailable = SoapySDRDevice_hasGainMode(sdr, SOAPY_SDR_RX, channel);
+    info.agc = SoapySDRDevice_getGainMode(sdr, SOAPY_SDR_RX, channel);
+
+    // Global gain
+    info.globalGainRange = SoapySDRDevice_getGainRange(sdr, SOAPY_SDR_RX, channel);
+    info.globalGain = SoapySDRDevice_getGain(sdr, SOAPY_SDR_RX, channel);
+
+    // Specific gains
+    size_t ngainstages(0);
+    auto *gainNames = SoapySDRDevice_listGains(sdr, SOAPY_SDR_RX, channel, &ngainstages);
+    for (auto j = 0U; j < ngainstages; j++)
+    {
+        info.specificGainsRanges[gainNames[j]] =
+            SoapySDRDevice_getGainElementRange(sdr, SOAPY_SDR_RX, channel, gainNames[j]);
+        info.specificGains[gainNames[j]] =
+            SoapySDRDevice_getGainElement(sdr, SOAPY_SDR_RX, channel, gainNames[j]);
+    }
+
+    return info;
+}
+
+void SoapySdrRadio::closeDevice(SoapySDRDevice *sdr)
+{
+    openDevices_.erase(sdr);
+    auto err = SoapySDRDevice_unmake(sdr);
+    if (err != 0)
+    {
+        qDebug() << "SoapySDRDevice_unmake fail: " << SoapySDRDevice_lastError();
+    }
+}
+
+void SoapySdrRadio::deviceOpened(SoapySDRDevice *sdr, const SoapySdrDeviceInfo &info)
+{
+    sdr_ = sdr;
+
+    // Channels
+    channelCount_ = info.channelCount;
+    if (channel_ >= channelCount_)
+    {
+        channel_ = 0;
+    }
+
+    // Antennas
+    availableAntennas_ = info.antennas;
+    antenna_ = info.antenna;
+
+    // Stream formats
+    supportedStreamFormats_ = info.streamFormats;
+    nativeFullScale_ = info.nativeFullScale;
+    nativeStreamFormat_ = info.nativeStreamFormat;
+    streamFormat_ = SOAPY_SDR_CF32;
+    setStreamFormat(nativeStreamFormat_);
+
+    // Only keep the streamed channels the new device has
+    streamChannels_.erase(
+        std::remove_if(streamChannels_.begin(), streamChannels_.end(),
+                       [&](size_t chan) { return chan >= channelCount_; }),
+        streamChannels_.end());
+
+    // Sample rate
+    supportedSampleRatesDiscrete_ = info.sampleRatesDiscrete;
+    supportedSampleRatesRanges_ = info.sampleRatesRanges;
+
     if (!validateSampleRate(sampleRate_))
     {
         if (!supportedSampleRatesDiscrete_.empty())
@@ -173,56 +379,66 @@ void SoapySdrRadio::readDevice()
     }
 
     // Bandwidth
-    supportedBandwidthsDiscrete_.clear();
-    supportedBandwidthsRanges_.clear();
-
-    size_t nbws(0);
-    auto *bwranges =
-        SoapySDRDevice_getBandwidthRange(sdr_, SOAPY_SDR_RX, channel_, &nbws);
-    for (auto j = 0U; j < nbws; j++)
-    {
-        if (bwranges[j].minimum == bwranges[j].maximum)
-        {
-            supportedBandwidthsDiscrete_.push_back(bwranges[j].minimum);
-        }
-        else
-        {
-            supportedBandwidthsRanges_.push_back(bwranges[j]);
-        }
-    }
+    supportedBandwidthsDiscrete_ = info.bandwidthsDiscrete;
+    supportedBandwidthsRanges_ = info.bandwidthsRanges;
 
     // AGC
-    agcAvailable_ = SoapySDRDevice_hasGainMode(sdr_, SOAPY_SDR_RX, channel_);
-    agc_ = SoapySDRDevice_getGainMode(sdr_, SOAPY_SDR_RX, channel_);
+    agcAvailable_ = info.agcAvailable;
+    agc_ = info.agc;
 
     // Global gain
-    globalGainRange_ = SoapySDRDevice_getGainRange(sdr_, SOAPY_SDR_RX, channel_);
-    globalGain_ = SoapySDRDevice_getGain(sdr_, SOAPY_SDR_RX, channel_);
+    globalGainRange_ = info.globalGainRange;
+    globalGain_ = info.globalGain;
 
     // Specific gains
-    specificGainsRanges_.clear();
-    specificGains_.clear();
-    size_t ngainstages(0);
-    auto *gainNames =
-        SoapySDRDevice_listGains(sdr_, SOAPY_SDR_RX, channel_, &ngainstages);
-    for (auto j = 0U; j < ngainstages; j++)
+    specificGainsRanges_ = info.specificGainsRanges;
+    specificGains_ = info.specificGains;
+
+    if (widget_ != nullptr)
     {
-        specificGainsRanges_[gainNames[j]] = SoapySDRDevice_getGainElementRange(
-            sdr_, SOAPY_SDR_RX, channel_, gainNames[j]);
-        specificGains_[gainNames[j]] =
-            SoapySDRDevice_getGainElement(sdr_, SOAPY_SDR_RX, channel_, gainNames[j]);
+        widget_->deviceRead();
     }
 
-    widget_->deviceRead();
-
     readjustBandwidth();
+    publishDevice();
 }
 
-void SoapySdrRadio::makeDevice(const QString &sourceString)
+void SoapySdrRadio::deviceValidated(SoapySDRDevice *sdr, const SoapySdrDeviceInfo &info)
+{
+    // Only if the device is still the one in use and can still be reconfigured
+    if (sdr != sdr_ || running_)
+    {
+        return;
+    }
+
+    qDebug() << "The device changed since it was cached, reading it again.";
+    deviceOpened(sdr, info);
+}
+
+void SoapySdrRadio::releaseDevice()
+{
+    if (sdr_ == nullptr)
+    {
+        return;
+    }
+
+    // Closing can take as long as opening, so it's queued like the rest
+    qDebug() << "Deleting previous SDR";
+    auto *sdr = std::exchange(sdr_, nullptr);
+    deviceTasks_.post([this, sdr]() { closeDevice(sdr); });
+    publishDevice();
+
+    if (widget_ != nullptr)
+    {
+        widget_->deviceDestroyed();
+    }
+}
+
+void SoapySdrRadio::makeDeviceAsync(const QString &sourceString)
 {
     if (!initialised_)
     {
-        qDebug() << "Function `makeDevice` not called for failing to load DLL.";
+        qDebug() << "Function `makeDeviceAsync` not called for failing to load DLL.";
         return;
     }
 
@@ -232,22 +448,91 @@ void SoapySdrRadio::makeDevice(const QString &sourceString)
         return;
     }
 
-    if (sdr_ != nullptr)
+    releaseDevice();
+
+    // Picking devices faster than they open only keeps the last one
+    auto request = ++deviceRequest_;
+    auto channel = channel_;
+    auto channels = streamChannels_;
+    auto centreFrequency = centreFrequency_.load();
+    auto open = [this, sourceString, request, channel, channels, centreFrequency]() {
+        auto *sdr = openDevice(sourceString);
+        if (sdr == nullptr)
+        {
+            return;
+        }
+
+        auto probed = validChannel(sdr, channel);
+        tuneDevice(sdr, probed, channels, centreFrequency);
+
+        // A known device is shown with what it had last time; probing it again only
+        // confirms that, unless e.g. its firmware changed. It's usable meanwhile: the
+        // changes made to it queue up behind the probe.
+        auto cached = capabilityCache_.find(sourceString, probed);
+        auto opened = [this, request, sdr](const SoapySdrDeviceInfo &info) {
+            postToOwner([this, request, sdr, info]() {
+                if (request != deviceRequest_)
+                {
+                    deviceTasks_.post([this, sdr]() { closeDevice(sdr); });
+                    return;
+                }
+                deviceOpened(sdr, info);
+            });
+        };
+        if (cached)
+        {
+            opened(*cached);
+        }
+
+        auto info = probeDevice(sdr, probed);
+        auto changed = capabilityCache_.store(sourceString, probed, info);
+        if (!cached)
+        {
+            opened(info);
+        }
+        else if (changed)
+        {
+            postToOwner([this, sdr, info]() { deviceValidated(sdr, info); });
+        }
+    };
+    deviceTasks_.post(open);
+}
+
+void SoapySdrRadio::makeDevice(const QString &sourceString)
+{
+    if (!initialised_)
     {
-        qDebug() << "Deleting previous SDR";
-        unmakeDevice();
+        qDebug() << "Function `makeDevice` not called for failing to load DLL.";
+        return;
     }
 
-    // Try to make the device. This can fail because I'll allow the widget to give invalid
-    // input.
-    sdr_ = SoapySDRDevice_makeStrArgs(sourceString.toLocal8Bit());
-    if (sdr_ == nullptr)
+    if (running_)
     {
-        qDebug() << "SoapySDRDevice_makeStrArgs failed: " << SoapySDRDevice_lastError();
+        qDebug() << "Can't change the SDR while running!";
         return;
     }
 
-    readDevice();
+    releaseDevice();
+    deviceRequest_++; // Whatever `makeDeviceAsync` still has in flight is stale now
+
+    // We're blocked meanwhile, so the device thread can read the members directly
+    auto opened = deviceTasks_.call([&]() {
+        std::pair<SoapySDRDevice *, SoapySdrDeviceInfo> result{openDevice(sourceString),
+                                                               {}};
+        if (result.first != nullptr)
+        {
+            auto probed = validChannel(result.first, channel_);
+            tuneDevice(result.first, probed, streamChannels_, centreFrequency_);
+            result.second = probeDevice(result.first, probed);
+            capabilityCache_.store(sourceString, probed, result.second);
+        }
+        return result;
+    });
+
+    if (opened.first != nullptr)
+    {
+        deviceOpened(opened.first, opened.second);
+    }
 }
 
 void SoapySdrRadio::unmakeDevice()
@@ -270,76 +555,349 @@ void SoapySdrRadio::unmakeDevice()
         return;
     }
 
-    auto err = SoapySDRDevice_unmake(sdr_);
-    if (err != 0)
+    auto *sdr = std::exchange(sdr_, nullptr);
+    deviceTasks_.call([&]() { closeDevice(sdr); });
+
+    if (widget_ != nullptr)
     {
-        qDebug() << "SoapySDRDevice_unmake fail: " << SoapySDRDevice_lastError();
+        widget_->deviceDestroyed();
     }
-
-    sdr_ = nullptr;
-
-    widget_->deviceDestroyed();
 }
 
 void SoapySdrRadio::worker()
 {
-    // NOLINTNEXTLINE: Avoid C-arrays and etc, but I *need* them.
-    size_t channelList[1] = {channel_};
+    // Before anything is allocated, so the buffers land on this CPU's NUMA node
+    applyThreadProfile(scheduling_.acquisition);
+    TraceRecorder::nameThread("soapysdr acquisition");
 
-    auto *rxStream = SoapySDRDevice_setupStream(sdr_, SOAPY_SDR_RX, SOAPY_SDR_CF32,
-                                                // NOLINTNEXTLINE: Cast pointer to array
-                                                channelList, 1, nullptr);
+    auto channelList = getActiveChannels();
+    auto nchans = channelList.size();
+
+    auto format = toSampleFormat(streamFormat_);
+    auto *rxStream = openStream(channelList);
     if (rxStream == nullptr)
     {
-        qDebug() << "SoapySDRDevice_setupStream failed with error: "
-                 << SoapySDRDevice_lastError();
+        acquiring_ = false;
+        ring_->notify();
         return;
     }
 
-    auto err = SoapySDRDevice_activateStream(sdr_, rxStream, 0, 0, 0);
-    if (err != 0)
-    {
-        qDebug() << "SoapySDRDevice_activateStream failed with error: "
-                 << SoapySDRDevice_lastError();
-    }
-
+    // Preallocate every block, plus one buffer to read into when we have to drop.
+    // The pool is larger than the ring so listeners can hold on to some blocks.
     auto bufferSize = SoapySDRDevice_getStreamMTU(sdr_, rxStream);
-    std::vector<std::complex<float>> sampleBuffer(bufferSize);
+    pool_ = SampleBlockPool::make(SOAPY_POOL_BLOCKS, bufferSize, nchans);
+    std::vector<std::complex<float>> overflowBuffer(bufferSize * nchans);
 
-    // NOLINTNEXTLINE: Avoid C-arrays and etc, but I *need* them.
-    std::complex<float> *buffer_data[1]{sampleBuffer.data()};
+    // Integer formats are read into the wire buffer and converted into the block
+    auto scale = static_cast<float>(1.0 / getStreamFullScale());
+    auto wireSize =
+        format != SampleFormat::CF32 ? bufferSize * bytesPerSample(format) : 0;
+    std::vector<uint8_t> wireBuffer(wireSize * nchans);
+
+    // One buffer per channel
+    std::vector<void *> buffer_data(nchans, nullptr);
 
     int flags = 0;
     long long timeNs = 0;
     int samplesWrittenOrError = 0;
 
+    // From here on only the snapshot is read: the members belong to the GUI thread
+    auto state = *getState();
+
     // Sync up the listeners
     for (const auto &listener : listeners_)
     {
-        listener->setSampleRate(sampleRate_);
-        listener->setCentreFrequency(centreFrequency_);
-    }
+        listener->setSampleRate(state.sampleRate);
+        listener->setCentreFrequency(state.centreFrequency);
+    }
+
+    timeline_.reset(state.sampleRate);
+    overflows_ = 0;
+    timeouts_ = 0;
+    streamErrors_ = 0;
+    retunes_ = 0;
+    recovery_.reset();
+
+    auto hostNs = []() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    };
+
+    // Controls taken but not applied yet: a retune waits for the driver to hand over
+    // what it buffered from before, so those samples keep the old frequency. The worker
+    // stays the consumer meanwhile.
+    std::vector<Control> latest;
+    latest.reserve(controls_.capacity());
+    size_t held = 0;
+    size_t drainReads = 0;
+
+    size_t settling = 0;       // Samples still to drop after the last retune, by count
+    long long settledNs = -1;  // Or by the device's clock, when it has one
+    long long lastEndNs = -1;  // Device time right after the last sample read
+    long long lastCheckNs = 0; // Host time the driver was last found with nothing more
+    bool retuned = false;      // Until the first block after it is delivered
+    bool settleDropped = false;
+
+    auto applyHeld = [&]() {
+        for (const auto &control : latest)
+        {
+            applyControl(sdr_, control, state);
+            if (control.kind == Control::CentreFrequency)
+            {
+                traceInstant("retune", "source", "hz",
+                             static_cast<int64_t>(state.centreFrequency));
+                retunes_++;
+                settling = static_cast<size_t>(retuneSettle_ * state.sampleRate);
+                // The latest the new frequency can have taken effect, on the device's
+                // clock: the next buffer wasn't full yet at the last check
+                settledNs = -1;
+                if (lastEndNs >= 0)
+                {
+                    // NOLINTNEXTLINE(readability-magic-numbers)
+                    auto settleNs = static_cast<long long>(retuneSettle_ * 1e9);
+                    // NOLINTNEXTLINE(readability-magic-numbers)
+                    auto bufferNs = static_cast<long long>(
+                        static_cast<double>(bufferSize) * 1e9 / state.sampleRate);
+                    auto sinceNs = hostNs() - lastCheckNs;
+                    settledNs = lastEndNs + bufferNs + sinceNs + settleNs;
+                }
+                retuned = true;
+                settleDropped = false;
+            }
+        }
+        auto published = held > 0 ? publishApplied(state, held, true) : nullptr;
+        held = 0;
+        consuming_.store(false, std::memory_order_release);
+        if (published != nullptr)
+        {
+            resolveWaiters(*published);
+            postToOwner([this, published]() { controlsApplied(*published); });
+        }
+    };
 
     while (running_)
     {
-        samplesWrittenOrError = SoapySDRDevice_readStream(
-            sdr_, rxStream, reinterpret_cast<void **>(buffer_data), bufferSize, &flags,
-            &timeNs, SOAPY_FRAME_TIMEOUT);
+        // Between two reads, so no block straddles a change. Only skipped while stop()
+        // has the device thread drain what's left.
+        if (held == 0 && !consuming_.exchange(true, std::memory_order_acquire))
+        {
+            held = takeControls(latest);
+            drainReads = 0;
+            auto retune =
+                std::any_of(latest.begin(), latest.end(), [](const Control &control) {
+                    return control.kind == Control::CentreFrequency;
+                });
+            if (!retune)
+            {
+                applyHeld();
+            }
+        }
+        // A driver that always has more, because the host is behind, is retuned anyway
+        if (held > 0 && drainReads++ == SOAPY_RETUNE_DRAIN_READS)
+        {
+            applyHeld();
+        }
+
+        // If the dispatcher or the listeners are behind, keep draining the device anyway
+        // and drop the block
+        auto *slot = ring_->writeSlot();
+        auto block = slot != nullptr ? pool_->acquire() : SampleBlockPtr();
+        for (auto c = 0U; c < nchans; c++)
+        {
+            if (format != SampleFormat::CF32)
+            {
+                buffer_data[c] = wireBuffer.data() + c * wireSize;
+            }
+            else
+            {
+                buffer_data[c] =
+                    block ? block->data(c) : overflowBuffer.data() + c * bufferSize;
+            }
+        }
+
+        {
+            // Draining for a retune, only what the driver already has
+            auto timeoutUs = held > 0 ? 0 : SOAPY_FRAME_TIMEOUT;
+            TraceScope trace("readStream", "source");
+            samplesWrittenOrError =
+                SoapySDRDevice_readStream(sdr_, rxStream, buffer_data.data(), bufferSize,
+                                          &flags, &timeNs, timeoutUs);
+        }
 
         if (samplesWrittenOrError < 0)
         {
-            qDebug() << "SoapySDRDevice_readStream failed with error: "
-                     << SoapySDR_errToStr(samplesWrittenOrError);
+            // Everything from before the retune was read, or the stream failed: tune now
+            if (held > 0)
+            {
+                lastCheckNs = hostNs();
+                applyHeld();
+                if (samplesWrittenOrError == SOAPY_SDR_TIMEOUT)
+                {
+                    continue;
+                }
+            }
+
+            auto fault = StreamFault::Error;
+            if (samplesWrittenOrError == SOAPY_SDR_OVERFLOW)
+            {
+                fault = StreamFault::Overflow;
+                overflows_++;
+                timeline_.markDiscontinuity();
+            }
+            else if (samplesWrittenOrError == SOAPY_SDR_TIMEOUT)
+            {
+                fault = StreamFault::Timeout;
+                timeouts_++;
+            }
+            else
+            {
+                streamErrors_++;
+                // Once recovering, the attempts are what gets logged
+                if (!recovery_.isRecovering())
+                {
+                    qDebug() << "SoapySDRDevice_readStream failed with error: "
+                             << SoapySDR_errToStr(samplesWrittenOrError);
+                }
+            }
+
+            auto action = recovery_.failed(fault);
+            if (action == RecoveryAction::None)
+            {
+                continue;
+            }
+            while (!recoverStream(rxStream, action, channelList))
+            {
+                action = recovery_.retry();
+            }
+            // Whatever came in while the stream was down is lost, and the device clock
+            // may have started over, so the timestamps can't be trusted to show the gap
+            timeline_.markDiscontinuity();
             continue;
         }
+        recovery_.succeeded();
+        auto readNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+
+        // Without a hardware timestamp, the host clock is the next best thing
+        auto hardwareTime = (flags & SOAPY_SDR_HAS_TIME) != 0;
+        if (!hardwareTime)
+        {
+            timeNs = readNs;
+        }
 
-        for (const auto &listener : listeners_)
+        uint32_t blockFlags = 0;
+        if ((flags & SOAPY_SDR_END_BURST) != 0)
+        {
+            blockFlags |= SampleBlockEndBurst;
+        }
+        auto samples = static_cast<size_t>(samplesWrittenOrError);
+        auto sampleIndex = timeline_.advance(samples, timeNs, hardwareTime, blockFlags);
+
+        // Samples from before the retune took effect, or from while the device was still
+        // settling, never reach the listeners. With a device clock, those are the ones
+        // stamped before `settledNs`; without, they're counted from the first read.
+        size_t settled = 0;
+        if (retuned && hardwareTime && settledNs >= 0)
         {
-            listener->receiveSamples(sampleBuffer);
+            // NOLINTNEXTLINE(readability-magic-numbers)
+            auto early = std::ceil(static_cast<double>(settledNs - timeNs) *
+                                   state.sampleRate / 1e9);
+            settled = static_cast<size_t>(
+                std::clamp(early, 0.0, static_cast<double>(samples)));
         }
+        else if (retuned)
+        {
+            settled = std::min(settling, samples);
+            settling -= settled;
+        }
+        settleDropped |= settled > 0;
+
+        lastEndNs = -1;
+        if (hardwareTime)
+        {
+            // NOLINTNEXTLINE(readability-magic-numbers)
+            lastEndNs = timeNs + static_cast<long long>(static_cast<double>(samples) *
+                                                        1e9 / state.sampleRate);
+            lastCheckNs = readNs;
+        }
+        if (settled == samples)
+        {
+            continue;
+        }
+
+        if (!block)
+        {
+            ring_->markDropped();
+            timeline_.markDiscontinuity();
+            continue;
+        }
+
+        if (retuned)
+        {
+            blockFlags |= SampleBlockRetuned;
+            blockFlags |= settleDropped ? SampleBlockDiscontinuity : 0U;
+            retuned = false;
+        }
+
+        block->setSize(samples);
+        block->setTimeNs(timeNs);
+        block->setReadNs(readNs);
+        block->setSampleIndex(sampleIndex);
+        block->setFlags(blockFlags);
+        block->setCentreFrequency(state.centreFrequency);
+        for (auto c = 0U; format != SampleFormat::CF32 && c < nchans; c++)
+        {
+            convertToCf32(format, wireBuffer.data() + c * wireSize, block->data(c),
+                          block->size(), scale);
+        }
+        block->dropFront(settled, state.sampleRate);
+        *slot = std::move(block);
+        ring_->commitWrite();
+        traceInstant("enqueue", "ring");
+    }
+
+    // Stopped while draining for a retune
+    if (held > 0)
+    {
+        applyHeld();
     }
+    closeStream(rxStream);
 
-    err = SoapySDRDevice_deactivateStream(sdr_, rxStream, 0, 0);
+    acquiring_ = false;
+    ring_->notify();
+}
+
+SoapySDRStream *SoapySdrRadio::openStream(const std::vector<size_t> &channels)
+{
+    auto *rxStream =
+        SoapySDRDevice_setupStream(sdr_, SOAPY_SDR_RX, streamFormat_.toLocal8Bit(),
+                                   channels.data(), channels.size(), nullptr);
+    if (rxStream == nullptr)
+    {
+        qDebug() << "SoapySDRDevice_setupStream failed with error: "
+                 << SoapySDRDevice_lastError();
+        return nullptr;
+    }
+
+    auto err = SoapySDRDevice_activateStream(sdr_, rxStream, 0, 0, 0);
+    if (err != 0)
+    {
+        qDebug() << "SoapySDRDevice_activateStream failed with error: "
+                 << SoapySDRDevice_lastError();
+    }
+    return rxStream;
+}
+
+void SoapySdrRadio::closeStream(SoapySDRStream *rxStream)
+{
+    if (rxStream == nullptr)
+    {
+        return;
+    }
+
+    auto err = SoapySDRDevice_deactivateStream(sdr_, rxStream, 0, 0);
     if (err != 0)
     {
         qDebug() << "SoapySDRDevice_deactivateStream failed with error: "
@@ -354,6 +912,84 @@ void SoapySdrRadio::worker()
     }
 }
 
+bool SoapySdrRadio::recoverStream(SoapySDRStream *&rxStream, RecoveryAction action,
+                                  const std::vector<size_t> &channels)
+{
+    TraceScope trace("recoverStream", "source", "backoff_ms",
+                     static_cast<int64_t>(recovery_.getBackoff().count()));
+    auto backoff = recovery_.getBackoff();
+    qDebug() << "Stream down,"
+             << (action == RecoveryAction::Reactivate ? "reactivating" : "reopening")
+             << "it in" << backoff.count() << "ms.";
+
+    // In slices, so that stop() doesn't have to wait out a long backoff
+    auto until = std::chrono::steady_clock::now() + backoff;
+    while (running_ && std::chrono::steady_clock::now() < until)
+    {
+        std::this_thread::sleep_for(
+            std::min<std::chrono::steady_clock::duration>(
+                until - std::chrono::steady_clock::now(),
+                std::chrono::milliseconds(SOAPY_RECOVERY_WAIT_SLICE)));
+    }
+    if (!running_)
+    {
+        return true;
+    }
+
+    if (action == RecoveryAction::Reactivate && rxStream != nullptr)
+    {
+        SoapySDRDevice_deactivateStream(sdr_, rxStream, 0, 0);
+        return SoapySDRDevice_activateStream(sdr_, rxStream, 0, 0, 0) == 0;
+    }
+
+    closeStream(rxStream);
+    rxStream = openStream(channels);
+    return rxStream != nullptr;
+}
+
+void SoapySdrRadio::dispatcher()
+{
+    applyThreadProfile(scheduling_.dispatch);
+    TraceRecorder::nameThread("soapysdr dispatch");
+
+    while (true)
+    {
+        auto *slot = ring_->readSlot();
+        if (slot == nullptr)
+        {
+            // Only quit once the worker is gone and everything it produced was delivered
+            if (!acquiring_ && ring_->readSlot() == nullptr)
+            {
+                break;
+            }
+            ring_->waitForData(std::chrono::microseconds(SOAPY_DISPATCH_WAIT));
+            continue;
+        }
+
+        // Free the slot right away, the block itself lives on while referenced
+        auto block = std::move(*slot);
+        ring_->commitRead();
+        traceInstant("dequeue", "ring");
+
+        // In step with the samples: listeners hear of a retune right before its first
+        // block
+        if (block->hasFlag(SampleBlockRetuned))
+        {
+            for (const auto &listener : listeners_)
+            {
+                listener->setCentreFrequency(block->centreFrequency());
+            }
+        }
+
+        for (size_t i = 0; i < listeners_.size(); i++)
+        {
+            TraceScope trace("receiveSamples", "listener", "listener",
+                             static_cast<int64_t>(i));
+            listeners_[i]->receiveSamples(block);
+        }
+    }
+}
+
 void SoapySdrRadio::start()
 {
     if (!initialised_)
@@ -374,11 +1010,23 @@ void SoapySdrRadio::start()
         return;
     }
 
+    ring_ = std::make_unique<SpscRingBuffer<SampleBlockPtr>>(SOAPY_RING_BLOCKS);
+
+    // Whatever was submitted before goes to the device first, the worker takes over from
+    // there. Also waits for a probe still in flight, which the worker mustn't overlap.
     running_ = true;
+    deviceTasks_.call([this, sdr = sdr_]() { applyQueuedControls(sdr); });
+    publishSettings();
+    acquiring_ = true;
     // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
     worker_ = new std::thread(&SoapySdrRadio::worker, this);
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    dispatcher_ = new std::thread(&SoapySdrRadio::dispatcher, this);
 
-    widget_->deviceStarted();
+    if (widget_ != nullptr)
+    {
+        widget_->deviceStarted();
+    }
 }
 
 void SoapySdrRadio::stop()
@@ -411,7 +1059,97 @@ void SoapySdrRadio::stop()
 
     worker_ = nullptr;
 
-    widget_->deviceStopped();
+    if (dispatcher_ != nullptr)
+    {
+        dispatcher_->join();
+        delete dispatcher_;
+    }
+
+    dispatcher_ = nullptr;
+
+    // Whatever the worker didn't get to
+    publishSettings();
+    deviceTasks_.post([this, sdr = sdr_]() { applyQueuedControls(sdr); });
+
+    qDebug() << "Ring high-water mark: " << ring_->highWaterMark() << "/"
+             << ring_->capacity() << ", dropped blocks: " << ring_->dropped();
+    qDebug() << "Overflows: " << overflows_ << ", timeouts: " << timeouts_
+             << ", stream errors: " << streamErrors_
+             << ", gaps: " << timeline_.getGaps()
+             << ", lost samples: " << timeline_.getLostSamples()
+             << ", measured sample rate: " << timeline_.getMeasuredSampleRate();
+    qDebug() << "Stream recoveries: " << recovery_.getRecoveries()
+             << ", reactivations: " << recovery_.getReactivations()
+             << ", reopens: " << recovery_.getReopens()
+             << ", time recovering: " << recovery_.getTimeRecovering().count() << "ms";
+
+    if (widget_ != nullptr)
+    {
+        widget_->deviceStopped();
+    }
+}
+
+SourceStatistics SoapySdrRadio::getStatistics()
+{
+    SourceStatistics stats;
+    if (ring_ != nullptr)
+    {
+        stats.ringCapacity = ring_->capacity();
+        stats.ringHighWaterMark = ring_->highWaterMark();
+        stats.droppedBlocks = ring_->dropped();
+    }
+    stats.samplesReceived = timeline_.getSamplesReceived();
+    stats.overflows = overflows_;
+    stats.timeouts = timeouts_;
+    stats.streamErrors = streamErrors_;
+    stats.retunes = retunes_;
+    stats.recovering = recovery_.isRecovering();
+    stats.recoveries = recovery_.getRecoveries();
+    stats.reactivations = recovery_.getReactivations();
+    stats.reopens = recovery_.getReopens();
+    stats.timeRecovering = recovery_.getTimeRecovering().count() / 1000.0;
+    stats.gaps = timeline_.getGaps();
+    stats.lostSamples = timeline_.getLostSamples();
+    stats.measuredSampleRate = timeline_.getMeasuredSampleRate();
+    return stats;
+}
+
+double SoapySdrRadio::getStreamFullScale() const
+{
+    auto format = toSampleFormat(streamFormat_);
+    if (format == SampleFormat::CF32)
+    {
+        return 1.0;
+    }
+    if (streamFormat_ == nativeStreamFormat_ && nativeFullScale_ > 0)
+    {
+        return nativeFullScale_;
+    }
+    return defaultFullScale(format);
+}
+
+void SoapySdrRadio::setStreamFormat(const QString &format)
+{
+    if (!initialised_)
+    {
+        qDebug() << "Function `setStreamFormat` not called for failing to load DLL.";
+        return;
+    }
+
+    if (running_)
+    {
+        qDebug() << "Can't change the stream format of a running device!";
+        return;
+    }
+
+    if (std::none_of(supportedStreamFormats_.begin(), supportedStreamFormats_.end(),
+                     [&](const QString &fmt) { return fmt == format; }))
+    {
+        qDebug() << "Unsupported stream format: " << format;
+        return;
+    }
+
+    streamFormat_ = format;
 }
 
 void SoapySdrRadio::setChannel(size_t channel)
@@ -430,10 +1168,51 @@ void SoapySdrRadio::setChannel(size_t channel)
 
     if (channel >= channelCount_ || channel == channel_)
     {
-        return;
+        return;
+    }
+
+    channel_ = channel;
+    publishSettings();
+}
+
+std::vector<size_t> SoapySdrRadio::getActiveChannels() const
+{
+    if (streamChannels_.empty())
+    {
+        return {channel_};
+    }
+    return streamChannels_;
+}
+
+void SoapySdrRadio::setStreamChannels(const std::vector<size_t> &channels)
+{
+    if (!initialised_)
+    {
+        qDebug() << "Function `setStreamChannels` not called for failing to load DLL.";
+        return;
+    }
+
+    if (running_)
+    {
+        qDebug() << "Can't change the channels of a running device!";
+        return;
+    }
+
+    if (std::any_of(channels.begin(), channels.end(),
+                    [&](size_t chan) { return chan >= channelCount_; }))
+    {
+        qDebug() << "Invalid channel list.";
+        return;
+    }
+
+    streamChannels_ = channels;
+    publishSettings();
+
+    // Bring every channel to the same settings
+    if (sdr_ != nullptr)
+    {
+        submitControl({Control::StreamChannels, 0, {}});
     }
-
-    channel_ = channel;
 }
 
 void SoapySdrRadio::setAntenna(const QString &antenna)
@@ -452,17 +1231,7 @@ void SoapySdrRadio::setAntenna(const QString &antenna)
     }
 
     antenna_ = antenna;
-
-    if (sdr_ != nullptr)
-    {
-        auto res = SoapySDRDevice_setAntenna(sdr_, SOAPY_SDR_RX, channel_,
-                                             antenna_.toLocal8Bit());
-        if (res != 0)
-        {
-            qDebug() << "SoapySDRDevice_setAntenna failed with error: "
-                     << SoapySDRDevice_lastError();
-        }
-    }
+    submitControl({Control::Antenna, 0, antenna_});
 }
 
 void SoapySdrRadio::setCentreFrequency(double centreFrequency)
@@ -474,24 +1243,30 @@ void SoapySdrRadio::setCentreFrequency(double centreFrequency)
     }
 
     centreFrequency_ = centreFrequency;
+    submitControl({Control::CentreFrequency, centreFrequency, {}});
 
-    if (sdr_ != nullptr)
+    // While streaming, the listeners hear of it in step with the samples instead
+    if (running_)
     {
-        auto res = SoapySDRDevice_setFrequency(
-            sdr_, SOAPY_SDR_RX, channel_, static_cast<double>(centreFrequency_), nullptr);
-        if (res != 0)
-        {
-            qDebug() << "SoapySDRDevice_setFrequency failed with error: "
-                     << SoapySDRDevice_lastError();
-        }
+        return;
     }
-
     for (const auto &listener : listeners_)
     {
         listener->setCentreFrequency(centreFrequency_);
     }
 }
 
+void SoapySdrRadio::setRetuneSettle(double seconds)
+{
+    if (seconds < 0)
+    {
+        qDebug() << "Invalid retune settle time: " << seconds;
+        return;
+    }
+
+    retuneSettle_ = seconds;
+}
+
 bool SoapySdrRadio::validateSampleRate(double sampleRate)
 {
     if (std::any_of(supportedSampleRatesDiscrete_.begin(),
@@ -534,17 +1309,9 @@ void SoapySdrRadio::setSampleRate(double sampleRate)
         return;
     }
 
+    // Should the device refuse it, `controlsApplied` goes back to what it has
     sampleRate_ = sampleRate;
-
-    auto res = SoapySDRDevice_setSampleRate(sdr_, SOAPY_SDR_RX, channel_, sampleRate_);
-    if (res != 0)
-    {
-        qDebug() << "SoapySDRDevice_setSampleRate failed with error: "
-                 << SoapySDRDevice_lastError();
-        sampleRate_ = SoapySDRDevice_getSampleRate(sdr_, SOAPY_SDR_RX, channel_);
-        widget_->syncUi();
-        return;
-    }
+    submitControl({Control::SampleRate, sampleRate_, {}});
 
     for (const auto &listener : listeners_)
     {
@@ -604,7 +1371,10 @@ void SoapySdrRadio::readjustBandwidth()
         }
     }
 
-    widget_->syncUi();
+    if (widget_ != nullptr)
+    {
+        widget_->syncUi();
+    }
 }
 
 void SoapySdrRadio::setBandwidth(double bandwidth)
@@ -628,16 +1398,7 @@ void SoapySdrRadio::setBandwidth(double bandwidth)
     }
 
     bandwidth_ = bandwidth;
-
-    auto res = SoapySDRDevice_setBandwidth(sdr_, SOAPY_SDR_RX, channel_, bandwidth_);
-    if (res != 0)
-    {
-        qDebug() << "SoapySDRDevice_setBandwidth failed with error: "
-                 << SoapySDRDevice_lastError();
-        bandwidth_ = SoapySDRDevice_getBandwidth(sdr_, SOAPY_SDR_RX, channel_);
-        widget_->syncUi();
-        return;
-    }
+    submitControl({Control::Bandwidth, bandwidth_, {}});
 }
 
 void SoapySdrRadio::setAgc(bool state)
@@ -661,14 +1422,7 @@ void SoapySdrRadio::setAgc(bool state)
     }
 
     agc_ = state;
-    auto res = SoapySDRDevice_setGainMode(sdr_, SOAPY_SDR_RX, channel_, agc_);
-    if (res != 0)
-    {
-        qDebug() << "SoapySDRDevice_setGainMode failed with error: "
-                 << SoapySDRDevice_lastError();
-        agc_ = SoapySDRDevice_getGainMode(sdr_, SOAPY_SDR_RX, channel_);
-        widget_->syncUi();
-    }
+    submitControl({Control::Agc, agc_ ? 1.0 : 0.0, {}});
 }
 
 void SoapySdrRadio::setGlobalGain(double gain)
@@ -692,21 +1446,7 @@ void SoapySdrRadio::setGlobalGain(double gain)
     }
 
     globalGain_ = gain;
-
-    auto res = SoapySDRDevice_setGain(sdr_, SOAPY_SDR_RX, channel_, globalGain_);
-    if (res != 0)
-    {
-        qDebug() << "SoapySDRDevice_setGain failed with error: "
-                 << SoapySDRDevice_lastError();
-    }
-
-    for (const auto &gainElem : specificGains_)
-    {
-        auto name = gainElem.first.toLocal8Bit();
-        specificGains_[gainElem.first] =
-            SoapySDRDevice_getGainElement(sdr_, SOAPY_SDR_RX, channel_, name);
-    }
-    widget_->syncUi();
+    submitControl({Control::GlobalGain, globalGain_, {}});
 }
 
 void SoapySdrRadio::setSpecificGain(const QString &name, double value)
@@ -738,18 +1478,471 @@ void SoapySdrRadio::setSpecificGain(const QString &name, double value)
     }
 
     specificGains_[name] = value;
+    submitControl({Control::SpecificGain, value, name});
+}
+
+void SoapySdrRadio::submitControl(const Control &control)
+{
+    controlsSubmitted_++;
+    if (!controls_.post(control))
+    {
+        controlsSubmitted_--;
+        qDebug() << "Too many control changes pending, dropped one.";
+        return;
+    }
+
+    // Streaming, the worker picks it up before its next read
+    if (running_)
+    {
+        return;
+    }
+
+    // One drain per change, each with the device current when it was made. The first
+    // one usually takes them all and the rest find the mailbox empty.
+    deviceTasks_.post([this, sdr = sdr_]() { applyQueuedControls(sdr); });
+}
+
+size_t SoapySdrRadio::takeControls(std::vector<Control> &latest)
+{
+    latest.clear();
+    size_t taken = 0;
+    Control control;
+    while (controls_.take(control))
+    {
+        taken++;
+
+        // A newer value replaces an older one of the same setting and moves to the back,
+        // so the order between settings still holds (the global gain moves the elements)
+        auto older =
+            std::find_if(latest.begin(), latest.end(), [&](const Control &other) {
+                return other.kind == control.kind && other.name == control.name;
+            });
+        if (older != latest.end())
+        {
+            latest.erase(older);
+        }
+        latest.push_back(std::move(control));
+    }
+    return taken;
+}
+
+void SoapySdrRadio::applyQueuedControls(SoapySDRDevice *sdr)
+{
+    // The worker is still finishing its last read: stop() queues another drain once it's
+    // gone
+    if (consuming_.exchange(true, std::memory_order_acquire))
+    {
+        return;
+    }
+
+    std::vector<Control> latest;
+    auto taken = takeControls(latest);
+    auto state = *getState();
+    for (const auto &control : latest)
+    {
+        applyControl(sdr, control, state);
+    }
+    // Without a device nothing was applied, the members already hold the values
+    auto published = taken > 0 ? publishApplied(state, taken, sdr != nullptr) : nullptr;
+    consuming_.store(false, std::memory_order_release);
+
+    if (published != nullptr)
+    {
+        resolveWaiters(*published);
+        postToOwner([this, published]() { controlsApplied(*published); });
+    }
+}
+
+void SoapySdrRadio::applyControl(SoapySDRDevice *sdr, const Control &control,
+                                 SoapySdrState &state)
+{
+    if (sdr == nullptr)
+    {
+        return;
+    }
+
+    auto res = 0;
+    switch (control.kind)
+    {
+    case Control::CentreFrequency:
+        state.centreFrequency = control.value;
+        for (auto chan : state.channels)
+        {
+            res |= SoapySDRDevice_setFrequency(sdr, SOAPY_SDR_RX, chan, control.value,
+                                               nullptr);
+        }
+        if (res != 0)
+        {
+            qDebug() << "SoapySDRDevice_setFrequency failed with error: "
+                     << SoapySDRDevice_lastError();
+        }
+        return;
+    case Control::SampleRate:
+        state.sampleRate = control.value;
+        for (auto chan : state.channels)
+        {
+            res |= SoapySDRDevice_setSampleRate(sdr, SOAPY_SDR_RX, chan, control.value);
+        }
+        if (res != 0)
+        {
+            qDebug() << "SoapySDRDevice_setSampleRate failed with error: "
+                     << SoapySDRDevice_lastError();
+            state.sampleRate =
+                SoapySDRDevice_getSampleRate(sdr, SOAPY_SDR_RX, state.channel);
+        }
+        return;
+    case Control::StreamChannels:
+        for (auto chan : state.channels)
+        {
+            res |=
+                SoapySDRDevice_setSampleRate(sdr, SOAPY_SDR_RX, chan, state.sampleRate);
+            res |= SoapySDRDevice_setBandwidth(sdr, SOAPY_SDR_RX, chan, state.bandwidth);
+            res |= SoapySDRDevice_setFrequency(sdr, SOAPY_SDR_RX, chan,
+                                               state.centreFrequency, nullptr);
+        }
+        if (res != 0)
+        {
+            qDebug() << "Couldn't bring every streamed channel to the same settings: "
+                     << SoapySDRDevice_lastError();
+        }
+        return;
+    case Control::Antenna:
+        state.antenna = control.name;
+        res = SoapySDRDevice_setAntenna(sdr, SOAPY_SDR_RX, state.channel,
+                                        control.name.toLocal8Bit());
+        if (res != 0)
+        {
+            qDebug() << "SoapySDRDevice_setAntenna failed with error: "
+                     << SoapySDRDevice_lastError();
+        }
+        return;
+    case Control::Bandwidth:
+        state.bandwidth = control.value;
+        for (auto chan : state.channels)
+        {
+            res |= SoapySDRDevice_setBandwidth(sdr, SOAPY_SDR_RX, chan, control.value);
+        }
+        if (res != 0)
+        {
+            qDebug() << "SoapySDRDevice_setBandwidth failed with error: "
+                     << SoapySDRDevice_lastError();
+            state.bandwidth =
+                SoapySDRDevice_getBandwidth(sdr, SOAPY_SDR_RX, state.channel);
+        }
+        return;
+    case Control::Agc:
+        state.agc = control.value != 0;
+        res = SoapySDRDevice_setGainMode(sdr, SOAPY_SDR_RX, state.channel, state.agc);
+        if (res != 0)
+        {
+            qDebug() << "SoapySDRDevice_setGainMode failed with error: "
+                     << SoapySDRDevice_lastError();
+            state.agc = SoapySDRDevice_getGainMode(sdr, SOAPY_SDR_RX, state.channel);
+        }
+        return;
+    case Control::GlobalGain:
+        state.globalGain = control.value;
+        res = SoapySDRDevice_setGain(sdr, SOAPY_SDR_RX, state.channel, control.value);
+        if (res != 0)
+        {
+            qDebug() << "SoapySDRDevice_setGain failed with error: "
+                     << SoapySDRDevice_lastError();
+        }
+        break;
+    case Control::SpecificGain:
+        res = SoapySDRDevice_setGainElement(sdr, SOAPY_SDR_RX, state.channel,
+                                            control.name.toLocal8Bit(), control.value);
+        if (res != 0)
+        {
+            qDebug() << "SoapySDRDevice_setGainElement failed with error: "
+                     << SoapySDRDevice_lastError();
+        }
+        state.globalGain = SoapySDRDevice_getGain(sdr, SOAPY_SDR_RX, state.channel);
+        break;
+    }
+
+    // The overall gain is spread over the elements, and the elements add up to it
+    for (auto &gainElem : state.specificGains)
+    {
+        auto name = gainElem.first.toLocal8Bit();
+        gainElem.second =
+            SoapySDRDevice_getGainElement(sdr, SOAPY_SDR_RX, state.channel, name);
+    }
+}
+
+void SoapySdrRadio::controlsApplied(const SoapySdrState &state)
+{
+    // Newer changes are on their way: these values would overwrite theirs
+    if (state.controls != controlsSubmitted_)
+    {
+        return;
+    }
+
+    // The device may have refused, or rounded, what it was asked for
+    auto sampleRateChanged = sampleRate_ != state.sampleRate;
+    auto changed = sampleRateChanged || bandwidth_ != state.bandwidth ||
+                   agc_ != state.agc || globalGain_ != state.globalGain ||
+                   specificGains_ != state.specificGains;
+    sampleRate_ = state.sampleRate;
+    bandwidth_ = state.bandwidth;
+    agc_ = state.agc;
+    globalGain_ = state.globalGain;
+    specificGains_ = state.specificGains;
+    if (changed && widget_ != nullptr)
+    {
+        widget_->syncUi();
+    }
+
+    // Once streaming, the worker told the listeners what it started with
+    if (sampleRateChanged && !running_)
+    {
+        for (const auto &listener : listeners_)
+        {
+            listener->setSampleRate(sampleRate_);
+        }
+    }
+}
+
+SoapySdrState SoapySdrRadio::makeState() const
+{
+    SoapySdrState state;
+    state.running = running_;
+    state.channel = channel_;
+    state.channels = getActiveChannels();
+    state.antenna = antenna_;
+    state.centreFrequency = centreFrequency_;
+    state.sampleRate = sampleRate_;
+    state.bandwidth = bandwidth_;
+    state.agc = agc_;
+    state.globalGain = globalGain_;
+    state.specificGains = specificGains_;
+    return state;
+}
+
+template <typename Update>
+std::shared_ptr<const SoapySdrState> SoapySdrRadio::updateState(const Update &update)
+{
+    auto current = std::atomic_load(&state_);
+    while (true)
+    {
+        auto next = std::make_shared<SoapySdrState>(*current);
+        update(*next);
+        std::shared_ptr<const SoapySdrState> published = std::move(next);
+        if (std::atomic_compare_exchange_weak(&state_, &current, published))
+        {
+            return published;
+        }
+    }
+}
+
+void SoapySdrRadio::publishSettings()
+{
+    auto settings = makeState();
+    updateState([&](SoapySdrState &state) {
+        state.running = settings.running;
+        state.channel = settings.channel;
+        state.channels = settings.channels;
+    });
+}
+
+void SoapySdrRadio::publishDevice()
+{
+    // A new device (or none): every value comes from it
+    auto settings = makeState();
+    updateState([&](SoapySdrState &state) {
+        auto controls = state.controls;
+        state = settings;
+        state.controls = controls;
+    });
+}
+
+std::shared_ptr<const SoapySdrState> SoapySdrRadio::publishApplied(
+    const SoapySdrState &applied, uint64_t taken, bool changed)
+{
+    return updateState([&](SoapySdrState &state) {
+        state.controls += taken;
+        if (!changed)
+        {
+            return;
+        }
+        state.antenna = applied.antenna;
+        state.centreFrequency = applied.centreFrequency;
+        state.sampleRate = applied.sampleRate;
+        state.bandwidth = applied.bandwidth;
+        state.agc = applied.agc;
+        state.globalGain = applied.globalGain;
+        state.specificGains = applied.specificGains;
+    });
+}
+
+std::shared_ptr<const SoapySdrState> SoapySdrRadio::getState() const
+{
+    return std::atomic_load(&state_);
+}
+
+std::future<SoapySdrState> SoapySdrRadio::whenApplied()
+{
+    std::promise<SoapySdrState> promise;
+    auto applied = promise.get_future();
+    auto target = controlsSubmitted_.load();
+
+    // Counted before looking at the snapshot: a consumer publishing right now either
+    // shows up in it or finds the waiter
+    std::lock_guard<std::mutex> lock(waitersMutex_);
+    waiting_++;
+    auto state = getState();
+    if (state->controls >= target)
+    {
+        waiting_--;
+        promise.set_value(*state);
+        return applied;
+    }
+    waiters_.emplace_back(target, std::move(promise));
+    return applied;
+}
+
+void SoapySdrRadio::resolveWaiters(const SoapySdrState &state)
+{
+    // Nobody waiting is the common case, and it doesn't take the lock
+    if (waiting_ == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(waitersMutex_);
+    for (auto waiter = waiters_.begin(); waiter != waiters_.end();)
+    {
+        if (waiter->first > state.controls)
+        {
+            waiter++;
+            continue;
+        }
+        waiter->second.set_value(state);
+        waiter = waiters_.erase(waiter);
+        waiting_--;
+    }
+}
+
+bool SoapySdrRadio::configure(const QJsonObject &settings)
+{
+    if (!initialised_)
+    {
+        qDebug() << "Function `configure` not called for failing to load DLL.";
+        return false;
+    }
+
+    if (running_)
+    {
+        qDebug() << "Can't configure a running device!";
+        return false;
+    }
+
+    // Like the widget, default to the first device found
+    if (settings.contains("device"))
+    {
+        makeDevice(settings["device"].toString());
+    }
+    else if (sdr_ == nullptr)
+    {
+        if (!devicesEnumerated_)
+        {
+            discoverDevices();
+        }
+        if (!deviceStrings_.empty())
+        {
+            makeDevice(deviceStrings_.begin()->second);
+        }
+    }
+
+    if (sdr_ == nullptr)
+    {
+        qDebug() << "No device to configure.";
+        return false;
+    }
+
+    // The setters complain on their own, this only notes that something was rejected
+    auto ok = true;
+    if (settings.contains("channel"))
+    {
+        auto channel = static_cast<size_t>(settings["channel"].toInt());
+        setChannel(channel);
+        ok &= channel_ == channel;
+    }
+    if (settings.contains("channels"))
+    {
+        std::vector<size_t> channels;
+        for (const auto &chan : settings["channels"].toArray())
+        {
+            channels.push_back(static_cast<size_t>(chan.toInt()));
+        }
+        setStreamChannels(channels);
+        ok &= streamChannels_ == channels;
+    }
+    if (settings.contains("stream_format"))
+    {
+        setStreamFormat(settings["stream_format"].toString());
+        ok &= streamFormat_ == settings["stream_format"].toString();
+    }
+    if (settings.contains("antenna"))
+    {
+        setAntenna(settings["antenna"].toString());
+        ok &= antenna_ == settings["antenna"].toString();
+    }
+    if (settings.contains("sample_rate"))
+    {
+        setSampleRate(settings["sample_rate"].toDouble());
+        ok &= sampleRate_ == settings["sample_rate"].toDouble();
+    }
+    if (settings.contains("bandwidth"))
+    {
+        setBandwidth(settings["bandwidth"].toDouble());
+        ok &= bandwidth_ == settings["bandwidth"].toDouble();
+    }
+    if (settings.contains("agc"))
+    {
+        setAgc(settings["agc"].toBool());
+        ok &= agc_ == settings["agc"].toBool();
+    }
+    if (settings.contains("gain"))
+    {
+        setGlobalGain(settings["gain"].toDouble());
+        ok &= globalGain_ == settings["gain"].toDouble();
+    }
+    if (settings.contains("retune_settle"))
+    {
+        setRetuneSettle(settings["retune_settle"].toDouble());
+        ok &= retuneSettle_ == settings["retune_settle"].toDouble();
+    }
+    auto gains = settings["gains"].toObject();
+    for (auto it = gains.begin(); it != gains.end(); it++)
+    {
+        setSpecificGain(it.key(), it.value().toDouble());
+        ok &= specificGains_.count(it.key()) != 0;
+    }
 
-    SoapySDRDevice_setGainElement(sdr_, SOAPY_SDR_RX, channel_, name.toLocal8Bit(),
-                                  value);
+    return ISource::configure(settings) && ok;
+}
 
-    globalGain_ = SoapySDRDevice_getGain(sdr_, SOAPY_SDR_RX, channel_);
-    for (const auto &gainElem : specificGains_)
+QWidget *SoapySdrRadio::getWidget()
+{
+    // Nothing to show without the runtime library
+    if (widget_ == nullptr && initialised_)
     {
-        auto nameint = gainElem.first.toLocal8Bit();
-        specificGains_[gainElem.first] =
-            SoapySDRDevice_getGainElement(sdr_, SOAPY_SDR_RX, channel_, nameint);
+        widget_ = std::make_unique<SoapySdrWidget>(this);
+        if (sdr_ != nullptr)
+        {
+            widget_->deviceRead();
+        }
+        else if (devicesEnumerated_)
+        {
+            widget_->devicesDiscovered(); // Which makes the first device
+        }
+        if (running_)
+        {
+            widget_->deviceStarted();
+        }
     }
-    widget_->syncUi();
+    return static_cast<QWidget *>(widget_.get());
 }
 
 #define SOAPY_LOAD_LIBRARY_FUNCION(funcname)                                      \
@@ -806,6 +1999,8 @@ bool SoapySdrRadio::initialiseLibrary()
     SOAPY_LOAD_LIBRARY_FUNCION(SoapySDRDevice_setAntenna);
     SOAPY_LOAD_LIBRARY_FUNCION(SoapySDRDevice_getBandwidthRange);
     SOAPY_LOAD_LIBRARY_FUNCION(SoapySDRDevice_getStreamMTU);
+    SOAPY_LOAD_LIBRARY_FUNCION(SoapySDRDevice_getStreamFormats);
+    SOAPY_LOAD_LIBRARY_FUNCION(SoapySDRDevice_getNativeStreamFormat);
     SOAPY_LOAD_LIBRARY_FUNCION(SoapySDR_errToStr);
     SOAPY_LOAD_LIBRARY_FUNCION(SoapySDRDevice_getHardwareInfo);
 
@@ -9,16 +9,31 @@
 #pragma once
 
 #include "ISource.hpp"
+#include "control_mailbox.hpp"
+#include "sample_block.hpp"
+#include "soapysdr_capability_cache.hpp"
+#include "soapysdr_device_info.hpp"
 #include "soapysdr_types.hpp"
 #include "soapysdr_widget.hpp"
+#include "spsc_ring_buffer.hpp"
+#include "stream_recovery.hpp"
+#include "stream_timeline.hpp"
+#include "task_queue.hpp"
 
 #include <QLibrary>
+#include <QObject>
 #include <QString>
 #include <QWidget>
 
+#include <atomic>
 #include <complex>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <thread>
+#include <utility>
 #include <vector>
 
 class SoapySdrRadio : public ISource
@@ -31,36 +46,99 @@ class SoapySdrRadio : public ISource
 
     // Device ----------------------------------------------------------------------------
   private:
-    std::vector<SoapySDRKwargs> devicesFound_;
+    // Enumerating, opening and probing devices run on `deviceTasks_`. Their results are
+    // applied on the thread that owns the radio (the GUI thread), through `owner_`, so
+    // the members below are only ever touched from there. The owner never calls the
+    // driver itself: outside of streaming, every call on the device goes through
+    // `deviceTasks_`, one at a time, and `start()` waits for it.
+    TaskQueue deviceTasks_;
+    QObject owner_;
+    void postToOwner(std::function<void()> task);
+
     std::map<QString, QString> deviceStrings_; // Label: kwargs
-    void discoverDevices();
+    bool devicesEnumerated_;
+    std::map<QString, QString> enumerateDevices(); // Device thread
+    void devicesDiscovered(const std::map<QString, QString> &deviceStrings);
+    void pollHotplug(); // Device thread
 
     SoapySDRDevice *sdr_;
-    void readDevice();
+    uint64_t deviceRequest_; // Devices opened for an older request are closed right away
+    // Device thread
+    SoapySdrCapabilityCache capabilityCache_;
+    // Every device opened and not closed yet, whoever it ended up with. Closed by the
+    // destructor, as stopping the device thread drops the closes still queued.
+    std::set<SoapySDRDevice *> openDevices_;
+    SoapySDRDevice *openDevice(const QString &sourceString);
+    size_t validChannel(SoapySDRDevice *sdr, size_t channel);
+    void tuneDevice(SoapySDRDevice *sdr, size_t channel,
+                    const std::vector<size_t> &channels, double centreFrequency);
+    SoapySdrDeviceInfo probeDevice(SoapySDRDevice *sdr, size_t channel);
+    void closeDevice(SoapySDRDevice *sdr);
+    void deviceOpened(SoapySDRDevice *sdr, const SoapySdrDeviceInfo &info);
+    void deviceValidated(SoapySDRDevice *sdr, const SoapySdrDeviceInfo &info);
+    void releaseDevice();
 
   public:
+    // Return at once; the widget hears back once the device thread is done
+    void discoverDevicesAsync();
+    void makeDeviceAsync(const QString &sourceString);
+    // Wait for the device thread, for when there's no GUI to keep responsive
+    void discoverDevices();
     void makeDevice(const QString &sourceString);
     void unmakeDevice();
     [[nodiscard]] std::map<QString, QString> getDeviceStrings() const
     {
         return deviceStrings_;
     };
+    [[nodiscard]] bool hasDevice() const
+    {
+        return sdr_ != nullptr;
+    };
 
     // Acquisition -----------------------------------------------------------------------
   private:
     // Samples
     std::thread *worker_;
-    bool running_;
+    std::atomic<bool> running_;
     void worker();
 
+    // The worker only reads into the ring; the dispatcher drains it into the listeners so
+    // that a slow listener can't stall the device.
+    std::thread *dispatcher_;
+    std::atomic<bool> acquiring_;
+    std::unique_ptr<SpscRingBuffer<SampleBlockPtr>> ring_;
+    std::shared_ptr<SampleBlockPool> pool_;
+    void dispatcher();
+
+    // Stream accounting, written by the worker and readable from anywhere
+    StreamTimeline timeline_;
+    std::atomic<size_t> overflows_;
+    std::atomic<size_t> timeouts_;
+    std::atomic<size_t> streamErrors_;
+
+    // Failed reads are handed to `recovery_`, which decides when to back off and bring
+    // the stream back instead of hammering a dead device
+    StreamRecovery recovery_;
+    SoapySDRStream *openStream(const std::vector<size_t> &channels);
+    void closeStream(SoapySDRStream *rxStream);
+    // Waits out the backoff then tries `action`, false if that failed
+    bool recoverStream(SoapySDRStream *&rxStream, RecoveryAction action,
+                       const std::vector<size_t> &channels);
+
   public:
     void start() override;
     void stop() override;
+    SourceStatistics getStatistics() override;
 
     // Channels --------------------------------------------------------------------------
   private:
     size_t channelCount_;
-    size_t channel_;
+    size_t channel_; // The one being configured (antenna, gains...)
+
+    // Channels streamed together, time aligned, in one multi-channel block. Empty means
+    // just `channel_`. Frequency, sample rate and bandwidth apply to all of them.
+    std::vector<size_t> streamChannels_;
+    [[nodiscard]] std::vector<size_t> getActiveChannels() const;
 
   public:
     [[nodiscard]] size_t getChannelCount() const
@@ -72,6 +150,11 @@ class SoapySdrRadio : public ISource
         return channel_;
     };
     void setChannel(size_t channel);
+    [[nodiscard]] std::vector<size_t> getStreamChannels() const
+    {
+        return getActiveChannels();
+    };
+    void setStreamChannels(const std::vector<size_t> &channels);
 
     // Antennas --------------------------------------------------------------------------
   private:
@@ -89,9 +172,39 @@ class SoapySdrRadio : public ISource
     };
     void setAntenna(const QString &antenna);
 
+    // Stream format ---------------------------------------------------------------------
+  private:
+    // Streaming the device's native integer format avoids a conversion in the driver and
+    // halves (CS16) or quarters (CS8) the memory traffic. We convert to CF32 ourselves.
+    std::vector<QString> supportedStreamFormats_;
+    QString nativeStreamFormat_;
+    double nativeFullScale_;
+    QString streamFormat_;
+    [[nodiscard]] double getStreamFullScale() const;
+
+  public:
+    [[nodiscard]] std::vector<QString> getSupportedStreamFormats() const
+    {
+        return supportedStreamFormats_;
+    };
+    [[nodiscard]] QString getStreamFormat() const
+    {
+        return streamFormat_;
+    };
+    void setStreamFormat(const QString &format);
+
     // Frequency -------------------------------------------------------------------------
   private:
-    double centreFrequency_;
+    std::atomic<double> centreFrequency_;
+
+    // Before retuning, the worker reads out what the driver has buffered, still under the
+    // old frequency. The first block after is tagged `SampleBlockRetuned`. With hardware
+    // time, samples stamped before the retune can have taken effect are dropped, as are
+    // those within the settle time (the PLL locking). Without, samples the driver only
+    // gets after the drain (in flight on the bus) can't be told apart: only the settle
+    // time, counted from the first read after the retune, covers them.
+    std::atomic<double> retuneSettle_; // s
+    std::atomic<size_t> retunes_;
 
   public:
     double getCentreFrequency() override
@@ -99,6 +212,11 @@ class SoapySdrRadio : public ISource
         return centreFrequency_;
     };
     void setCentreFrequency(double centreFrequency) override;
+    [[nodiscard]] double getRetuneSettle() const
+    {
+        return retuneSettle_;
+    };
+    void setRetuneSettle(double seconds);
 
     // Sample rate -----------------------------------------------------------------------
   private:
@@ -193,14 +311,75 @@ class SoapySdrRadio : public ISource
     };
     void setSpecificGain(const QString &name, double value);
 
+    // Control ---------------------------------------------------------------------------
+  private:
+    // The setters above validate and keep the requested value, then submit a control
+    // change and return. Changes go through the mailbox to whoever owns the device: the
+    // worker between two reads while streaming, the device thread otherwise. Either
+    // takes everything queued at once and only applies the latest value of each setting,
+    // so dragging a slider costs one device write per drain rather than one per tick.
+    // What was applied, read back from the device, is published as a snapshot for any
+    // thread and synced back to the members here once nothing newer is in flight.
+    struct Control
+    {
+        enum Kind
+        {
+            CentreFrequency,
+            SampleRate,
+            StreamChannels, // Brings the streamed channels to the same settings
+            Antenna,
+            Bandwidth,
+            Agc,
+            GlobalGain,
+            SpecificGain
+        } kind;
+        double value;
+        QString name; // Of the antenna or gain element
+    };
+    ControlMailbox<Control> controls_;
+    std::atomic<uint64_t> controlsSubmitted_;
+    std::atomic<bool> consuming_; // By the worker or the device thread, never both
+    void submitControl(const Control &control);
+    size_t takeControls(std::vector<Control> &latest);
+    void applyControl(SoapySDRDevice *sdr, const Control &control, SoapySdrState &state);
+    void applyQueuedControls(SoapySDRDevice *sdr); // Device thread
+    void controlsApplied(const SoapySdrState &state);
+
+    // The owner publishes its settings, the consumer what it applied, each leaving the
+    // other's fields alone
+    std::shared_ptr<const SoapySdrState> state_;
+    [[nodiscard]] SoapySdrState makeState() const;
+    template <typename Update>
+    std::shared_ptr<const SoapySdrState> updateState(const Update &update);
+    void publishSettings();
+    void publishDevice();
+    std::shared_ptr<const SoapySdrState> publishApplied(const SoapySdrState &applied,
+                                                        uint64_t taken, bool changed);
+
+    std::mutex waitersMutex_;
+    std::vector<std::pair<uint64_t, std::promise<SoapySdrState>>> waiters_;
+    std::atomic<size_t> waiting_;
+    void resolveWaiters(const SoapySdrState &state);
+
+  public:
+    // Any thread
+    [[nodiscard]] std::shared_ptr<const SoapySdrState> getState() const;
+    // Resolves, on the thread that applied them, once every change submitted so far is
+    // on the device
+    std::future<SoapySdrState> whenApplied();
+
+    // Configuration ---------------------------------------------------------------------
+  public:
+    // Keys: device (kwargs string, the first device found if missing), channel,
+    // channels, stream_format, antenna, sample_rate, bandwidth, agc, gain, gains
+    // (name: value), retune_settle (s) and centre_frequency
+    bool configure(const QJsonObject &settings) override;
+
     // Widget ----------------------------------------------------------------------------
   private:
     std::unique_ptr<SoapySdrWidget> widget_; // Inherits from QWidget
   public:
-    QWidget *getWidget() override
-    {
-        return static_cast<QWidget *>(widget_.get());
-    };
+    QWidget *getWidget() override;
 
     // Runtime library -------------------------------------------------------------------
   private:
@@ -250,6 +429,8 @@ class SoapySdrRadio : public ISource
     SoapySDRDevice_setAntenna_t SoapySDRDevice_setAntenna;
     SoapySDRDevice_getBandwidthRange_t SoapySDRDevice_getBandwidthRange;
     SoapySDRDevice_getStreamMTU_t SoapySDRDevice_getStreamMTU;
+    SoapySDRDevice_getStreamFormats_t SoapySDRDevice_getStreamFormats;
+    SoapySDRDevice_getNativeStreamFormat_t SoapySDRDevice_getNativeStreamFormat;
     SoapySDR_errToStr_t SoapySDR_errToStr;
     SoapySDRDevice_getHardwareInfo_t SoapySDRDevice_getHardwareInfo;
 };
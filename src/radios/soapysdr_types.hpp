@@ -8,12 +8,33 @@
 
 #pragma once
 
+#include <cstddef>
+
 #define SOAPY_LIBRARY_NAME "SoapySDR"
+#define SOAPY_LIBRARY_ENV "AETHER_SOAPY_LIBRARY" // Overrides the above, e.g. for testing
 #define SOAPY_SDR_RX 1
 #define SOAPY_SDR_CF32 "CF32"
+#define SOAPY_SDR_CS16 "CS16"
+#define SOAPY_SDR_CS8 "CS8"
+#define SOAPY_SDR_END_BURST (1 << 1)
+#define SOAPY_SDR_HAS_TIME (1 << 2)
+#define SOAPY_SDR_TIMEOUT (-1)
+#define SOAPY_SDR_STREAM_ERROR (-2)
+#define SOAPY_SDR_OVERFLOW (-4)
+#define SOAPY_SDR_NOT_SUPPORTED (-5)
 #define SOAPY_INITIAL_CENTRE_FREQUENCY 100'000'000.0
 #define SOAPY_INITIAL_SAMPLE_RATE 2'000'000.0
 #define SOAPY_FRAME_TIMEOUT 500000
+#define SOAPY_RETUNE_DRAIN_READS 64 // Reads at most, of what came before a retune
+#define SOAPY_RING_BLOCKS 32
+#define SOAPY_POOL_BLOCKS 64
+#define SOAPY_DISPATCH_WAIT 100000
+#define SOAPY_CONTROL_MAILBOX 64 // Control changes queued for the worker
+#define SOAPY_RECOVERY_WAIT_SLICE 50 // ms, how soon stop() interrupts a recovery backoff
+#define SOAPY_HOTPLUG_INTERVAL 3000 // ms between looking for devices plugged in or out
+#define SOAPY_CACHE_ENV "AETHER_SOAPY_CACHE" // Overrides where devices are cached
+#define SOAPY_CACHE_FILE_NAME "soapysdr_devices.json"
+#define SOAPY_CACHE_VERSION 1
 
 struct SoapySDRKwargs
 {
@@ -106,5 +127,10 @@ using SoapySDRDevice_getBandwidthRange_t = SoapySDRRange *(*)(const SoapySDRDevi
                                                               size_t *);
 using SoapySDRDevice_getStreamMTU_t = size_t (*)(const SoapySDRDevice *,
                                                  SoapySDRStream *);
+using SoapySDRDevice_getStreamFormats_t = char **(*)(const SoapySDRDevice *, const int,
+                                                    const size_t, size_t *);
+using SoapySDRDevice_getNativeStreamFormat_t = char *(*)(const SoapySDRDevice *,
+                                                         const int, const size_t,
+                                                         double *);
 using SoapySDR_errToStr_t = const char *(*)(const int);
 using SoapySDRDevice_getHardwareInfo_t = SoapySDRKwargs (*)(const SoapySDRDevice *device);
@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <vector>
 
 // NOLINTNEXTLINE(fuchsia-statically-constructed-objects,cert-err58-cpp)
 static const QString customTxt{"[Custom]"};
@@ -104,7 +105,8 @@ static QString convertToUnits(double l_nvalue, const QString &suffix)
 SoapySdrWidget::SoapySdrWidget(SoapySdrRadio *radio)
     : radio_(radio), running_(false), layout_(new QFormLayout(this)),
       deviceCombo_(new QComboBox(this)), deviceLineEdit_(new QLineEdit(this)),
-      channelCombo_(new QComboBox(this)), antennaCombo_(new QComboBox(this)),
+      channelCombo_(new QComboBox(this)), allChannelsBox_(new QCheckBox(this)),
+      antennaCombo_(new QComboBox(this)), formatCombo_(new QComboBox(this)),
       sampleRateCombo_(new QComboBox(this)), sampleRateBox_(new QDoubleSpinBox(this)),
       bandwidthCombo_(new QComboBox(this)), bandwidthBox_(new QDoubleSpinBox(this)),
       agcBox_(new QCheckBox(this)), unifiedGainSlider_(new QSlider(Qt::Horizontal, this))
@@ -115,7 +117,9 @@ SoapySdrWidget::SoapySdrWidget(SoapySdrRadio *radio)
     layout_->addRow("Device", deviceCombo_);
     layout_->addRow("Dev. (custom)", deviceLineEdit_);
     layout_->addRow("Channel", channelCombo_);
+    layout_->addRow("All channels", allChannelsBox_);
     layout_->addRow("Antenna", antennaCombo_);
+    layout_->addRow("Format", formatCombo_);
     layout_->addRow("Sample rate", sampleRateCombo_);
     layout_->addRow("S.R. (custom)", sampleRateBox_);
     layout_->addRow("Bandwidth", bandwidthCombo_);
@@ -140,7 +144,9 @@ SoapySdrWidget::SoapySdrWidget(SoapySdrRadio *radio)
 
     // Disable most of the stuff while there isn't a device chosen
     channelCombo_->setEnabled(false);
+    allChannelsBox_->setEnabled(false);
     antennaCombo_->setEnabled(false);
+    formatCombo_->setEnabled(false);
     sampleRateCombo_->setEnabled(false);
     sampleRateBox_->setEnabled(false);
     bandwidthCombo_->setEnabled(false);
@@ -151,8 +157,18 @@ SoapySdrWidget::SoapySdrWidget(SoapySdrRadio *radio)
     // Connect (the easy) slots
     connect(channelCombo_, &QComboBox::currentIndexChanged,
             [&](int idx) { radio_->setChannel(static_cast<size_t>(idx)); });
+    connect(allChannelsBox_, &QCheckBox::toggled, [&](bool checked) {
+        std::vector<size_t> channels;
+        for (auto i = 0U; checked && i < radio_->getChannelCount(); i++)
+        {
+            channels.push_back(i);
+        }
+        radio_->setStreamChannels(channels);
+    });
     connect(antennaCombo_, &QComboBox::currentTextChanged,
             [&](const QString &ant) { radio_->setAntenna(ant); });
+    connect(formatCombo_, &QComboBox::currentTextChanged,
+            [&](const QString &format) { radio_->setStreamFormat(format); });
     connect(agcBox_, &QCheckBox::toggled, [&](bool checked) { radio_->setAgc(checked); });
     connect(unifiedGainSlider_, &QSlider::valueChanged,
             [&](int value) { radio_->setGlobalGain(static_cast<double>(value)); });
@@ -162,7 +178,7 @@ SoapySdrWidget::SoapySdrWidget(SoapySdrRadio *radio)
         if (text != customTxt)
         {
             deviceLineEdit_->setText(radio_->getDeviceStrings()[text]);
-            radio_->makeDevice(deviceLineEdit_->text());
+            radio_->makeDeviceAsync(deviceLineEdit_->text());
             deviceLineEdit_->setEnabled(false);
             return;
         }
@@ -171,7 +187,7 @@ SoapySdrWidget::SoapySdrWidget(SoapySdrRadio *radio)
 
     // Handle changing device on the line edit;
     connect(deviceLineEdit_, &QLineEdit::returnPressed,
-            [&]() { radio_->makeDevice(deviceLineEdit_->text()); });
+            [&]() { radio_->makeDeviceAsync(deviceLineEdit_->text()); });
 
     // Handle changing sample rate
     connect(sampleRateCombo_, &QComboBox::currentIndexChanged, [&](int idx) {
@@ -224,11 +240,21 @@ void SoapySdrWidget::syncUi()
     channelCombo_->setEnabled(!running_ && channelCombo_->count() > 1);
     channelCombo_->blockSignals(false);
 
+    allChannelsBox_->blockSignals(true);
+    allChannelsBox_->setChecked(radio_->getStreamChannels().size() > 1);
+    allChannelsBox_->setEnabled(!running_ && radio_->getChannelCount() > 1);
+    allChannelsBox_->blockSignals(false);
+
     antennaCombo_->blockSignals(true);
     antennaCombo_->setCurrentText(radio_->getAntenna());
     antennaCombo_->setEnabled(antennaCombo_->count() > 1);
     antennaCombo_->blockSignals(false);
 
+    formatCombo_->blockSignals(true);
+    formatCombo_->setCurrentText(radio_->getStreamFormat());
+    formatCombo_->setEnabled(!running_ && formatCombo_->count() > 1);
+    formatCombo_->blockSignals(false);
+
     sampleRateCombo_->blockSignals(true);
     sampleRateBox_->blockSignals(true);
     auto supportedSampleRatedDiscrete = radio_->getSupportedSampleRatesDiscrete();
@@ -314,9 +340,35 @@ void SoapySdrWidget::syncUi()
 
 void SoapySdrWidget::devicesDiscovered()
 {
+    // Rescanning (e.g. a device was plugged in) keeps the current choice if it's still
+    // there, without reopening it
+    auto previous = deviceCombo_->currentText();
+
+    deviceCombo_->blockSignals(true);
+    deviceCombo_->clear();
+    auto devices = radio_->getDeviceStrings();
+    for (const auto &dev : devices)
+    {
+        deviceCombo_->addItem(dev.first);
+    }
+    deviceCombo_->addItem(customTxt);
+    auto previousIdx = deviceCombo_->findText(previous);
+    if (previousIdx >= 0)
+    {
+        deviceCombo_->setCurrentIndex(previousIdx);
+    }
+    deviceCombo_->blockSignals(false);
+
+    if (previousIdx >= 0)
+    {
+        return;
+    }
+
     // Disable most of the stuff while there isn't a device chosen
     channelCombo_->setEnabled(false);
+    allChannelsBox_->setEnabled(false);
     antennaCombo_->setEnabled(false);
+    formatCombo_->setEnabled(false);
     sampleRateCombo_->setEnabled(false);
     sampleRateBox_->setEnabled(false);
     bandwidthCombo_->setEnabled(false);
@@ -328,16 +380,6 @@ void SoapySdrWidget::devicesDiscovered()
         separateGainSliders_[slider.first]->setEnabled(false);
     }
 
-    deviceCombo_->blockSignals(true);
-    deviceCombo_->clear();
-    auto devices = radio_->getDeviceStrings();
-    for (const auto &dev : devices)
-    {
-        deviceCombo_->addItem(dev.first);
-    }
-    deviceCombo_->addItem(customTxt);
-    deviceCombo_->blockSignals(false);
-
     deviceLineEdit_->clear();
 
     if (deviceCombo_->count() > 0)
@@ -350,7 +392,9 @@ void SoapySdrWidget::deviceDestroyed()
 {
     // Disable most of the stuff while there isn't a device chosen
     channelCombo_->setEnabled(false);
+    allChannelsBox_->setEnabled(false);
     antennaCombo_->setEnabled(false);
+    formatCombo_->setEnabled(false);
     sampleRateCombo_->setEnabled(false);
     sampleRateBox_->setEnabled(false);
     bandwidthCombo_->setEnabled(false);
@@ -400,6 +444,15 @@ void SoapySdrWidget::deviceRead()
     }
     antennaCombo_->blockSignals(false);
 
+    formatCombo_->blockSignals(true);
+    formatCombo_->clear();
+    auto formats = radio_->getSupportedStreamFormats();
+    for (const auto &format : formats)
+    {
+        formatCombo_->addItem(format);
+    }
+    formatCombo_->blockSignals(false);
+
     sampleRateCombo_->blockSignals(true);
     sampleRateBox_->blockSignals(true);
     sampleRateCombo_->clear();
@@ -45,7 +45,9 @@ class SoapySdrWidget : public QWidget
     QLineEdit *deviceLineEdit_;
 
     QComboBox *channelCombo_;
+    QCheckBox *allChannelsBox_;
     QComboBox *antennaCombo_;
+    QComboBox *formatCombo_;
 
     QComboBox *sampleRateCombo_;
     QDoubleSpinBox *sampleRateBox_;
@@ -0,0 +1,622 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "file_replay_source.hpp"
+
+#include "file_replay_widget.hpp"
+#include "thread_scheduling.hpp"
+#include "trace_recorder.hpp"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init, hicpp-member-init)
+FileReplaySource::FileReplaySource()
+    : mapped_(nullptr), sigMf_(false), format_(SampleFormat::CF32), totalSamples_(0),
+      worker_(nullptr), running_(false), finished_(false), droppedBlocks_(0),
+      pacing_(SourcePacing::RealTime), loop_(false), position_(0), seekRequest_(-1),
+      blockSize_(REPLAY_BLOCK_SAMPLES), centreFrequency_(REPLAY_INITIAL_CENTRE_FREQUENCY),
+      sampleRate_(REPLAY_INITIAL_SAMPLE_RATE), widget_(nullptr)
+{
+}
+
+FileReplaySource::~FileReplaySource()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+static SampleFormat formatFromSuffix(const QString &suffix)
+{
+    auto lower = suffix.toLower();
+    if (lower == "cs16" || lower == "sc16" || lower == "ci16")
+    {
+        return SampleFormat::CS16;
+    }
+    if (lower == "cs8" || lower == "sc8" || lower == "ci8")
+    {
+        return SampleFormat::CS8;
+    }
+    return SampleFormat::CF32;
+}
+
+bool FileReplaySource::readSigMfMeta(const QString &metaPath)
+{
+    QFile meta(metaPath);
+    if (!meta.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "Couldn't open " << metaPath << ": " << meta.errorString();
+        return false;
+    }
+
+    QJsonParseError error{};
+    auto document = QJsonDocument::fromJson(meta.readAll(), &error);
+    if (document.isNull())
+    {
+        qDebug() << "Couldn't parse " << metaPath << ": " << error.errorString();
+        return false;
+    }
+
+    auto global = document.object()["global"].toObject();
+    auto datatype = global["core:datatype"].toString();
+    if (datatype == "cf32_le")
+    {
+        format_ = SampleFormat::CF32;
+    }
+    else if (datatype == "ci16_le")
+    {
+        format_ = SampleFormat::CS16;
+    }
+    else if (datatype == "ci8")
+    {
+        format_ = SampleFormat::CS8;
+    }
+    else
+    {
+        qDebug() << "Unsupported SigMF datatype: " << datatype;
+        return false;
+    }
+
+    if (global["core:num_channels"].toInt(1) != 1)
+    {
+        qDebug() << "Only single-channel SigMF recordings can be replayed.";
+        return false;
+    }
+
+    sampleRate_ = global["core:sample_rate"].toDouble(sampleRate_);
+
+    captures_.clear();
+    for (const auto &value : document.object()["captures"].toArray())
+    {
+        auto capture = value.toObject();
+        captures_.push_back(
+            {static_cast<uint64_t>(capture["core:sample_start"].toDouble(0)),
+             capture["core:frequency"].toDouble(centreFrequency_)});
+    }
+    std::stable_sort(captures_.begin(), captures_.end(),
+                     [](const ReplayCapture &a, const ReplayCapture &b) {
+                         return a.sampleStart < b.sampleStart;
+                     });
+
+    return true;
+}
+
+bool FileReplaySource::openFile(const QString &path, ReplayFileFormat format)
+{
+    if (running_)
+    {
+        qDebug() << "Can't open a file while running.";
+        return false;
+    }
+
+    closeFile();
+
+    QFileInfo info(path);
+    auto dataPath = path;
+    sigMf_ = info.suffix() == "sigmf-meta" || info.suffix() == "sigmf-data";
+    if (sigMf_)
+    {
+        auto base = info.path() + "/" + info.completeBaseName();
+        if (!readSigMfMeta(base + ".sigmf-meta"))
+        {
+            sigMf_ = false;
+            return false;
+        }
+        dataPath = base + ".sigmf-data";
+    }
+    else
+    {
+        switch (format)
+        {
+        case ReplayFileFormat::Auto:
+            format_ = formatFromSuffix(info.suffix());
+            break;
+        case ReplayFileFormat::CF32:
+            format_ = SampleFormat::CF32;
+            break;
+        case ReplayFileFormat::CS16:
+            format_ = SampleFormat::CS16;
+            break;
+        case ReplayFileFormat::CS8:
+            format_ = SampleFormat::CS8;
+            break;
+        }
+    }
+
+    auto file = std::make_shared<QFile>(dataPath);
+    if (!file->open(QIODevice::ReadOnly))
+    {
+        qDebug() << "Couldn't open " << dataPath << ": " << file->errorString();
+        captures_.clear();
+        return false;
+    }
+
+    // A trailing partial sample is ignored
+    auto bytes = bytesPerSample(format_);
+    auto samples = static_cast<uint64_t>(file->size()) / bytes;
+    if (samples == 0)
+    {
+        qDebug() << "Nothing to replay in " << dataPath;
+        captures_.clear();
+        return false;
+    }
+
+    // The whole file is mapped at once; the kernel only pages in what is replayed, so
+    // this is fine for multi-GB recordings on 64-bit hosts.
+    mapped_ = file->map(0, static_cast<qint64>(samples * bytes),
+                        QFileDevice::MapPrivateOption);
+    if (mapped_ == nullptr)
+    {
+        qDebug() << "Couldn't map " << dataPath << ": " << file->errorString();
+        captures_.clear();
+        return false;
+    }
+
+    file_ = std::move(file);
+    fileName_ = dataPath;
+    totalSamples_ = samples;
+    position_ = 0;
+    if (!captures_.empty())
+    {
+        centreFrequency_ = captures_.front().centreFrequency;
+    }
+
+    qDebug() << "Replaying " << fileName_ << ": " << totalSamples_ << " samples, "
+             << captures_.size() << " captures.";
+
+    if (widget_ != nullptr)
+    {
+        widget_->fileOpened();
+    }
+    return true;
+}
+
+void FileReplaySource::closeFile()
+{
+    if (running_)
+    {
+        qDebug() << "Can't close the file while running.";
+        return;
+    }
+
+    // Blocks still held by listeners keep their pool, and so the mapping, alive
+    viewPool_.reset();
+    pool_.reset();
+    file_.reset();
+    mapped_ = nullptr;
+    fileName_.clear();
+    sigMf_ = false;
+    totalSamples_ = 0;
+    captures_.clear();
+    position_ = 0;
+
+    if (widget_ != nullptr)
+    {
+        widget_->fileClosed();
+    }
+}
+
+size_t FileReplaySource::nextCapture(uint64_t sample) const
+{
+    auto next = std::upper_bound(
+        captures_.begin(), captures_.end(), sample,
+        [](uint64_t s, const ReplayCapture &capture) { return s < capture.sampleStart; });
+    return static_cast<size_t>(std::distance(captures_.begin(), next));
+}
+
+void FileReplaySource::applyCapture(size_t next)
+{
+    if (next == 0)
+    {
+        return;
+    }
+
+    centreFrequency_ = captures_[next - 1].centreFrequency;
+}
+
+void FileReplaySource::worker()
+{
+    // Before anything is allocated, so the blocks land on this CPU's NUMA node
+    applyThreadProfile(scheduling_.acquisition);
+    TraceRecorder::nameThread("file replay acquisition");
+
+    // CF32 needs no storage, the blocks point into the mapping
+    if (format_ == SampleFormat::CF32)
+    {
+        viewPool_ = SampleBlockPool::makeViews(REPLAY_POOL_BLOCKS, blockSize_, file_);
+    }
+    else
+    {
+        pool_ = SampleBlockPool::make(REPLAY_POOL_BLOCKS, blockSize_);
+    }
+
+    auto bytes = bytesPerSample(format_);
+    auto scale = static_cast<float>(1.0 / defaultFullScale(format_));
+    auto *pool = format_ == SampleFormat::CF32 ? viewPool_.get() : pool_.get();
+
+    // Sync up the listeners
+    for (const auto &listener : listeners_)
+    {
+        listener->setSampleRate(sampleRate_);
+        listener->setCentreFrequency(centreFrequency_);
+    }
+
+    timeline_.reset(sampleRate_);
+    droppedBlocks_ = 0;
+
+    double tunedFrequency = centreFrequency_;
+    bool retuned = false; // Until the first block after it is delivered
+
+    uint64_t position = position_;
+    auto next = nextCapture(position);
+    applyCapture(next);
+
+    PacingClock pacing;
+    pacing.reset(sampleRate_);
+
+    while (running_)
+    {
+        auto seek = seekRequest_.exchange(-1);
+        if (seek >= 0)
+        {
+            position = std::min(static_cast<uint64_t>(seek), totalSamples_);
+            next = nextCapture(position);
+            applyCapture(next);
+            timeline_.markDiscontinuity();
+            pacing.reset(sampleRate_);
+        }
+
+        if (position >= totalSamples_)
+        {
+            if (!loop_)
+            {
+                qDebug() << "End of recording.";
+                finished_ = true;
+                break;
+            }
+            position = 0;
+            next = nextCapture(position);
+            applyCapture(next);
+            timeline_.markDiscontinuity();
+        }
+
+        while (next < captures_.size() && position >= captures_[next].sampleStart)
+        {
+            applyCapture(++next);
+        }
+
+        // Listeners hear of a retune in step with the samples, right before its first
+        // block
+        double frequency = centreFrequency_;
+        if (frequency != tunedFrequency)
+        {
+            tunedFrequency = frequency;
+            retuned = true;
+            traceInstant("retune", "source", "hz", static_cast<int64_t>(frequency));
+            for (const auto &listener : listeners_)
+            {
+                listener->setCentreFrequency(tunedFrequency);
+            }
+        }
+
+        // Blocks stop at capture boundaries, so a retune always lines up with a block
+        auto end = next < captures_.size()
+                       ? std::min(captures_[next].sampleStart, totalSamples_)
+                       : totalSamples_;
+        auto count = static_cast<size_t>(std::min<uint64_t>(blockSize_, end - position));
+
+        if (pacing_ == SourcePacing::RealTime)
+        {
+            pacing.pace(count);
+        }
+        else
+        {
+            pacing.reset(sampleRate_);
+        }
+
+        auto block = pool->acquire();
+        if (!block && pacing_ == SourcePacing::AsFastAsPossible)
+        {
+            // The listeners set the pace: wait for them to give a block back
+            std::this_thread::sleep_for(std::chrono::microseconds(REPLAY_POOL_WAIT));
+            continue;
+        }
+
+        auto timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+        uint32_t blockFlags = 0;
+        auto sampleIndex = timeline_.advance(count, timeNs, false, blockFlags);
+
+        // In real time the recording moves on without slow listeners, like a device
+        auto *samples = mapped_ + position * bytes;
+        position += count;
+        position_ = position;
+
+        if (!block)
+        {
+            droppedBlocks_++;
+            timeline_.markDiscontinuity();
+            continue;
+        }
+
+        if (retuned)
+        {
+            blockFlags |= SampleBlockRetuned;
+            retuned = false;
+        }
+
+        if (format_ == SampleFormat::CF32)
+        {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            block->setView(reinterpret_cast<std::complex<float> *>(samples));
+        }
+        else
+        {
+            convertToCf32(format_, samples, block->data(), count, scale);
+        }
+        block->setSize(count);
+        block->setTimeNs(timeNs);
+        block->setReadNs(timeNs);
+        block->setSampleIndex(sampleIndex);
+        block->setFlags(blockFlags);
+        block->setCentreFrequency(tunedFrequency);
+
+        for (size_t i = 0; i < listeners_.size(); i++)
+        {
+            TraceScope trace("receiveSamples", "listener", "listener",
+                             static_cast<int64_t>(i));
+            listeners_[i]->receiveSamples(block);
+        }
+    }
+}
+
+void FileReplaySource::start()
+{
+    if (running_)
+    {
+        qDebug() << "Already running!";
+        return;
+    }
+
+    if (!isOpen())
+    {
+        qDebug() << "No file to replay.";
+        return;
+    }
+
+    // Played to the end last time, so from the start again
+    if (position_ >= totalSamples_)
+    {
+        position_ = 0;
+    }
+
+    finished_ = false;
+    running_ = true;
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    worker_ = new std::thread(&FileReplaySource::worker, this);
+
+    if (widget_ != nullptr)
+    {
+        widget_->sourceStarted();
+    }
+}
+
+void FileReplaySource::stop()
+{
+    if (!running_)
+    {
+        qDebug() << "Already not running!";
+        return;
+    }
+
+    running_ = false;
+
+    if (worker_ != nullptr)
+    {
+        worker_->join();
+        delete worker_;
+    }
+
+    worker_ = nullptr;
+
+    qDebug() << "Replayed samples: " << timeline_.getSamplesReceived()
+             << ", dropped blocks: " << droppedBlocks_
+             << ", measured sample rate: " << timeline_.getMeasuredSampleRate();
+
+    if (widget_ != nullptr)
+    {
+        widget_->sourceStopped();
+    }
+}
+
+SourceStatistics FileReplaySource::getStatistics()
+{
+    SourceStatistics stats;
+    stats.droppedBlocks = droppedBlocks_;
+    stats.samplesReceived = timeline_.getSamplesReceived();
+    stats.gaps = timeline_.getGaps();
+    stats.lostSamples = timeline_.getLostSamples();
+    stats.measuredSampleRate = timeline_.getMeasuredSampleRate();
+    return stats;
+}
+
+void FileReplaySource::setPacing(SourcePacing pacing)
+{
+    pacing_ = pacing;
+}
+
+void FileReplaySource::setLoop(bool loop)
+{
+    loop_ = loop;
+}
+
+void FileReplaySource::seek(uint64_t sample)
+{
+    sample = std::min(sample, totalSamples_);
+    if (running_ && !finished_)
+    {
+        seekRequest_ = static_cast<int64_t>(sample);
+        return;
+    }
+    seekRequest_ = -1;
+    position_ = sample;
+}
+
+void FileReplaySource::setBlockSize(size_t blockSize)
+{
+    if (running_)
+    {
+        qDebug() << "Can't change the block size while running.";
+        return;
+    }
+
+    blockSize_ = std::max<size_t>(blockSize, 1);
+}
+
+void FileReplaySource::setCentreFrequency(double centreFrequency)
+{
+    centreFrequency_ = centreFrequency;
+
+    // The worker passes it on with the next block
+    if (running_)
+    {
+        return;
+    }
+
+    for (const auto &listener : listeners_)
+    {
+        listener->setCentreFrequency(centreFrequency_);
+    }
+}
+
+void FileReplaySource::setSampleRate(double sampleRate)
+{
+    if (running_)
+    {
+        qDebug() << "Can't change the sample rate while running.";
+        return;
+    }
+
+    if (sampleRate <= 0)
+    {
+        qDebug() << "Invalid sample rate: " << sampleRate;
+        return;
+    }
+
+    sampleRate_ = sampleRate;
+}
+
+bool FileReplaySource::configure(const QJsonObject &settings)
+{
+    if (running_)
+    {
+        qDebug() << "Can't configure while running.";
+        return false;
+    }
+
+    auto ok = true;
+    if (settings.contains("file"))
+    {
+        auto formatName = settings["format"].toString("auto");
+        auto format = ReplayFileFormat::Auto;
+        if (formatName == "cf32")
+        {
+            format = ReplayFileFormat::CF32;
+        }
+        else if (formatName == "cs16")
+        {
+            format = ReplayFileFormat::CS16;
+        }
+        else if (formatName == "cs8")
+        {
+            format = ReplayFileFormat::CS8;
+        }
+        else if (formatName != "auto")
+        {
+            qDebug() << "Unknown replay format: " << formatName;
+            ok = false;
+        }
+        ok &= openFile(settings["file"].toString(), format);
+    }
+    // SigMF recordings know their own sample rate
+    if (settings.contains("sample_rate") && !sigMf_)
+    {
+        setSampleRate(settings["sample_rate"].toDouble());
+        ok &= sampleRate_ == settings["sample_rate"].toDouble();
+    }
+    if (settings.contains("pacing"))
+    {
+        SourcePacing pacing{};
+        if (parseSourcePacing(settings["pacing"].toString().toStdString(), pacing))
+        {
+            setPacing(pacing);
+        }
+        else
+        {
+            qDebug() << "Unknown pacing: " << settings["pacing"];
+            ok = false;
+        }
+    }
+    if (settings.contains("loop"))
+    {
+        setLoop(settings["loop"].toBool());
+    }
+    if (settings.contains("block_size"))
+    {
+        setBlockSize(static_cast<size_t>(settings["block_size"].toInt()));
+    }
+
+    return ISource::configure(settings) && ok;
+}
+
+QWidget *FileReplaySource::getWidget()
+{
+    if (widget_ == nullptr)
+    {
+        widget_ = std::make_unique<FileReplayWidget>(this);
+        if (isOpen())
+        {
+            widget_->fileOpened();
+        }
+        if (running_)
+        {
+            widget_->sourceStarted();
+        }
+    }
+    return static_cast<QWidget *>(widget_.get());
+}
@@ -0,0 +1,172 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "ISource.hpp"
+#include "file_replay_types.hpp"
+#include "file_replay_widget.hpp"
+#include "sample_block.hpp"
+#include "sample_conversion.hpp"
+#include "source_pacing.hpp"
+#include "stream_timeline.hpp"
+
+#include <QFile>
+#include <QString>
+#include <QWidget>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Replays a recording (raw CF32/CS16/CS8, or SigMF) through the listeners as if it came
+// from a device. The file is mapped, never read: CF32 blocks are views straight into the
+// mapping, the integer formats are converted block by block.
+class FileReplaySource : public ISource
+{
+  public:
+    FileReplaySource();
+    ~FileReplaySource() override;
+    FileReplaySource(const FileReplaySource &) = delete;
+    FileReplaySource &operator=(const FileReplaySource &) = delete;
+
+    // File ------------------------------------------------------------------------------
+  private:
+    std::shared_ptr<QFile> file_; // Shared with the view blocks, which keep it mapped
+    // Private mapping, so listeners can't write through to the file
+    uchar *mapped_;
+    QString fileName_;
+    bool sigMf_;
+    SampleFormat format_;
+    uint64_t totalSamples_;
+
+    // Seek index, sorted by sample. Only SigMF recordings have captures.
+    std::vector<ReplayCapture> captures_;
+    // Index of the first capture starting after `sample`
+    [[nodiscard]] size_t nextCapture(uint64_t sample) const;
+    bool readSigMfMeta(const QString &metaPath);
+
+  public:
+    bool openFile(const QString &path, ReplayFileFormat format = ReplayFileFormat::Auto);
+    void closeFile();
+    [[nodiscard]] bool isOpen() const
+    {
+        return mapped_ != nullptr;
+    };
+    [[nodiscard]] QString getFileName() const
+    {
+        return fileName_;
+    };
+    [[nodiscard]] bool isSigMf() const
+    {
+        return sigMf_;
+    };
+    [[nodiscard]] SampleFormat getFormat() const
+    {
+        return format_;
+    };
+    [[nodiscard]] uint64_t getTotalSamples() const
+    {
+        return totalSamples_;
+    };
+    [[nodiscard]] std::vector<ReplayCapture> getCaptures() const
+    {
+        return captures_;
+    };
+
+    // Acquisition -----------------------------------------------------------------------
+  private:
+    std::thread *worker_;
+    std::atomic<bool> running_;
+    std::atomic<bool> finished_; // The worker reached the end and returned
+    void worker();
+
+    std::shared_ptr<SampleBlockPool> pool_;     // CS16/CS8, converted into
+    std::shared_ptr<SampleBlockPool> viewPool_; // CF32, zero-copy
+    StreamTimeline timeline_;
+    std::atomic<size_t> droppedBlocks_;
+
+  public:
+    void start() override;
+    void stop() override;
+    bool isFinished() override
+    {
+        return finished_;
+    };
+    SourceStatistics getStatistics() override;
+
+    // Playback --------------------------------------------------------------------------
+  private:
+    std::atomic<SourcePacing> pacing_;
+    std::atomic<bool> loop_;
+    std::atomic<uint64_t> position_;
+    std::atomic<int64_t> seekRequest_; // Negative when there is none
+    size_t blockSize_;
+
+  public:
+    [[nodiscard]] SourcePacing getPacing() const
+    {
+        return pacing_;
+    };
+    void setPacing(SourcePacing pacing);
+    [[nodiscard]] bool getLoop() const
+    {
+        return loop_;
+    };
+    void setLoop(bool loop);
+    // Sample about to be delivered
+    [[nodiscard]] uint64_t getPosition() const
+    {
+        return position_;
+    };
+    // May be called while running, the worker picks it up before its next block. Once
+    // finished, it's where the next `start()` plays from.
+    void seek(uint64_t sample);
+    [[nodiscard]] size_t getBlockSize() const
+    {
+        return blockSize_;
+    };
+    void setBlockSize(size_t blockSize);
+
+    // Frequency -------------------------------------------------------------------------
+  private:
+    std::atomic<double> centreFrequency_;
+    void applyCapture(size_t next); // Tunes to the capture before `next`, if any
+
+  public:
+    double getCentreFrequency() override
+    {
+        return centreFrequency_;
+    };
+    void setCentreFrequency(double centreFrequency) override;
+
+    // Sample rate -----------------------------------------------------------------------
+  private:
+    double sampleRate_;
+
+  public:
+    double getSampleRate() override
+    {
+        return sampleRate_;
+    };
+    // Raw files don't say their sample rate, so it has to be given
+    void setSampleRate(double sampleRate);
+
+    // Configuration ---------------------------------------------------------------------
+  public:
+    // Keys: file, format (auto, cf32, cs16 or cs8), sample_rate, pacing, loop,
+    // block_size and centre_frequency
+    bool configure(const QJsonObject &settings) override;
+
+    // Widget ----------------------------------------------------------------------------
+  private:
+    std::unique_ptr<FileReplayWidget> widget_; // Inherits from QWidget
+  public:
+    QWidget *getWidget() override;
+};
@@ -0,0 +1,33 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#define REPLAY_INITIAL_CENTRE_FREQUENCY 100'000'000.0
+#define REPLAY_INITIAL_SAMPLE_RATE 2'000'000.0
+#define REPLAY_BLOCK_SAMPLES 65536
+#define REPLAY_POOL_BLOCKS 32
+#define REPLAY_POOL_WAIT 100        // us, waiting for a free block when not paced
+#define REPLAY_POSITION_REFRESH 200 // ms
+
+enum class ReplayFileFormat
+{
+    Auto, // SigMF from the metadata, raw files from the extension (CF32 if unknown)
+    CF32,
+    CS16,
+    CS8
+};
+
+// Entry of the seek index: from `sampleStart` on the recording was made at this frequency
+struct ReplayCapture
+{
+    uint64_t sampleStart;
+    double centreFrequency;
+};
@@ -0,0 +1,169 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "file_replay_widget.hpp"
+
+#include "file_replay_source.hpp"
+
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QString>
+
+#include <cmath>
+
+FileReplayWidget::FileReplayWidget(FileReplaySource *source)
+    : source_(source), running_(false), layout_(new QFormLayout(this)),
+      pathLineEdit_(new QLineEdit(this)), browseButton_(new QPushButton("...", this)),
+      formatCombo_(new QComboBox(this)), sampleRateBox_(new QDoubleSpinBox(this)),
+      pacingCombo_(new QComboBox(this)), loopBox_(new QCheckBox(this)),
+      positionBox_(new QDoubleSpinBox(this)), lengthLabel_(new QLabel(this)),
+      positionTimer_(new QTimer(this))
+{
+    setMinimumWidth(1); // Makes parent take control of the size;
+
+    // Setup the layout
+    auto *pathLayout = new QHBoxLayout();
+    pathLayout->addWidget(pathLineEdit_);
+    pathLayout->addWidget(browseButton_);
+    layout_->addRow("File", pathLayout);
+    layout_->addRow("Format", formatCombo_);
+    layout_->addRow("Sample rate", sampleRateBox_);
+    layout_->addRow("Pacing", pacingCombo_);
+    layout_->addRow("Loop", loopBox_);
+    layout_->addRow("Position", positionBox_);
+    layout_->addRow("Length", lengthLabel_);
+
+    // Customize widgets
+    // Same order as `ReplayFileFormat`
+    formatCombo_->addItems({"Auto", "CF32", "CS16", "CS8"});
+    // Same order as `SourcePacing`
+    pacingCombo_->addItems({"Real time", "As fast as possible"});
+
+    sampleRateBox_->setMinimum(1);
+    sampleRateBox_->setMaximum(500'000'000.00); // NOLINT(readability-magic-numbers)
+    sampleRateBox_->setDecimals(2);
+    sampleRateBox_->setSuffix(" Sa/s");
+    sampleRateBox_->setGroupSeparatorShown(true);
+    sampleRateBox_->setKeyboardTracking(false);
+
+    positionBox_->setMinimum(0);
+    positionBox_->setDecimals(3);
+    positionBox_->setSuffix(" s");
+    positionBox_->setKeyboardTracking(false);
+
+    positionTimer_->setInterval(REPLAY_POSITION_REFRESH);
+
+    // Connect (the easy) slots
+    connect(browseButton_, &QPushButton::clicked, [&]() {
+        auto path = QFileDialog::getOpenFileName(
+            this, "Open recording", pathLineEdit_->text(),
+            "Recordings (*.sigmf-meta *.sigmf-data *.cf32 *.fc32 *.cs16 *.sc16 *.cs8 "
+            "*.sc8 *.raw *.bin *.iq);;All files (*)");
+        if (!path.isEmpty())
+        {
+            pathLineEdit_->setText(path);
+            openFile();
+        }
+    });
+    connect(pathLineEdit_, &QLineEdit::returnPressed, [&]() { openFile(); });
+    connect(formatCombo_, &QComboBox::currentIndexChanged, [&]() {
+        if (source_->isOpen())
+        {
+            openFile();
+        }
+    });
+    connect(pacingCombo_, &QComboBox::currentIndexChanged,
+            [&](int idx) { source_->setPacing(static_cast<SourcePacing>(idx)); });
+    connect(loopBox_, &QCheckBox::toggled,
+            [&](bool checked) { source_->setLoop(checked); });
+    connect(positionTimer_, &QTimer::timeout, [&]() {
+        positionBox_->blockSignals(true);
+        positionBox_->setValue(static_cast<double>(source_->getPosition()) /
+                               source_->getSampleRate());
+        positionBox_->blockSignals(false);
+    });
+
+    connect(sampleRateBox_, &QDoubleSpinBox::valueChanged, [&](double value) {
+        source_->setSampleRate(value);
+        syncUi();
+    });
+
+    connect(positionBox_, &QDoubleSpinBox::valueChanged, [&](double value) {
+        auto sample = std::llround(value * source_->getSampleRate());
+        source_->seek(static_cast<uint64_t>(sample));
+    });
+
+    fileClosed();
+}
+
+void FileReplayWidget::openFile()
+{
+    source_->openFile(pathLineEdit_->text(),
+                      static_cast<ReplayFileFormat>(formatCombo_->currentIndex()));
+}
+
+void FileReplayWidget::syncUi()
+{
+    auto open = source_->isOpen();
+    auto duration = static_cast<double>(source_->getTotalSamples()) /
+                    source_->getSampleRate();
+
+    pathLineEdit_->setEnabled(!running_);
+    browseButton_->setEnabled(!running_);
+    formatCombo_->setEnabled(!running_ && !source_->isSigMf());
+
+    sampleRateBox_->blockSignals(true);
+    sampleRateBox_->setValue(source_->getSampleRate());
+    sampleRateBox_->setEnabled(!running_ && !source_->isSigMf());
+    sampleRateBox_->blockSignals(false);
+
+    pacingCombo_->blockSignals(true);
+    pacingCombo_->setCurrentIndex(static_cast<int>(source_->getPacing()));
+    pacingCombo_->blockSignals(false);
+
+    loopBox_->blockSignals(true);
+    loopBox_->setChecked(source_->getLoop());
+    loopBox_->blockSignals(false);
+
+    positionBox_->blockSignals(true);
+    positionBox_->setMaximum(duration);
+    positionBox_->setValue(static_cast<double>(source_->getPosition()) /
+                           source_->getSampleRate());
+    positionBox_->setEnabled(open);
+    positionBox_->blockSignals(false);
+
+    lengthLabel_->setText(open ? QString("%1 samples (%2 s)")
+                                     .arg(source_->getTotalSamples())
+                                     .arg(duration, 0, 'f', 3)
+                               : QString("-"));
+}
+
+void FileReplayWidget::fileOpened()
+{
+    pathLineEdit_->setText(source_->getFileName());
+    syncUi();
+}
+
+void FileReplayWidget::fileClosed()
+{
+    syncUi();
+}
+
+void FileReplayWidget::sourceStarted()
+{
+    running_ = true;
+    positionTimer_->start();
+    syncUi();
+}
+
+void FileReplayWidget::sourceStopped()
+{
+    running_ = false;
+    positionTimer_->stop();
+    syncUi();
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTimer>
+#include <QWidget>
+
+class FileReplaySource;
+
+class FileReplayWidget : public QWidget
+{
+  public:
+    FileReplayWidget() = delete;
+    FileReplayWidget(FileReplaySource *source);
+    ~FileReplayWidget() override = default;
+
+    void syncUi();
+    void fileOpened();
+    void fileClosed();
+    void sourceStarted();
+    void sourceStopped();
+
+  private:
+    FileReplaySource *source_;
+    bool running_;
+
+    QFormLayout *layout_;
+
+    QLineEdit *pathLineEdit_;
+    QPushButton *browseButton_;
+    QComboBox *formatCombo_;
+    QDoubleSpinBox *sampleRateBox_;
+    QComboBox *pacingCombo_;
+    QCheckBox *loopBox_;
+    QDoubleSpinBox *positionBox_;
+    QLabel *lengthLabel_;
+
+    QTimer *positionTimer_; // Follows the playback while running
+    void openFile();
+};
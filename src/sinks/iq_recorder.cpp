@@ -0,0 +1,418 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "iq_recorder.hpp"
+
+#include "trace_recorder.hpp"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <chrono>
+#include <complex>
+#include <cstring>
+#include <new>
+
+static constexpr size_t sampleBytes = sizeof(std::complex<float>);
+
+static uint64_t roundUp(uint64_t value, uint64_t step)
+{
+    return (value + step - 1) / step * step;
+}
+
+void IqRecorder::AlignedDelete::operator()(std::byte *data) const
+{
+    ::operator delete(data, std::align_val_t(IQ_RECORDER_ALIGNMENT));
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init, hicpp-member-init)
+IqRecorder::IqRecorder(const IqRecorderOptions &options)
+    : options_(options), batchBytes_(roundUp(std::max(options.batchBytes, sampleBytes),
+                                             IQ_RECORDER_ALIGNMENT)),
+      recording_(false), current_(nullptr), recorded_(0), expectedIndex_(0),
+      recordedFrequency_(0), pendingCapture_(false), sampleRate_(0), writer_(nullptr),
+      writing_(false), fileNumber_(0), fileFirstSample_(0), fileBytes_(0),
+      hasLastCapture_(false), lastCapture_{0, 0, 0, false}, recordedSamples_(0),
+      droppedSamples_(0), bytesWritten_(0), filesWritten_(0), writeErrors_(0)
+{
+    // All the memory is taken now, recording never allocates
+    batches_.resize(std::max<size_t>(options_.batchCount, 2));
+    for (auto &batch : batches_)
+    {
+        batch.data.reset(static_cast<std::byte *>(
+            ::operator new(batchBytes_, std::align_val_t(IQ_RECORDER_ALIGNMENT))));
+        batch.used = 0;
+        batch.firstSample = 0;
+        batch.firstReadNs = 0;
+        batch.captures.reserve(IQ_RECORDER_BATCH_CAPTURES);
+    }
+}
+
+IqRecorder::~IqRecorder()
+{
+    if (recording_)
+    {
+        stopRecording();
+    }
+}
+
+void IqRecorder::setSampleRate(double sampleRate)
+{
+    if (recording_ && sampleRate != sampleRate_)
+    {
+        qDebug() << "Sample rate changed while recording, the metadata will be wrong.";
+    }
+    sampleRate_ = sampleRate;
+}
+
+void IqRecorder::setCentreFrequency(double /*centreFrequency*/)
+{
+    // Every block carries the frequency it was read at, so retunes are noted as new
+    // captures on the exact sample
+}
+
+void IqRecorder::receiveSamples(const SampleBlockPtr &block)
+{
+    if (!recording_.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    // Only starting or stopping holds the lock, and then this block isn't recorded anyway
+    std::unique_lock<std::mutex> lock(producerMutex_, std::try_to_lock);
+    if (!lock.owns_lock() || !recording_.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    auto count = block->size();
+    auto channel = std::min(options_.channel, block->channelCount() - 1);
+    const auto *samples = block->data(channel);
+
+    // Note where the recorded stream starts, jumps or is retuned
+    auto frequency = block->centreFrequency();
+    if (pendingCapture_ || block->hasFlag(SampleBlockDiscontinuity) ||
+        block->sampleIndex() != expectedIndex_ || frequency != recordedFrequency_)
+    {
+        pendingCapture_ = !addCapture({recorded_, frequency, block->timeNs(),
+                                       block->hasFlag(SampleBlockHasTime)});
+        recordedFrequency_ = frequency;
+    }
+    expectedIndex_ = block->sampleIndex() + count;
+
+    size_t done = 0;
+    while (done < count)
+    {
+        if (current_ == nullptr && !nextBatch())
+        {
+            // Every batch is waiting for the disk
+            droppedSamples_.fetch_add(count - done, std::memory_order_relaxed);
+            pendingCapture_ = true;
+            break;
+        }
+
+        if (current_->used == 0)
+        {
+            current_->firstReadNs = block->readNs();
+        }
+        auto room = (batchBytes_ - current_->used) / sampleBytes;
+        auto n = std::min(room, count - done);
+        std::memcpy(current_->data.get() + current_->used, samples + done,
+                    n * sampleBytes);
+        current_->used += n * sampleBytes;
+        done += n;
+        recorded_ += n;
+
+        if (current_->used + sampleBytes > batchBytes_)
+        {
+            pushBatch();
+        }
+    }
+
+    recordedSamples_.store(recorded_, std::memory_order_relaxed);
+}
+
+bool IqRecorder::nextBatch()
+{
+    auto *slot = free_->readSlot();
+    if (slot == nullptr)
+    {
+        return false;
+    }
+
+    current_ = *slot;
+    free_->commitRead();
+    current_->used = 0;
+    current_->firstSample = recorded_;
+    current_->captures.clear();
+    return true;
+}
+
+void IqRecorder::pushBatch()
+{
+    // Never full: it has room for every batch
+    *full_->writeSlot() = current_;
+    full_->commitWrite();
+    current_ = nullptr;
+}
+
+bool IqRecorder::addCapture(const RecorderCapture &capture)
+{
+    if (current_ == nullptr && !nextBatch())
+    {
+        return false;
+    }
+    if (current_->captures.size() == current_->captures.capacity())
+    {
+        return false;
+    }
+    current_->captures.push_back(capture);
+    return true;
+}
+
+bool IqRecorder::startRecording(const QString &basePath)
+{
+    if (recording_)
+    {
+        qDebug() << "Already recording!";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(producerMutex_);
+
+    full_ = std::make_unique<SpscRingBuffer<Batch *>>(batches_.size());
+    free_ = std::make_unique<SpscRingBuffer<Batch *>>(batches_.size());
+    for (auto &batch : batches_)
+    {
+        *free_->writeSlot() = &batch;
+        free_->commitWrite();
+    }
+
+    current_ = nullptr;
+    recorded_ = 0;
+    pendingCapture_ = true;
+    recordedSamples_ = 0;
+    droppedSamples_ = 0;
+    bytesWritten_ = 0;
+    filesWritten_ = 0;
+    writeErrors_ = 0;
+
+    basePath_ = basePath;
+    fileNumber_ = 0;
+    hasLastCapture_ = false;
+    if (!openNextFile(0))
+    {
+        return false;
+    }
+
+    writing_ = true;
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    writer_ = new std::thread(&IqRecorder::writer, this);
+
+    recording_.store(true, std::memory_order_release);
+    return true;
+}
+
+void IqRecorder::stopRecording()
+{
+    if (!recording_)
+    {
+        qDebug() << "Not recording!";
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(producerMutex_);
+        recording_ = false;
+        if (current_ != nullptr && current_->used > 0)
+        {
+            pushBatch();
+        }
+        current_ = nullptr;
+    }
+
+    writing_ = false;
+    full_->notify();
+
+    if (writer_ != nullptr)
+    {
+        writer_->join();
+        delete writer_;
+    }
+
+    writer_ = nullptr;
+
+    qDebug() << "Recorded samples: " << recordedSamples_
+             << ", dropped samples: " << droppedSamples_ << ", files: " << filesWritten_
+             << ", write errors: " << writeErrors_
+             << ", buffer high-water mark: " << getBufferHighWaterMark() << "/"
+             << getBufferBytes() << " bytes";
+}
+
+void IqRecorder::writer()
+{
+    applyThreadProfile(options_.writerThread);
+    TraceRecorder::nameThread("recorder writer");
+
+    while (true)
+    {
+        auto *slot = full_->readSlot();
+        if (slot == nullptr)
+        {
+            // Only quit once the last batch was written
+            if (!writing_ && full_->readSlot() == nullptr)
+            {
+                break;
+            }
+            full_->waitForData(std::chrono::microseconds(IQ_RECORDER_WRITER_WAIT));
+            continue;
+        }
+
+        auto *batch = *slot;
+        full_->commitRead();
+
+        {
+            TraceScope trace("writeBatch", "sink", "bytes",
+                             static_cast<int64_t>(batch->used));
+            writeBatch(*batch);
+        }
+        if (options_.writeLatency != nullptr)
+        {
+            options_.writeLatency->recordSince(batch->firstReadNs);
+        }
+
+        *free_->writeSlot() = batch;
+        free_->commitWrite();
+    }
+
+    closeFile();
+}
+
+void IqRecorder::writeBatch(Batch &batch)
+{
+    // Files only rotate between batches, so every write stays aligned
+    auto fileSamples = fileBytes_ / sampleBytes;
+    auto rotate = (options_.maxFileBytes > 0 &&
+                   fileBytes_ + batch.used > options_.maxFileBytes) ||
+                  (options_.maxFileSeconds > 0 &&
+                   static_cast<double>(fileSamples) >=
+                       options_.maxFileSeconds * sampleRate_.load());
+    if (fileBytes_ > 0 && rotate)
+    {
+        closeFile();
+        openNextFile(batch.firstSample);
+    }
+
+    for (const auto &capture : batch.captures)
+    {
+        if (!fileCaptures_.empty() && fileCaptures_.back().sample == capture.sample)
+        {
+            fileCaptures_.pop_back();
+        }
+        fileCaptures_.push_back(capture);
+        lastCapture_ = capture;
+        hasLastCapture_ = true;
+    }
+
+    if (!file_.isOpen())
+    {
+        writeErrors_++;
+        return;
+    }
+
+    // Only the very last batch may be partial; pad it, the file is trimmed on close
+    auto bytes = roundUp(batch.used, IQ_RECORDER_ALIGNMENT);
+    std::memset(batch.data.get() + batch.used, 0, bytes - batch.used);
+
+    auto step = options_.maxFileBytes > 0 ? roundUp(options_.maxFileBytes, batchBytes_)
+                                          : IQ_RECORDER_PREALLOCATE_BYTES;
+    file_.preallocate(roundUp(fileBytes_ + bytes, step));
+
+    if (!file_.write(batch.data.get(), bytes, fileBytes_))
+    {
+        writeErrors_++;
+        return;
+    }
+    fileBytes_ += batch.used;
+    bytesWritten_ += batch.used;
+}
+
+bool IqRecorder::openNextFile(uint64_t firstSample)
+{
+    fileName_ = QString("%1_%2").arg(basePath_).arg(fileNumber_++, 4, 10, QChar('0'));
+    fileFirstSample_ = firstSample;
+    fileBytes_ = 0;
+    fileCaptures_.clear();
+
+    // A file starts in the middle of the last capture, so carry it over
+    if (hasLastCapture_)
+    {
+        auto capture = lastCapture_;
+        auto elapsed = static_cast<double>(firstSample - capture.sample) / sampleRate_;
+        // NOLINTNEXTLINE(readability-magic-numbers)
+        capture.timeNs += static_cast<long long>(elapsed * 1e9);
+        capture.sample = firstSample;
+        fileCaptures_.push_back(capture);
+    }
+
+    if (!file_.open(fileName_ + ".sigmf-data", options_.directIo))
+    {
+        return false;
+    }
+
+    qDebug() << "Recording to " << fileName_ << (file_.isDirect() ? " (direct I/O)" : "");
+    return true;
+}
+
+void IqRecorder::closeFile()
+{
+    if (!file_.isOpen())
+    {
+        return;
+    }
+
+    file_.close(fileBytes_);
+    writeMeta();
+    filesWritten_++;
+}
+
+void IqRecorder::writeMeta()
+{
+    QJsonObject global{{"core:datatype", "cf32_le"},
+                       {"core:sample_rate", sampleRate_.load()},
+                       {"core:num_channels", 1},
+                       {"core:version", "1.0.0"},
+                       {"core:recorder", "Aether Explorer"}};
+
+    // Timestamps are in ns, from the device clock if `aether:hardware_time`, otherwise
+    // from the host's steady clock.
+    QJsonArray captures;
+    for (const auto &capture : fileCaptures_)
+    {
+        captures.append(QJsonObject{
+            {"core:sample_start", static_cast<qint64>(capture.sample - fileFirstSample_)},
+            {"core:frequency", capture.centreFrequency},
+            {"aether:time_ns", static_cast<qint64>(capture.timeNs)},
+            {"aether:hardware_time", capture.hardwareTime}});
+    }
+
+    QJsonObject meta{
+        {"global", global}, {"captures", captures}, {"annotations", QJsonArray()}};
+
+    QFile file(fileName_ + ".sigmf-meta");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        file.write(QJsonDocument(meta).toJson()) < 0)
+    {
+        qDebug() << "Couldn't write " << file.fileName() << ": " << file.errorString();
+        writeErrors_++;
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "ISourceListener.hpp"
+#include "iq_recorder_types.hpp"
+#include "recording_file.hpp"
+#include "sample_block.hpp"
+#include "spsc_ring_buffer.hpp"
+
+#include <QString>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Records the stream to SigMF files (CF32) without ever blocking the stream thread.
+// Blocks are copied into large aligned batches, which a writer thread puts on disk. If
+// the disk falls behind by more than the batches can hold, samples are dropped and the
+// gap is noted in the metadata.
+// Files are `<base>_0000.sigmf-data` and `.sigmf-meta`, then `_0001`... as they rotate.
+class IqRecorder : public ISourceListener
+{
+  public:
+    explicit IqRecorder(const IqRecorderOptions &options = IqRecorderOptions());
+    ~IqRecorder() override;
+    IqRecorder(const IqRecorder &) = delete;
+    IqRecorder &operator=(const IqRecorder &) = delete;
+
+    void setSampleRate(double sampleRate) override;
+    void setCentreFrequency(double centreFrequency) override;
+    void receiveSamples(const SampleBlockPtr &block) override;
+
+    bool startRecording(const QString &basePath);
+    void stopRecording();
+    [[nodiscard]] bool isRecording() const
+    {
+        return recording_;
+    };
+
+    // Statistics (any thread) -----------------------------------------------------------
+    [[nodiscard]] uint64_t getRecordedSamples() const
+    {
+        return recordedSamples_;
+    };
+    [[nodiscard]] uint64_t getDroppedSamples() const
+    {
+        return droppedSamples_;
+    };
+    [[nodiscard]] uint64_t getBytesWritten() const
+    {
+        return bytesWritten_;
+    };
+    [[nodiscard]] size_t getFilesWritten() const
+    {
+        return filesWritten_;
+    };
+    [[nodiscard]] size_t getWriteErrors() const
+    {
+        return writeErrors_;
+    };
+    // All the memory the recorder uses for samples
+    [[nodiscard]] size_t getBufferBytes() const
+    {
+        return batches_.size() * batchBytes_;
+    };
+    // Most bytes ever waiting for the disk, in whole batches
+    [[nodiscard]] size_t getBufferHighWaterMark() const
+    {
+        return full_ != nullptr ? full_->highWaterMark() * batchBytes_ : 0;
+    };
+
+  private:
+    struct AlignedDelete
+    {
+        void operator()(std::byte *data) const;
+    };
+
+    struct Batch
+    {
+        std::unique_ptr<std::byte, AlignedDelete> data;
+        size_t used;
+        uint64_t firstSample;
+        long long firstReadNs; // Of the block the first sample came in
+        std::vector<RecorderCapture> captures; // Reserved up front, never grows
+    };
+
+    IqRecorderOptions options_;
+    size_t batchBytes_;
+    std::vector<Batch> batches_;
+
+    // Full batches go to the writer, which gives them back once they're on disk
+    std::unique_ptr<SpscRingBuffer<Batch *>> full_;
+    std::unique_ptr<SpscRingBuffer<Batch *>> free_;
+
+    // Producer side. Only start and stop take the mutex; the stream thread just tries it.
+    std::mutex producerMutex_;
+    std::atomic<bool> recording_;
+    Batch *current_;
+    uint64_t recorded_;
+    uint64_t expectedIndex_;
+    double recordedFrequency_;
+    bool pendingCapture_;
+    bool nextBatch();
+    void pushBatch();
+    bool addCapture(const RecorderCapture &capture);
+
+    std::atomic<double> sampleRate_;
+
+    // Writer side
+    std::thread *writer_;
+    std::atomic<bool> writing_;
+    void writer();
+    void writeBatch(Batch &batch);
+
+    QString basePath_;
+    unsigned fileNumber_;
+    QString fileName_; // Without extension
+    RecordingFile file_;
+    uint64_t fileFirstSample_;
+    uint64_t fileBytes_;
+    std::vector<RecorderCapture> fileCaptures_;
+    bool hasLastCapture_;
+    RecorderCapture lastCapture_;
+    bool openNextFile(uint64_t firstSample);
+    void closeFile();
+    void writeMeta();
+
+    std::atomic<uint64_t> recordedSamples_;
+    std::atomic<uint64_t> droppedSamples_;
+    std::atomic<uint64_t> bytesWritten_;
+    std::atomic<size_t> filesWritten_;
+    std::atomic<size_t> writeErrors_;
+};
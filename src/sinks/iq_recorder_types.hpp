@@ -0,0 +1,48 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "latency_recorder.hpp"
+#include "thread_scheduling.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#define IQ_RECORDER_ALIGNMENT 4096 // Direct I/O needs aligned buffers, sizes and offsets
+#define IQ_RECORDER_BATCH_BYTES (4 * 1024 * 1024)
+#define IQ_RECORDER_BATCH_COUNT 16
+#define IQ_RECORDER_BATCH_CAPTURES 16
+#define IQ_RECORDER_PREALLOCATE_BYTES (1024ULL * 1024 * 1024)
+#define IQ_RECORDER_WRITER_WAIT 100000 // us
+
+// The recorder's memory is `batchBytes * batchCount`, allocated once. That is how much
+// the disk may fall behind the stream before samples are dropped.
+struct IqRecorderOptions
+{
+    size_t batchBytes{IQ_RECORDER_BATCH_BYTES}; // Rounded up to `IQ_RECORDER_ALIGNMENT`
+    size_t batchCount{IQ_RECORDER_BATCH_COUNT}; // Batches queued or being written
+    uint64_t maxFileBytes{0};                   // Rotate by size, 0 for never
+    double maxFileSeconds{0};                   // Rotate by duration, 0 for never
+    bool directIo{true};                        // Bypass the page cache where possible
+    size_t channel{0};                          // Of multi-channel blocks
+    ThreadProfile writerThread;
+    // If set, gets the latency from reading the first sample of each batch to its write
+    std::shared_ptr<LatencyRecorder> writeLatency;
+};
+
+// Where the recorded stream starts, jumps (lost samples) or is retuned. `sample` counts
+// recorded samples since the recording started.
+struct RecorderCapture
+{
+    uint64_t sample;
+    double centreFrequency;
+    long long timeNs;
+    bool hardwareTime;
+};
@@ -0,0 +1,167 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "recording_file.hpp"
+
+#include <QDebug>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+RecordingFile::~RecordingFile()
+{
+#if defined(__linux__)
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+#endif
+}
+
+bool RecordingFile::open(const QString &path, bool directIo)
+{
+    if (isOpen())
+    {
+        qDebug() << "A recording file is already open.";
+        return false;
+    }
+
+    allocated_ = 0;
+    canPreallocate_ = true;
+
+#if defined(__linux__)
+    auto native = QFile::encodeName(path);
+    auto flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    const mode_t mode = 0644; // NOLINT(readability-magic-numbers)
+    if (directIo)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg, hicpp-vararg)
+        fd_ = ::open(native.constData(), flags | O_DIRECT, mode);
+        direct_ = fd_ >= 0;
+    }
+    // Some filesystems (tmpfs, ...) refuse O_DIRECT
+    if (fd_ < 0)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg, hicpp-vararg)
+        fd_ = ::open(native.constData(), flags, mode);
+    }
+    if (fd_ < 0)
+    {
+        qDebug() << "Couldn't open " << path << ": " << std::strerror(errno);
+        return false;
+    }
+#else
+    (void)directIo;
+    file_ = std::make_unique<QFile>(path);
+    if (!file_->open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qDebug() << "Couldn't open " << path << ": " << file_->errorString();
+        file_.reset();
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+void RecordingFile::close(uint64_t size)
+{
+#if defined(__linux__)
+    if (fd_ < 0)
+    {
+        return;
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(size)) != 0)
+    {
+        qDebug() << "ftruncate failed: " << std::strerror(errno);
+    }
+    ::close(fd_);
+    fd_ = -1;
+#else
+    if (file_ == nullptr)
+    {
+        return;
+    }
+    file_->resize(static_cast<qint64>(size));
+    file_->close();
+    file_.reset();
+#endif
+
+    direct_ = false;
+    allocated_ = 0;
+}
+
+bool RecordingFile::isOpen() const
+{
+    return fd_ >= 0 || file_ != nullptr;
+}
+
+void RecordingFile::preallocate(uint64_t bytes)
+{
+    if (!isOpen() || !canPreallocate_ || bytes <= allocated_)
+    {
+        return;
+    }
+
+#if defined(__linux__)
+    // Unlike posix_fallocate, this fails instead of writing zeros where unsupported
+    if (::fallocate(fd_, 0, static_cast<off_t>(allocated_),
+                    static_cast<off_t>(bytes - allocated_)) != 0)
+    {
+        qDebug() << "Can't preallocate the recording: " << std::strerror(errno);
+        canPreallocate_ = false;
+        return;
+    }
+#else
+    if (!file_->resize(static_cast<qint64>(bytes)))
+    {
+        qDebug() << "Can't preallocate the recording: " << file_->errorString();
+        canPreallocate_ = false;
+        return;
+    }
+#endif
+
+    allocated_ = bytes;
+}
+
+bool RecordingFile::write(const void *data, size_t bytes, uint64_t offset)
+{
+    const auto *remaining = static_cast<const char *>(data);
+
+#if defined(__linux__)
+    while (bytes > 0)
+    {
+        auto written = ::pwrite(fd_, remaining, bytes, static_cast<off_t>(offset));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            qDebug() << "Recording write failed: " << std::strerror(errno);
+            return false;
+        }
+        remaining += written;
+        bytes -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+#else
+    if (!file_->seek(static_cast<qint64>(offset)) ||
+        file_->write(remaining, static_cast<qint64>(bytes)) != static_cast<qint64>(bytes))
+    {
+        qDebug() << "Recording write failed: " << file_->errorString();
+        return false;
+    }
+    return true;
+#endif
+}
@@ -0,0 +1,50 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <QFile>
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// A file written in large chunks at known offsets. On Linux it bypasses the page cache
+// (O_DIRECT) if the filesystem allows it, and space is reserved ahead of the writes so
+// the file isn't fragmented. Elsewhere it falls back to a buffered QFile.
+class RecordingFile
+{
+  public:
+    RecordingFile() = default;
+    ~RecordingFile();
+    RecordingFile(const RecordingFile &) = delete;
+    RecordingFile &operator=(const RecordingFile &) = delete;
+
+    bool open(const QString &path, bool directIo);
+    // Trims the file to `size`, dropping what was preallocated or padded, and closes it
+    void close(uint64_t size);
+    [[nodiscard]] bool isOpen() const;
+    [[nodiscard]] bool isDirect() const
+    {
+        return direct_;
+    };
+
+    // Reserves space up to `bytes`, never shrinks the file
+    void preallocate(uint64_t bytes);
+    // With direct I/O `data`, `bytes` and `offset` must all be multiples of
+    // `IQ_RECORDER_ALIGNMENT`.
+    bool write(const void *data, size_t bytes, uint64_t offset);
+
+  private:
+    int fd_{-1};
+    std::unique_ptr<QFile> file_;
+    bool direct_{false};
+    bool canPreallocate_{true};
+    uint64_t allocated_{0};
+};
@@ -8,7 +8,35 @@
 
 #include "ISource.hpp"
 
+#include <QDebug>
+
 void ISource::setListeners(std::vector<ISourceListener *> listeners)
 {
     listeners_ = std::move(listeners);
 };
+
+void ISource::setSchedulingProfile(const SchedulingProfile &profile)
+{
+    scheduling_ = profile;
+}
+
+void ISource::setCpuAffinity(const std::vector<int> &cpus)
+{
+    scheduling_.acquisition.cpus = cpus;
+    scheduling_.dispatch.cpus = cpus;
+}
+
+bool ISource::configure(const QJsonObject &settings)
+{
+    if (settings.contains("centre_frequency"))
+    {
+        auto centreFrequency = settings["centre_frequency"].toDouble(-1);
+        if (centreFrequency < 0)
+        {
+            qDebug() << "Invalid centre frequency: " << settings["centre_frequency"];
+            return false;
+        }
+        setCentreFrequency(centreFrequency);
+    }
+    return true;
+}
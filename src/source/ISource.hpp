@@ -9,7 +9,10 @@
 #pragma once
 
 #include "ISourceListener.hpp"
+#include "source_statistics.hpp"
+#include "thread_scheduling.hpp"
 
+#include <QJsonObject>
 #include <QWidget>
 
 #include <vector>
@@ -24,16 +27,36 @@ class ISource
 
     virtual void start() = 0;
     virtual void stop() = 0;
+    // True once a source that can run out, like a recording, has nothing left to deliver.
+    // It is still running until whoever started it calls `stop()`.
+    virtual bool isFinished()
+    {
+        return false;
+    };
 
     virtual double getCentreFrequency() = 0;
     virtual void setCentreFrequency(double centreFrequency) = 0;
     virtual double getSampleRate() = 0;
 
+    virtual SourceStatistics getStatistics() = 0;
+
+    // Created on first use, so a headless process never constructs any widget
     virtual QWidget *getWidget() = 0;
 
+    // Applies settings without going through the widget, e.g. from a config file. Keys
+    // a source doesn't know are ignored. Returns false if a value was rejected.
+    virtual bool configure(const QJsonObject &settings);
+
     void setListeners(std::vector<ISourceListener *> listeners);
 
+    // For the source's acquisition and dispatch threads, applied on `start()`
+    void setSchedulingProfile(const SchedulingProfile &profile);
+    // Pins both to the same CPUs, leaving the rest of the profile as it is
+    void setCpuAffinity(const std::vector<int> &cpus);
+
   protected:
     // NOLINTNEXTLINE: protected members aren't that evil
     std::vector<ISourceListener *> listeners_;
+    // NOLINTNEXTLINE: protected members aren't that evil
+    SchedulingProfile scheduling_;
 };
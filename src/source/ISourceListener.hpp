@@ -8,8 +8,7 @@
 
 #pragma once
 
-#include <complex>
-#include <vector>
+#include "sample_block.hpp"
 
 class ISourceListener
 {
@@ -21,5 +20,6 @@ class ISourceListener
 
     virtual void setSampleRate(double sampleRate) = 0;
     virtual void setCentreFrequency(double centreFrequency) = 0;
-    virtual void receiveSamples(std::vector<std::complex<float>> &samples) = 0;
+    // The block may be kept beyond the call; it is recycled when the last reference goes.
+    virtual void receiveSamples(const SampleBlockPtr &block) = 0;
 };
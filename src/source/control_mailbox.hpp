@@ -0,0 +1,114 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Bounded multi-producer, single-consumer queue of control changes for a stream thread.
+// Any thread may post (the GUI, or a listener retuning its own source); only the stream
+// thread takes, between two reads. Neither side ever takes a lock or allocates: every
+// cell carries a sequence number that says whose turn it is.
+template <typename T> class ControlMailbox
+{
+  public:
+    explicit ControlMailbox(size_t capacity)
+        : cells_(roundUpToPowerOfTwo(capacity)), mask_(cells_.size() - 1)
+    {
+        for (size_t i = 0; i < cells_.size(); i++)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~ControlMailbox() = default;
+    ControlMailbox(const ControlMailbox &) = delete;
+    ControlMailbox &operator=(const ControlMailbox &) = delete;
+
+    // Any thread. Returns false if the mailbox is full.
+    bool post(T value)
+    {
+        auto pos = enqueuePos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto &cell = cells_[pos & mask_];
+            auto sequence = cell.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                // The cell is free: claim it, unless another producer just did
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1,
+                                                      std::memory_order_relaxed))
+                {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // The consumer hasn't taken this cell's last value yet
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer only. Returns false if the mailbox is empty.
+    bool take(T &value)
+    {
+        auto &cell = cells_[dequeuePos_ & mask_];
+        auto sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence != dequeuePos_ + 1)
+        {
+            return false;
+        }
+
+        value = std::move(cell.value);
+        cell.sequence.store(dequeuePos_ + cells_.size(), std::memory_order_release);
+        dequeuePos_++;
+        return true;
+    }
+
+    [[nodiscard]] size_t capacity() const
+    {
+        return cells_.size();
+    }
+
+  private:
+    static constexpr size_t cacheLine_ = 64;
+
+    static size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t rounded = 1;
+        while (rounded < std::max<size_t>(value, 1))
+        {
+            rounded <<= 1U;
+        }
+        return rounded;
+    }
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::vector<Cell> cells_;
+    const size_t mask_;
+
+    // Producers and the consumer work on separate cache lines
+    alignas(cacheLine_) std::atomic<size_t> enqueuePos_{0};
+    alignas(cacheLine_) size_t dequeuePos_{0};
+};
@@ -0,0 +1,92 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "latency_recorder.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+LatencyRecorder::LatencyRecorder(size_t capacity)
+    // NOLINTNEXTLINE(modernize-avoid-c-arrays)
+    : latencies_(std::make_unique<long long[]>(capacity)), capacity_(capacity), count_(0),
+      missed_(0), keepFrom_(0)
+{
+}
+
+void LatencyRecorder::record(long long latencyNs)
+{
+    auto count = count_.load(std::memory_order_relaxed);
+    if (count == capacity_)
+    {
+        missed_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    latencies_[count] = latencyNs;
+    // Publishes the latency to `summarize`
+    count_.store(count + 1, std::memory_order_release);
+}
+
+void LatencyRecorder::recordSince(long long readNs)
+{
+    if (readNs < keepFrom_.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    record(now() - readNs);
+}
+
+void LatencyRecorder::reset()
+{
+    count_ = 0;
+    missed_ = 0;
+}
+
+LatencySummary LatencyRecorder::summarize() const
+{
+    LatencySummary summary;
+    summary.count = count_.load(std::memory_order_acquire);
+    summary.missed = missed_.load(std::memory_order_relaxed);
+    if (summary.count == 0)
+    {
+        return summary;
+    }
+
+    std::vector<long long> sorted(latencies_.get(), latencies_.get() + summary.count);
+    std::sort(sorted.begin(), sorted.end());
+
+    constexpr double usPerNs = 1e-3;
+    auto toUs = [&](long long ns) { return static_cast<double>(ns) * usPerNs; };
+    // Nearest rank
+    auto count = static_cast<double>(summary.count);
+    auto percentile = [&](double p) {
+        auto rank = static_cast<size_t>(std::ceil(p * count));
+        return toUs(sorted[std::max<size_t>(rank, 1) - 1]);
+    };
+    auto sum = std::accumulate(sorted.begin(), sorted.end(), 0.0L);
+
+    summary.min = toUs(sorted.front());
+    summary.mean = static_cast<double>(sum / sorted.size()) * usPerNs;
+    // NOLINTBEGIN(readability-magic-numbers)
+    summary.p50 = percentile(0.5);
+    summary.p90 = percentile(0.9);
+    summary.p99 = percentile(0.99);
+    summary.p999 = percentile(0.999);
+    // NOLINTEND(readability-magic-numbers)
+    summary.max = toUs(sorted.back());
+    return summary;
+}
+
+long long LatencyRecorder::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#define LATENCY_RECORDER_CAPACITY (1024 * 1024) // Latencies kept, 8 MiB
+
+// Percentiles of the recorded latencies, in us
+struct LatencySummary
+{
+    size_t count{0};
+    size_t missed{0}; // Past the capacity, not in the percentiles
+    double min{0};
+    double mean{0};
+    double p50{0};
+    double p90{0};
+    double p99{0};
+    double p999{0};
+    double max{0};
+};
+
+// Keeps every latency measured at one point of the pipeline, from when the samples were
+// read (`SampleBlock::readNs`) to then. Only one thread may record; any thread may
+// summarize, even while recording. Recording never allocates or blocks: once the
+// capacity is used up, further latencies are only counted.
+class LatencyRecorder
+{
+  public:
+    explicit LatencyRecorder(size_t capacity = LATENCY_RECORDER_CAPACITY);
+    ~LatencyRecorder() = default;
+    LatencyRecorder(const LatencyRecorder &) = delete;
+    LatencyRecorder &operator=(const LatencyRecorder &) = delete;
+
+    void record(long long latencyNs);
+    // From `readNs` to now, on the host's steady clock
+    void recordSince(long long readNs);
+    // Skips samples read before `readNs` in `recordSince`, e.g. while warming up
+    void keepFrom(long long readNs)
+    {
+        keepFrom_.store(readNs, std::memory_order_relaxed);
+    };
+    // Not while recording
+    void reset();
+
+    [[nodiscard]] LatencySummary summarize() const;
+
+    static long long now();
+
+  private:
+    std::unique_ptr<long long[]> latencies_; // NOLINT(modernize-avoid-c-arrays)
+    size_t capacity_;
+    std::atomic<size_t> count_;
+    std::atomic<size_t> missed_;
+    std::atomic<long long> keepFrom_;
+};
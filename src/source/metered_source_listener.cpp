@@ -0,0 +1,40 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "metered_source_listener.hpp"
+
+#include <utility>
+
+MeteredSourceListener::MeteredSourceListener(std::shared_ptr<ISourceListener> listener,
+                                             const std::string &name)
+    : listener_(std::move(listener))
+{
+    MetricLabels labels{{"listener", name}};
+    auto &registry = MetricsRegistry::shared();
+    processing_ = registry.histogram("aether_listener_processing_seconds",
+                                     "Time the listener takes per block.", labels);
+    samples_ = registry.counter("aether_listener_samples_total",
+                                "Samples handed to the listener.", labels);
+}
+
+void MeteredSourceListener::setSampleRate(double sampleRate)
+{
+    listener_->setSampleRate(sampleRate);
+}
+
+void MeteredSourceListener::setCentreFrequency(double centreFrequency)
+{
+    listener_->setCentreFrequency(centreFrequency);
+}
+
+void MeteredSourceListener::receiveSamples(const SampleBlockPtr &block)
+{
+    MetricTimer timer(processing_.get());
+    listener_->receiveSamples(block);
+    samples_->add(block->size());
+}
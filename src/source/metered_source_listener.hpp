@@ -0,0 +1,38 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "ISourceListener.hpp"
+#include "metrics_registry.hpp"
+#include "sample_block.hpp"
+
+#include <memory>
+#include <string>
+
+// Times every `receiveSamples` of the listener it wraps, on whichever thread calls it,
+// and counts the samples it's handed.
+class MeteredSourceListener : public ISourceListener
+{
+  public:
+    MeteredSourceListener(std::shared_ptr<ISourceListener> listener,
+                          const std::string &name);
+    MeteredSourceListener() = delete;
+    ~MeteredSourceListener() override = default;
+    MeteredSourceListener(const MeteredSourceListener &) = delete;
+    MeteredSourceListener &operator=(MeteredSourceListener const &) = delete;
+
+    void setSampleRate(double sampleRate) override;
+    void setCentreFrequency(double centreFrequency) override;
+    void receiveSamples(const SampleBlockPtr &block) override;
+
+  private:
+    std::shared_ptr<ISourceListener> listener_;
+    std::shared_ptr<MetricHistogram> processing_;
+    std::shared_ptr<MetricCounter> samples_;
+};
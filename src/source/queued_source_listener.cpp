@@ -0,0 +1,227 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "queued_source_listener.hpp"
+
+#include "trace_recorder.hpp"
+
+#include <algorithm>
+#include <utility>
+
+QueuedSourceListener::QueuedSourceListener(std::shared_ptr<ISourceListener> listener,
+                                           const SubscriptionOptions &options)
+    : listener_(std::move(listener)), options_(options),
+      queue_(std::max<size_t>(options.queueDepth, 1)), head_(0), count_(0),
+      decimationCounter_(0), stopping_(false), dropped_(0), highWaterMark_(0),
+      worker_(nullptr)
+{
+    if (!options_.name.empty())
+    {
+        MetricLabels labels{{"listener", options_.name}};
+        auto &registry = MetricsRegistry::shared();
+        depthMetric_ = registry.gauge("aether_listener_queue_depth",
+                                      "Blocks waiting for the listener's thread.",
+                                      labels);
+        droppedMetric_ = registry.counter("aether_listener_dropped_blocks_total",
+                                          "Blocks the listener's queue had no room for.",
+                                          labels);
+    }
+
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    worker_ = new std::thread(&QueuedSourceListener::worker, this);
+}
+
+QueuedSourceListener::~QueuedSourceListener()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    notEmpty_.notify_all();
+    notFull_.notify_all();
+
+    worker_->join();
+    delete worker_;
+}
+
+void QueuedSourceListener::setSampleRate(double sampleRate)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pendingSampleRate_ = sampleRate;
+    }
+    notEmpty_.notify_one();
+}
+
+void QueuedSourceListener::setCentreFrequency(double centreFrequency)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pendingCentreFrequency_ = centreFrequency;
+    }
+    notEmpty_.notify_one();
+}
+
+void QueuedSourceListener::receiveSamples(const SampleBlockPtr &block)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (options_.policy == BackpressurePolicy::Decimate && count_ * 2 >= queue_.size())
+    {
+        if (decimationCounter_++ % std::max<size_t>(options_.decimation, 1) != 0)
+        {
+            markDropped();
+            return;
+        }
+    }
+    else
+    {
+        decimationCounter_ = 0;
+    }
+
+    if (count_ == queue_.size())
+    {
+        switch (options_.policy)
+        {
+        case BackpressurePolicy::Block: {
+            TraceScope trace("waitForRoom", "queue");
+            notFull_.wait(lock, [&]() { return count_ < queue_.size() || stopping_; });
+            if (stopping_)
+            {
+                return;
+            }
+            break;
+        }
+        case BackpressurePolicy::DropOldest:
+            dropOldest();
+            markDropped();
+            break;
+        case BackpressurePolicy::DropNewest:
+        case BackpressurePolicy::Decimate:
+            markDropped();
+            return;
+        }
+    }
+
+    push(block);
+    traceInstant("enqueue", "queue", "depth", static_cast<int64_t>(count_));
+    lock.unlock();
+    notEmpty_.notify_one();
+}
+
+void QueuedSourceListener::markDropped()
+{
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    if (droppedMetric_ != nullptr)
+    {
+        droppedMetric_->add();
+    }
+}
+
+void QueuedSourceListener::push(const SampleBlockPtr &block)
+{
+    auto &entry = queue_[(head_ + count_) % queue_.size()];
+    entry.block = block;
+    entry.sampleRate = std::exchange(pendingSampleRate_, std::nullopt);
+    entry.centreFrequency = std::exchange(pendingCentreFrequency_, std::nullopt);
+    count_++;
+    if (depthMetric_ != nullptr)
+    {
+        depthMetric_->set(static_cast<double>(count_));
+    }
+
+    if (count_ > highWaterMark_.load(std::memory_order_relaxed))
+    {
+        highWaterMark_.store(count_, std::memory_order_relaxed);
+    }
+}
+
+void QueuedSourceListener::pop()
+{
+    queue_[head_] = Entry();
+    head_ = (head_ + 1) % queue_.size();
+    count_--;
+    if (depthMetric_ != nullptr)
+    {
+        depthMetric_->set(static_cast<double>(count_));
+    }
+}
+
+void QueuedSourceListener::dropOldest()
+{
+    auto &oldest = queue_[head_];
+    auto &sampleRate =
+        count_ > 1 ? queue_[(head_ + 1) % queue_.size()].sampleRate : pendingSampleRate_;
+    auto &centreFrequency = count_ > 1
+                                ? queue_[(head_ + 1) % queue_.size()].centreFrequency
+                                : pendingCentreFrequency_;
+    // Whatever was changed after these is newer
+    if (!sampleRate)
+    {
+        sampleRate = oldest.sampleRate;
+    }
+    if (!centreFrequency)
+    {
+        centreFrequency = oldest.centreFrequency;
+    }
+    pop();
+}
+
+void QueuedSourceListener::worker()
+{
+    applyThreadProfile(options_.thread);
+    TraceRecorder::nameThread(options_.name.empty() ? "listener" : options_.name);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        notEmpty_.wait(lock, [&]() {
+            return count_ > 0 || pendingSampleRate_ || pendingCentreFrequency_ ||
+                   stopping_;
+        });
+        if (stopping_)
+        {
+            break;
+        }
+
+        // Changes made since the newest block wait for it to be delivered
+        Entry entry;
+        if (count_ > 0)
+        {
+            entry = std::move(queue_[head_]);
+            pop();
+            traceInstant("dequeue", "queue", "depth", static_cast<int64_t>(count_));
+        }
+        else
+        {
+            entry.sampleRate = std::exchange(pendingSampleRate_, std::nullopt);
+            entry.centreFrequency = std::exchange(pendingCentreFrequency_, std::nullopt);
+        }
+
+        // Never call into the listener while holding the lock
+        lock.unlock();
+        notFull_.notify_one();
+
+        if (entry.sampleRate)
+        {
+            listener_->setSampleRate(*entry.sampleRate);
+        }
+        if (entry.centreFrequency)
+        {
+            listener_->setCentreFrequency(*entry.centreFrequency);
+        }
+        if (entry.block)
+        {
+            TraceScope trace("receiveSamples", "listener");
+            listener_->receiveSamples(entry.block);
+        }
+        entry.block.reset();
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "ISourceListener.hpp"
+#include "metrics_registry.hpp"
+#include "sample_block.hpp"
+#include "thread_scheduling.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// What to do with a new block when a listener's queue is full.
+enum class BackpressurePolicy
+{
+    Block,      // Wait for room. The source slows down to the listener's pace.
+    DropOldest, // Discard the oldest queued block. Good for displays.
+    DropNewest, // Discard the incoming block.
+    Decimate    // Past half full only every Nth block is queued; drop newest when full.
+};
+
+struct SubscriptionOptions
+{
+    bool dedicatedThread{false}; // Otherwise the listener runs on the source's thread
+    BackpressurePolicy policy{BackpressurePolicy::DropOldest};
+    size_t queueDepth{16};
+    size_t decimation{4};
+    ThreadProfile thread; // Of the dedicated thread
+    std::string name;     // Labels the listener's metrics, none are kept if empty
+};
+
+// Runs a listener on its own thread, fed through a bounded queue of sample blocks.
+// Only references to the blocks are queued, never the samples themselves.
+class QueuedSourceListener : public ISourceListener
+{
+  public:
+    QueuedSourceListener(std::shared_ptr<ISourceListener> listener,
+                         const SubscriptionOptions &options);
+    QueuedSourceListener() = delete;
+    ~QueuedSourceListener() override;
+    QueuedSourceListener(const QueuedSourceListener &) = delete;
+    QueuedSourceListener &operator=(QueuedSourceListener const &) = delete;
+
+    void setSampleRate(double sampleRate) override;
+    void setCentreFrequency(double centreFrequency) override;
+    void receiveSamples(const SampleBlockPtr &block) override;
+
+    [[nodiscard]] size_t getDroppedBlocks() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    };
+    [[nodiscard]] size_t getQueueHighWaterMark() const
+    {
+        return highWaterMark_.load(std::memory_order_relaxed);
+    };
+
+  private:
+    std::shared_ptr<ISourceListener> listener_;
+    SubscriptionOptions options_;
+
+    // A block, and the control changes made since the block before it, which the
+    // listener hears of right before the block
+    struct Entry
+    {
+        SampleBlockPtr block;
+        std::optional<double> sampleRate;
+        std::optional<double> centreFrequency;
+    };
+
+    // Fixed-size circular queue, so queueing never allocates
+    std::vector<Entry> queue_;
+    size_t head_;
+    size_t count_;
+    size_t decimationCounter_;
+    void push(const SampleBlockPtr &block);
+    void pop();
+    void dropOldest(); // Its control changes move on to the next block
+
+    // Control changes since the newest queued block, latest value wins. They go into the
+    // queue with the next block, or straight to the listener once the queue is empty.
+    std::optional<double> pendingSampleRate_;
+    std::optional<double> pendingCentreFrequency_;
+
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    bool stopping_;
+
+    std::atomic<size_t> dropped_;
+    std::atomic<size_t> highWaterMark_;
+    std::shared_ptr<MetricGauge> depthMetric_;
+    std::shared_ptr<MetricCounter> droppedMetric_;
+    void markDropped();
+
+    std::thread *worker_;
+    void worker();
+};
@@ -0,0 +1,180 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "sample_block.hpp"
+
+#include <algorithm>
+#include <utility>
+
+static constexpr unsigned tagShift = 32U;
+static constexpr uint64_t indexMask = 0xFFFF'FFFFULL;
+
+SampleBlock::SampleBlock(size_t capacity, size_t channelCount, uint32_t index,
+                         bool ownStorage)
+    : samples_(ownStorage ? capacity * channelCount : 0), base_(samples_.data()),
+      capacity_(capacity), channelCount_(channelCount), size_(0), timeNs_(0), readNs_(0),
+      sampleIndex_(0), flags_(0), centreFrequency_(0), index_(index), references_(0)
+{
+}
+
+void SampleBlock::setSize(size_t size)
+{
+    size_ = std::min(size, capacity_);
+}
+
+void SampleBlock::dropFront(size_t count, double sampleRate)
+{
+    // Every channel sits `capacity_` after the previous one, so moving the base moves
+    // them all
+    count = std::min(count, size_);
+    base_ += count;
+    size_ -= count;
+    sampleIndex_ += count;
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    timeNs_ += static_cast<long long>(static_cast<double>(count) * 1e9 / sampleRate);
+}
+
+SampleBlockPtr::SampleBlockPtr(SampleBlock *block) : block_(block)
+{
+    if (block_ != nullptr)
+    {
+        block_->references_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+SampleBlockPtr::~SampleBlockPtr()
+{
+    reset();
+}
+
+SampleBlockPtr::SampleBlockPtr(const SampleBlockPtr &other) : SampleBlockPtr(other.block_)
+{
+}
+
+SampleBlockPtr &SampleBlockPtr::operator=(const SampleBlockPtr &other)
+{
+    if (this != &other)
+    {
+        SampleBlockPtr copy(other);
+        std::swap(block_, copy.block_);
+    }
+    return *this;
+}
+
+SampleBlockPtr::SampleBlockPtr(SampleBlockPtr &&other) noexcept
+    : block_(std::exchange(other.block_, nullptr))
+{
+}
+
+SampleBlockPtr &SampleBlockPtr::operator=(SampleBlockPtr &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        block_ = std::exchange(other.block_, nullptr);
+    }
+    return *this;
+}
+
+void SampleBlockPtr::reset()
+{
+    auto *block = std::exchange(block_, nullptr);
+    if (block != nullptr &&
+        block->references_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        block->owner_->release(block);
+    }
+}
+
+SampleBlockPool::SampleBlockPool(size_t blockCount, size_t blockCapacity,
+                                 size_t channelCount, std::shared_ptr<const void> backing)
+    : next_(blockCount), freeHead_(emptyList_), available_(0),
+      blockCapacity_(blockCapacity), channelCount_(channelCount),
+      backing_(std::move(backing))
+{
+    blocks_.reserve(blockCount);
+    for (auto i = 0U; i < blockCount; i++)
+    {
+        blocks_.push_back(std::make_unique<SampleBlock>(blockCapacity, channelCount, i,
+                                                        backing_ == nullptr));
+    }
+
+    // Chain every block into the free list
+    for (auto i = 0U; i < blockCount; i++)
+    {
+        next_[i].store(i + 1 < blockCount ? i + 1 : emptyList_,
+                       std::memory_order_relaxed);
+    }
+    freeHead_.store(blockCount > 0 ? 0 : emptyList_, std::memory_order_relaxed);
+    available_.store(blockCount, std::memory_order_relaxed);
+}
+
+std::shared_ptr<SampleBlockPool> SampleBlockPool::make(size_t blockCount,
+                                                       size_t blockCapacity,
+                                                       size_t channelCount)
+{
+    return std::make_shared<SampleBlockPool>(blockCount, blockCapacity, channelCount);
+}
+
+std::shared_ptr<SampleBlockPool> SampleBlockPool::makeViews(
+    size_t blockCount, size_t blockCapacity, std::shared_ptr<const void> backing)
+{
+    return std::make_shared<SampleBlockPool>(blockCount, blockCapacity, 1,
+                                             std::move(backing));
+}
+
+SampleBlockPtr SampleBlockPool::acquire()
+{
+    auto head = freeHead_.load(std::memory_order_acquire);
+    while (true)
+    {
+        auto index = static_cast<uint32_t>(head & indexMask);
+        if (index == emptyList_)
+        {
+            return SampleBlockPtr();
+        }
+
+        auto next = next_[index].load(std::memory_order_relaxed);
+        auto newHead = (((head >> tagShift) + 1) << tagShift) | next;
+        if (freeHead_.compare_exchange_weak(head, newHead, std::memory_order_acq_rel,
+                                            std::memory_order_acquire))
+        {
+            available_.fetch_sub(1, std::memory_order_relaxed);
+            auto *block = blocks_[index].get();
+            block->owner_ = shared_from_this();
+            return SampleBlockPtr(block);
+        }
+    }
+}
+
+void SampleBlockPool::release(SampleBlock *block)
+{
+    // Keeps the pool alive until the block is back in the list, even if this was the
+    // last reference to it.
+    auto owner = std::move(block->owner_);
+
+    block->size_ = 0;
+    block->base_ = block->samples_.data();
+    block->timeNs_ = 0;
+    block->readNs_ = 0;
+    block->sampleIndex_ = 0;
+    block->flags_ = 0;
+    block->centreFrequency_ = 0;
+
+    auto head = freeHead_.load(std::memory_order_relaxed);
+    uint64_t newHead = 0;
+    do
+    {
+        next_[block->index_].store(static_cast<uint32_t>(head & indexMask),
+                                   std::memory_order_relaxed);
+        newHead = (((head >> tagShift) + 1) << tagShift) | block->index_;
+    } while (!freeHead_.compare_exchange_weak(head, newHead, std::memory_order_release,
+                                              std::memory_order_relaxed));
+
+    available_.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,246 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class SampleBlockPool;
+
+// Stream flags carried by a block
+enum SampleBlockFlags : uint32_t
+{
+    SampleBlockHasTime = 1U << 0U,       // `timeNs` is a hardware timestamp
+    SampleBlockDiscontinuity = 1U << 1U, // Samples were lost right before this block
+    SampleBlockEndBurst = 1U << 2U,      // The device ended a burst with this block
+    SampleBlockRetuned = 1U << 3U        // First block at a new centre frequency
+};
+
+// A buffer of samples handed out by a `SampleBlockPool`. Only the first `size()` samples
+// are valid. Blocks are reference counted through `SampleBlockPtr`: a listener may keep
+// one, or forward it to another thread, without copying it. The block goes back to its
+// pool when the last reference is dropped.
+// Multi-channel blocks hold the same time span of every channel, one after the other;
+// single-channel listeners can just use channel 0.
+// A block may also be a view into memory it doesn't own (e.g. a mapped file), see
+// `SampleBlockPool`.
+class SampleBlock
+{
+  public:
+    SampleBlock() = delete;
+    SampleBlock(size_t capacity, size_t channelCount, uint32_t index, bool ownStorage);
+    ~SampleBlock() = default;
+    SampleBlock(const SampleBlock &) = delete;
+    SampleBlock &operator=(const SampleBlock &) = delete;
+
+    std::complex<float> *data(size_t channel = 0)
+    {
+        return base_ + channel * capacity_;
+    };
+    [[nodiscard]] const std::complex<float> *data(size_t channel = 0) const
+    {
+        return base_ + channel * capacity_;
+    };
+    // Points the block at `view` instead of its own storage, until it's recycled
+    void setView(std::complex<float> *view)
+    {
+        base_ = view;
+    };
+    // Valid samples per channel
+    [[nodiscard]] size_t size() const
+    {
+        return size_;
+    };
+    [[nodiscard]] size_t capacity() const
+    {
+        return capacity_;
+    };
+    [[nodiscard]] size_t channelCount() const
+    {
+        return channelCount_;
+    };
+    void setSize(size_t size);
+
+    // Time of the first sample, in ns. Hardware time if `SampleBlockHasTime` is set,
+    // otherwise the host's steady clock when the block was read.
+    [[nodiscard]] long long timeNs() const
+    {
+        return timeNs_;
+    };
+    // The host's steady clock when the source got these samples (e.g. `readStream`
+    // returned), whatever `timeNs` is. Latency through the pipeline is measured from it.
+    [[nodiscard]] long long readNs() const
+    {
+        return readNs_;
+    };
+    // Index of the first sample since the stream started, lost samples included
+    [[nodiscard]] uint64_t sampleIndex() const
+    {
+        return sampleIndex_;
+    };
+    [[nodiscard]] uint32_t flags() const
+    {
+        return flags_;
+    };
+    [[nodiscard]] bool hasFlag(SampleBlockFlags flag) const
+    {
+        return (flags_ & flag) != 0;
+    };
+    // What the source was tuned to when these samples were taken. `SampleBlockRetuned`
+    // marks the first block read after a retune; how exactly its first sample lines up
+    // with the retune depends on the source (see e.g. `SoapySdrRadio`).
+    [[nodiscard]] double centreFrequency() const
+    {
+        return centreFrequency_;
+    };
+    void setTimeNs(long long timeNs)
+    {
+        timeNs_ = timeNs;
+    };
+    void setReadNs(long long readNs)
+    {
+        readNs_ = readNs;
+    };
+    void setSampleIndex(uint64_t sampleIndex)
+    {
+        sampleIndex_ = sampleIndex;
+    };
+    void setFlags(uint32_t flags)
+    {
+        flags_ = flags;
+    };
+    void setCentreFrequency(double centreFrequency)
+    {
+        centreFrequency_ = centreFrequency;
+    };
+    // Drops the first `count` samples of every channel without moving any, for a block
+    // that's already filled. The index and time move on to the first sample kept.
+    void dropFront(size_t count, double sampleRate);
+
+    [[nodiscard]] const std::complex<float> *begin() const
+    {
+        return base_;
+    };
+    [[nodiscard]] const std::complex<float> *end() const
+    {
+        return base_ + size_;
+    };
+
+  private:
+    friend class SampleBlockPtr;
+    friend class SampleBlockPool;
+
+    std::vector<std::complex<float>> samples_;
+    std::complex<float> *base_;
+    size_t capacity_;
+    size_t channelCount_;
+    size_t size_;
+    long long timeNs_;
+    long long readNs_;
+    uint64_t sampleIndex_;
+    uint32_t flags_;
+    double centreFrequency_;
+
+    const uint32_t index_;
+    std::atomic<uint32_t> references_;
+    std::shared_ptr<SampleBlockPool> owner_; // Only set while the block is handed out
+};
+
+// Intrusive, thread-safe reference to a `SampleBlock`. Copying only touches an atomic
+// counter, so it is cheap enough for the streaming path.
+class SampleBlockPtr
+{
+  public:
+    SampleBlockPtr() = default;
+    explicit SampleBlockPtr(SampleBlock *block);
+    ~SampleBlockPtr();
+    SampleBlockPtr(const SampleBlockPtr &other);
+    SampleBlockPtr &operator=(const SampleBlockPtr &other);
+    SampleBlockPtr(SampleBlockPtr &&other) noexcept;
+    SampleBlockPtr &operator=(SampleBlockPtr &&other) noexcept;
+
+    void reset();
+
+    [[nodiscard]] SampleBlock *get() const
+    {
+        return block_;
+    };
+    SampleBlock *operator->() const
+    {
+        return block_;
+    };
+    SampleBlock &operator*() const
+    {
+        return *block_;
+    };
+    explicit operator bool() const
+    {
+        return block_ != nullptr;
+    };
+
+  private:
+    SampleBlock *block_{nullptr};
+};
+
+// Fixed set of preallocated sample blocks. `acquire` never allocates: it either pops a
+// free block or returns an empty pointer. The pool stays alive until the last block it
+// handed out has been returned, so it may be replaced while listeners still hold blocks.
+// A pool made with a `backing` object has no storage of its own: its blocks are views
+// into the backing (see `SampleBlock::setView`), which is kept alive as long as the pool.
+class SampleBlockPool : public std::enable_shared_from_this<SampleBlockPool>
+{
+  public:
+    SampleBlockPool(size_t blockCount, size_t blockCapacity, size_t channelCount = 1,
+                    std::shared_ptr<const void> backing = nullptr);
+    ~SampleBlockPool() = default;
+    SampleBlockPool(const SampleBlockPool &) = delete;
+    SampleBlockPool &operator=(const SampleBlockPool &) = delete;
+
+    static std::shared_ptr<SampleBlockPool> make(size_t blockCount, size_t blockCapacity,
+                                                 size_t channelCount = 1);
+    static std::shared_ptr<SampleBlockPool> makeViews(
+        size_t blockCount, size_t blockCapacity, std::shared_ptr<const void> backing);
+
+    SampleBlockPtr acquire();
+
+    [[nodiscard]] size_t blockCount() const
+    {
+        return blocks_.size();
+    };
+    [[nodiscard]] size_t blockCapacity() const
+    {
+        return blockCapacity_;
+    };
+    [[nodiscard]] size_t channelCount() const
+    {
+        return channelCount_;
+    };
+    [[nodiscard]] size_t available() const
+    {
+        return available_.load(std::memory_order_relaxed);
+    };
+
+  private:
+    friend class SampleBlockPtr;
+    void release(SampleBlock *block);
+
+    // Lock-free free list: the head holds a block index in the low half and an ABA tag in
+    // the high half.
+    static constexpr uint32_t emptyList_ = ~0U;
+    std::vector<std::unique_ptr<SampleBlock>> blocks_;
+    std::vector<std::atomic<uint32_t>> next_;
+    std::atomic<uint64_t> freeHead_;
+    std::atomic<size_t> available_;
+    size_t blockCapacity_;
+    size_t channelCount_;
+    std::shared_ptr<const void> backing_;
+};
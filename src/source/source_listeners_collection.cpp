@@ -8,8 +8,24 @@
 
 #include "source_listeners_collection.hpp"
 
-void SourceListenersCollection::subscribe(std::shared_ptr<ISourceListener> listener)
+#include "metered_source_listener.hpp"
+
+void SourceListenersCollection::subscribe(std::shared_ptr<ISourceListener> listener,
+                                          const SubscriptionOptions &options)
 {
+    // Timed where it runs, so a queued listener's time excludes its wait in the queue
+    if (!options.name.empty())
+    {
+        listener = std::make_shared<MeteredSourceListener>(std::move(listener),
+                                                           options.name);
+    }
+
+    if (options.dedicatedThread)
+    {
+        listeners_.push_back(
+            std::make_shared<QueuedSourceListener>(std::move(listener), options));
+        return;
+    }
     listeners_.push_back(std::move(listener));
 };
 
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "ISourceListener.hpp"
+#include "queued_source_listener.hpp"
 
 #include <memory>
 #include <vector>
@@ -23,7 +24,11 @@ class SourceListenersCollection
     SourceListenersCollection(SourceListenersCollection &&) = default;
     SourceListenersCollection &operator=(SourceListenersCollection &&) = default;
 
-    void subscribe(std::shared_ptr<ISourceListener> listener);
+    // With `options.dedicatedThread` the listener gets its own queue and thread, so it
+    // can't slow down the source or the other listeners. With `options.name` its
+    // processing time, and its queue if any, are kept as metrics.
+    void subscribe(std::shared_ptr<ISourceListener> listener,
+                   const SubscriptionOptions &options = SubscriptionOptions());
     std::vector<ISourceListener *> getSubscribers();
 
   private:
@@ -8,12 +8,24 @@
 
 #include "source_manager.hpp"
 
+#include "metrics_registry.hpp"
+
+#include <QDebug>
+#include <QString>
+
 SourceManager::SourceManager(SourceFactory &&sourceFactory,
                              SourceListenersCollection &&listenersCollection)
     : currentSource_(std::unique_ptr<ISource>(nullptr)),
       sourceFactory_(std::move(sourceFactory)),
-      listenersCollection_(std::move(listenersCollection)),
-      widget_(std::make_unique<SourceManagerWidget>(this)){};
+      listenersCollection_(std::move(listenersCollection)), widget_(nullptr){};
+
+SourceManager::~SourceManager()
+{
+    for (const auto &elem : activeSources_)
+    {
+        MetricsRegistry::shared().removeCollector(elem.second.metricsCollector);
+    }
+}
 
 ISource *SourceManager::getSource()
 {
@@ -32,6 +44,11 @@ void SourceManager::setSource(const std::string &sourceName)
 
 QWidget *SourceManager::getWidget()
 {
+    // The widget picks the first source as it's created
+    if (widget_ == nullptr)
+    {
+        widget_ = std::make_unique<SourceManagerWidget>(this);
+    }
     return static_cast<QWidget *>(widget_.get());
 }
 
@@ -40,7 +57,129 @@ SourceFactory *SourceManager::getSourceFactory()
     return &sourceFactory_;
 }
 
+ISource *SourceManager::addSource(const std::string &id, const std::string &sourceName,
+                                  SourceListenersCollection &&listenersCollection,
+                                  const std::vector<int> &cpus)
+{
+    if (activeSources_.count(id) != 0)
+    {
+        qDebug() << "There's already a source with id " << QString::fromStdString(id);
+        return nullptr;
+    }
+
+    auto source = sourceFactory_.createSource(sourceName);
+    if (source == nullptr)
+    {
+        qDebug() << "Unknown source " << QString::fromStdString(sourceName);
+        return nullptr;
+    }
+
+    source->setListeners(listenersCollection.getSubscribers());
+    source->setCpuAffinity(cpus);
+
+    auto &active = activeSources_[id];
+    active.source = std::move(source);
+    active.listenersCollection = std::move(listenersCollection);
+    active.metricsCollector = collectMetrics(id, active.source.get());
+    return active.source.get();
+}
+
+void SourceManager::removeSource(const std::string &id)
+{
+    // Destroying the source stops it before its listeners go away
+    auto pos = activeSources_.find(id);
+    if (pos != activeSources_.end())
+    {
+        MetricsRegistry::shared().removeCollector(pos->second.metricsCollector);
+        pos->second.source.reset();
+        activeSources_.erase(pos);
+    }
+}
+
+ISource *SourceManager::getSource(const std::string &id)
+{
+    auto pos = activeSources_.find(id);
+    if (pos == activeSources_.end())
+    {
+        return nullptr;
+    }
+    return pos->second.source.get();
+}
+
+std::vector<std::string> SourceManager::getSourceIds()
+{
+    std::vector<std::string> ids;
+    for (const auto &elem : activeSources_)
+    {
+        ids.push_back(elem.first);
+    }
+    return ids;
+}
+
+void SourceManager::startAll()
+{
+    for (const auto &elem : activeSources_)
+    {
+        elem.second.source->start();
+    }
+}
+
+void SourceManager::stopAll()
+{
+    for (const auto &elem : activeSources_)
+    {
+        elem.second.source->stop();
+    }
+}
+
 std::vector<ISourceListener *> SourceManager::getSourceListeners()
 {
     return listenersCollection_.getSubscribers();
 }
+
+// The sources already keep their statistics, so they're only read when scraped
+size_t SourceManager::collectMetrics(const std::string &id, ISource *source)
+{
+    auto &registry = MetricsRegistry::shared();
+    MetricLabels labels{{"source", id}};
+    auto samples = registry.counter("aether_source_samples_total",
+                                    "Samples received from the device.", labels);
+    auto rate = registry.gauge("aether_source_measured_sample_rate",
+                               "Sample rate measured from the timestamps.", labels);
+    auto overflows = registry.counter("aether_source_overflows_total",
+                                      "Overflows reported by the device.", labels);
+    auto timeouts = registry.counter("aether_source_timeouts_total",
+                                     "Reads that returned no samples in time.", labels);
+    auto errors = registry.counter("aether_source_stream_errors_total",
+                                   "Reads that failed otherwise.", labels);
+    auto dropped = registry.counter("aether_source_dropped_blocks_total",
+                                    "Blocks read but never dispatched.", labels);
+    auto ringHighWater = registry.gauge("aether_source_ring_high_water_mark",
+                                        "Most blocks ever waiting for dispatch.", labels);
+    auto gaps = registry.counter("aether_source_gaps_total",
+                                 "Discontinuities in the sample stream.", labels);
+    auto lost = registry.counter("aether_source_lost_samples_total",
+                                 "Samples estimated lost in the gaps.", labels);
+    auto retunes = registry.counter("aether_source_retunes_total",
+                                    "Retunes applied while streaming.", labels);
+    auto recoveries = registry.counter("aether_source_recoveries_total",
+                                       "Stream recoveries completed.", labels);
+    auto recovering = registry.gauge("aether_source_recovering",
+                                     "1 while the stream is being recovered.", labels);
+
+    return registry.addCollector([=]() {
+        auto stats = source->getStatistics();
+        samples->set(stats.samplesReceived);
+        rate->set(stats.measuredSampleRate);
+        overflows->set(stats.overflows);
+        timeouts->set(stats.timeouts);
+        errors->set(stats.streamErrors);
+        dropped->set(stats.droppedBlocks);
+        ringHighWater->set(static_cast<double>(stats.ringHighWaterMark));
+        gaps->set(stats.gaps);
+        lost->set(stats.lostSamples);
+        retunes->set(stats.retunes);
+        recoveries->set(stats.recoveries);
+        recovering->set(stats.recovering ? 1 : 0);
+    });
+}
@@ -16,7 +16,9 @@
 
 #include <QWidget>
 
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 class SourceManager
@@ -27,18 +29,44 @@ class SourceManager
     SourceManager() = delete;
     SourceManager(const SourceManager &) = delete;
     SourceManager &operator=(const SourceManager &) = delete;
-    ~SourceManager() = default;
+    ~SourceManager();
 
+    // The source driven by the widget
     ISource *getSource();
     void setSource(const std::string &sourceName);
+    // Only created when asked for: headless, the manager has no widget at all
     QWidget *getWidget();
     SourceFactory *getSourceFactory();
 
+    // Further sources, running side by side with the one above. Each has its own
+    // listeners (which must not be shared with another source), its own threads and
+    // optionally its own CPUs. Its statistics are exported as metrics labelled with
+    // `id`. Returns nullptr if `sourceName` isn't registered or `id`
+    // is taken.
+    ISource *addSource(const std::string &id, const std::string &sourceName,
+                       SourceListenersCollection &&listenersCollection,
+                       const std::vector<int> &cpus = std::vector<int>());
+    void removeSource(const std::string &id);
+    ISource *getSource(const std::string &id);
+    std::vector<std::string> getSourceIds();
+    void startAll();
+    void stopAll();
+
   private:
     std::unique_ptr<ISource> currentSource_;
     SourceFactory sourceFactory_;
     SourceListenersCollection listenersCollection_;
     std::unique_ptr<SourceManagerWidget> widget_;
 
+    // The source is declared last so it's destroyed (and stopped) before its listeners
+    struct ActiveSource
+    {
+        SourceListenersCollection listenersCollection;
+        std::unique_ptr<ISource> source;
+        size_t metricsCollector;
+    };
+    std::map<std::string, ActiveSource> activeSources_;
+
     std::vector<ISourceListener *> getSourceListeners();
+    static size_t collectMetrics(const std::string &id, ISource *source);
 };
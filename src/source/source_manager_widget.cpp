@@ -17,7 +17,8 @@
 SourceManagerWidget::SourceManagerWidget(SourceManager *manager)
     : QWidget(nullptr), manager_(manager), sourcesAvailableComboBox_(new QComboBox(this)),
       centreFrequencySpinBox_(new QDoubleSpinBox(this)),
-      startStopPushButton_(new QPushButton(this)), layout_(new QVBoxLayout(this))
+      startStopPushButton_(new QPushButton(this)), layout_(new QVBoxLayout(this)),
+      finishedTimer_(new QTimer(this))
 {
     startStopPushButton_->setCheckable(true);
     startStopPushButton_->setText("Start");
@@ -54,6 +55,14 @@ SourceManagerWidget::SourceManagerWidget(SourceManager *manager)
 
     connect(startStopPushButton_, &QPushButton::toggled, this,
             &SourceManagerWidget::startStopPushButtonToggled);
+    finishedTimer_->setInterval(SOURCE_FINISHED_POLL);
+    connect(finishedTimer_, &QTimer::timeout, [&]() {
+        auto *source = manager_->getSource();
+        if (source != nullptr && source->isFinished())
+        {
+            startStopPushButton_->setChecked(false);
+        }
+    });
     connect(sourcesAvailableComboBox_, &QComboBox::currentTextChanged, this,
             &SourceManagerWidget::sourcesAvailableComboBoxTextChanged);
     connect(centreFrequencySpinBox_, &QDoubleSpinBox::valueChanged, this,
@@ -73,12 +82,14 @@ void SourceManagerWidget::startStopPushButtonToggled(bool checked)
         if (checked && (source != nullptr))
         {
             source->start();
+            finishedTimer_->start();
             centreFrequencySpinBox_->blockSignals(true);
             centreFrequencySpinBox_->setValue(source->getCentreFrequency());
             centreFrequencySpinBox_->blockSignals(false);
         }
         else if (!checked && (source != nullptr))
         {
+            finishedTimer_->stop();
             source->stop();
         }
     }
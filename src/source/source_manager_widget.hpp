@@ -12,9 +12,12 @@
 #include <QDoubleSpinBox>
 #include <QPushButton>
 #include <QString>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
 
+#define SOURCE_FINISHED_POLL 250 // ms
+
 class SourceManager;
 
 class SourceManagerWidget : public QWidget
@@ -32,6 +35,7 @@ class SourceManagerWidget : public QWidget
     QDoubleSpinBox *centreFrequencySpinBox_;
     QPushButton *startStopPushButton_;
     QVBoxLayout *layout_;
+    QTimer *finishedTimer_; // While running, to stop a source that ran out
   private slots: // NOLINT(readability-redundant-access-specifiers)
     void sourcesAvailableComboBoxTextChanged(const QString &text);
     void centreFrequencySpinBoxValueChanged(double d);
@@ -0,0 +1,41 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "source_pacing.hpp"
+
+#include <thread>
+
+bool parseSourcePacing(const std::string &text, SourcePacing &pacing)
+{
+    if (text == "real_time")
+    {
+        pacing = SourcePacing::RealTime;
+        return true;
+    }
+    if (text == "as_fast_as_possible")
+    {
+        pacing = SourcePacing::AsFastAsPossible;
+        return true;
+    }
+    return false;
+}
+
+void PacingClock::reset(double sampleRate)
+{
+    start_ = std::chrono::steady_clock::now();
+    sampleRate_ = sampleRate;
+    samples_ = 0;
+}
+
+void PacingClock::pace(size_t samples)
+{
+    auto due = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(static_cast<double>(samples_) / sampleRate_));
+    std::this_thread::sleep_until(start_ + due);
+    samples_ += samples;
+}
@@ -0,0 +1,40 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// How a source that isn't a device (a file, a generator) delivers its samples
+enum class SourcePacing
+{
+    RealTime,        // At the stream's sample rate, like a device
+    AsFastAsPossible // The listeners set the pace (benchmarks, regression tests)
+};
+
+// "real_time" or "as_fast_as_possible", for config files. False if neither.
+bool parseSourcePacing(const std::string &text, SourcePacing &pacing);
+
+// Holds a stream to its sample rate: sample N is due N / sampleRate after `reset`
+class PacingClock
+{
+  public:
+    PacingClock() = default;
+
+    void reset(double sampleRate);
+    // Sleeps until the next `samples` are due, then counts them as delivered
+    void pace(size_t samples);
+
+  private:
+    std::chrono::steady_clock::time_point start_;
+    double sampleRate_{1};
+    uint64_t samples_{0};
+};
@@ -0,0 +1,35 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <cstddef>
+
+// Snapshot of the streaming counters of a source. Used to size buffers for a given rate.
+struct SourceStatistics
+{
+    size_t ringCapacity{0};      // Blocks between acquisition and dispatch
+    size_t ringHighWaterMark{0}; // Largest number of blocks ever waiting for dispatch
+    size_t droppedBlocks{0};     // Blocks read from the device but never dispatched
+
+    size_t samplesReceived{0};
+    size_t overflows{0};    // Reported by the device
+    size_t timeouts{0};     // Reads that returned no samples in time
+    size_t streamErrors{0}; // Any other read error
+    size_t gaps{0};         // Discontinuities in the sample stream
+    size_t lostSamples{0};  // Estimated from the timestamps around the gaps
+    size_t retunes{0};      // Applied while streaming
+
+    bool recovering{false};   // The stream stalled or broke and is being brought back
+    size_t recoveries{0};     // Completed, by samples flowing again
+    size_t reactivations{0};  // Attempts at restarting the stream
+    size_t reopens{0};        // Attempts at setting the stream up anew
+    double timeRecovering{0}; // s, over every completed recovery
+
+    double measuredSampleRate{0}; // From the timestamps, 0 until there's enough data
+};
@@ -0,0 +1,185 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Single-producer, single-consumer ring of preallocated slots.
+// The producer fills a slot in place (`writeSlot` + `commitWrite`) and the consumer reads
+// it in place (`readSlot` + `commitRead`), so nothing is copied or allocated while
+// streaming. Neither side ever takes a lock; the mutex is only there to park the consumer
+// while the ring is empty.
+template <typename T> class SpscRingBuffer
+{
+  public:
+    explicit SpscRingBuffer(size_t capacity)
+        : slots_(roundUpToPowerOfTwo(capacity)), mask_(slots_.size() - 1)
+    {
+    }
+    ~SpscRingBuffer() = default;
+    SpscRingBuffer(const SpscRingBuffer &) = delete;
+    SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+    // Producer side ---------------------------------------------------------------------
+
+    // Returns the next free slot, or nullptr if the ring is full.
+    T *writeSlot()
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (head - tailCache_ >= slots_.size())
+        {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head - tailCache_ >= slots_.size())
+            {
+                return nullptr;
+            }
+        }
+        return &slots_[head & mask_];
+    }
+
+    void commitWrite()
+    {
+        auto head = head_.load(std::memory_order_relaxed) + 1;
+        head_.store(head, std::memory_order_release);
+
+        auto occupancy = head - tail_.load(std::memory_order_relaxed);
+        if (occupancy > highWaterMark_.load(std::memory_order_relaxed))
+        {
+            highWaterMark_.store(occupancy, std::memory_order_relaxed);
+        }
+
+        // Pairs with the fence in `waitForData`, so a parked consumer is never missed.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumerWaiting_.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            condition_.notify_one();
+        }
+    }
+
+    // To be called by the producer when it had to throw a block away.
+    void markDropped()
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Consumer side ---------------------------------------------------------------------
+
+    // Returns the oldest committed slot, or nullptr if the ring is empty.
+    T *readSlot()
+    {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (headCache_ == tail)
+        {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (headCache_ == tail)
+            {
+                return nullptr;
+            }
+        }
+        return &slots_[tail & mask_];
+    }
+
+    void commitRead()
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Parks the consumer until there is data, `notify` is called or the timeout expires.
+    bool waitForData(std::chrono::microseconds timeout)
+    {
+        if (readSlot() != nullptr)
+        {
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        consumerWaiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        condition_.wait_for(lock, timeout, [&]() {
+            return head_.load(std::memory_order_acquire) !=
+                       tail_.load(std::memory_order_relaxed) ||
+                   woken_;
+        });
+        consumerWaiting_.store(false, std::memory_order_relaxed);
+        woken_ = false;
+
+        return readSlot() != nullptr;
+    }
+
+    // Wakes a parked consumer, e.g. to let it notice a shutdown.
+    void notify()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        woken_ = true;
+        condition_.notify_all();
+    }
+
+    // Statistics (any thread) -----------------------------------------------------------
+
+    [[nodiscard]] size_t capacity() const
+    {
+        return slots_.size();
+    }
+    [[nodiscard]] size_t size() const
+    {
+        return head_.load(std::memory_order_acquire) -
+               tail_.load(std::memory_order_acquire);
+    }
+    [[nodiscard]] size_t highWaterMark() const
+    {
+        return highWaterMark_.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] size_t dropped() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    // Slots are exposed for preallocation before streaming starts.
+    std::vector<T> &slots()
+    {
+        return slots_;
+    }
+
+  private:
+    static constexpr size_t cacheLine_ = 64;
+
+    static size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t rounded = 1;
+        while (rounded < std::max<size_t>(value, 1))
+        {
+            rounded <<= 1U;
+        }
+        return rounded;
+    }
+
+    std::vector<T> slots_;
+    const size_t mask_;
+
+    // Producer and consumer indices live on separate cache lines to avoid false sharing.
+    alignas(cacheLine_) std::atomic<size_t> head_{0};
+    size_t tailCache_{0};
+    alignas(cacheLine_) std::atomic<size_t> tail_{0};
+    size_t headCache_{0};
+
+    alignas(cacheLine_) std::atomic<size_t> highWaterMark_{0};
+    std::atomic<size_t> dropped_{0};
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::atomic<bool> consumerWaiting_{false};
+    bool woken_{false};
+};
@@ -0,0 +1,99 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "stream_recovery.hpp"
+
+#include <algorithm>
+
+StreamRecovery::StreamRecovery(const StreamRecoveryOptions &options) : options_(options)
+{
+}
+
+void StreamRecovery::reset()
+{
+    timeoutsInARow_ = 0;
+    errorsInARow_ = 0;
+    attempts_ = 0;
+    backoff_ = std::chrono::milliseconds(0);
+
+    recovering_ = false;
+    recoveries_ = 0;
+    reactivations_ = 0;
+    reopens_ = 0;
+    timeRecovering_ = 0;
+}
+
+void StreamRecovery::succeeded()
+{
+    timeoutsInARow_ = 0;
+    errorsInARow_ = 0;
+    if (!recovering_.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    auto took = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - recoveryStart_);
+    timeRecovering_.fetch_add(took.count(), std::memory_order_relaxed);
+    recoveries_.fetch_add(1, std::memory_order_relaxed);
+    recovering_.store(false, std::memory_order_relaxed);
+    attempts_ = 0;
+    backoff_ = std::chrono::milliseconds(0);
+}
+
+RecoveryAction StreamRecovery::failed(StreamFault fault)
+{
+    switch (fault)
+    {
+    case StreamFault::Overflow:
+        return RecoveryAction::None;
+    case StreamFault::Timeout:
+        errorsInARow_ = 0;
+        if (++timeoutsInARow_ < options_.timeoutLimit)
+        {
+            return RecoveryAction::None;
+        }
+        break;
+    case StreamFault::Error:
+        timeoutsInARow_ = 0;
+        if (++errorsInARow_ < options_.errorLimit)
+        {
+            return RecoveryAction::None;
+        }
+        break;
+    }
+
+    timeoutsInARow_ = 0;
+    errorsInARow_ = 0;
+    if (!recovering_.load(std::memory_order_relaxed))
+    {
+        recoveryStart_ = std::chrono::steady_clock::now();
+        recovering_.store(true, std::memory_order_relaxed);
+    }
+    return nextAttempt();
+}
+
+RecoveryAction StreamRecovery::retry()
+{
+    return nextAttempt();
+}
+
+RecoveryAction StreamRecovery::nextAttempt()
+{
+    backoff_ = attempts_ == 0 ? options_.initialBackoff
+                              : std::min(backoff_ * 2, options_.maxBackoff);
+    attempts_++;
+
+    if (attempts_ <= options_.reactivations)
+    {
+        reactivations_.fetch_add(1, std::memory_order_relaxed);
+        return RecoveryAction::Reactivate;
+    }
+    reopens_.fetch_add(1, std::memory_order_relaxed);
+    return RecoveryAction::Reopen;
+}
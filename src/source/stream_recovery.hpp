@@ -0,0 +1,103 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+enum class StreamFault
+{
+    Overflow, // The host didn't keep up; the stream itself is fine
+    Timeout,  // No samples in time
+    Error     // Anything else the driver reports
+};
+
+enum class RecoveryAction
+{
+    None,       // Just read again
+    Reactivate, // Deactivate and activate the stream
+    Reopen      // Close the stream and set it up again
+};
+
+struct StreamRecoveryOptions
+{
+    size_t timeoutLimit{5};  // In a row before the stream counts as stalled
+    size_t errorLimit{3};    // In a row before the stream counts as broken
+    size_t reactivations{3}; // Attempts at reactivating before reopening instead
+    std::chrono::milliseconds initialBackoff{50};
+    std::chrono::milliseconds maxBackoff{5000};
+};
+
+// Decides what to do about failed reads, so that a dead or unplugged device doesn't have
+// the acquisition thread spin on errors. Overflows are only counted. Timeouts and errors
+// in a row past their limit start a recovery: each attempt waits twice as long as the
+// previous one, up to the maximum, and reactivating escalates to reopening the stream
+// once it failed often enough. The first good read ends the recovery.
+// Meant for the acquisition thread only; the counters may be read from anywhere.
+class StreamRecovery
+{
+  public:
+    explicit StreamRecovery(const StreamRecoveryOptions &options = {});
+    ~StreamRecovery() = default;
+    StreamRecovery(const StreamRecovery &) = delete;
+    StreamRecovery &operator=(const StreamRecovery &) = delete;
+
+    void reset();
+
+    // After a read that returned samples
+    void succeeded();
+    // After a read that failed: what to do before reading again, after `getBackoff()`
+    RecoveryAction failed(StreamFault fault);
+    // After the action failed itself: the next, escalated, one
+    RecoveryAction retry();
+
+    [[nodiscard]] std::chrono::milliseconds getBackoff() const
+    {
+        return backoff_;
+    };
+    [[nodiscard]] bool isRecovering() const
+    {
+        return recovering_.load(std::memory_order_relaxed);
+    };
+
+    // Completed, by a good read
+    [[nodiscard]] size_t getRecoveries() const
+    {
+        return recoveries_.load(std::memory_order_relaxed);
+    };
+    [[nodiscard]] size_t getReactivations() const
+    {
+        return reactivations_.load(std::memory_order_relaxed);
+    };
+    [[nodiscard]] size_t getReopens() const
+    {
+        return reopens_.load(std::memory_order_relaxed);
+    };
+    [[nodiscard]] std::chrono::milliseconds getTimeRecovering() const
+    {
+        return std::chrono::milliseconds(timeRecovering_.load(std::memory_order_relaxed));
+    };
+
+  private:
+    StreamRecoveryOptions options_;
+
+    size_t timeoutsInARow_{0};
+    size_t errorsInARow_{0};
+    size_t attempts_{0}; // Since the recovery started
+    std::chrono::milliseconds backoff_{0};
+    std::chrono::steady_clock::time_point recoveryStart_;
+    RecoveryAction nextAttempt();
+
+    std::atomic<bool> recovering_{false};
+    std::atomic<size_t> recoveries_{0};
+    std::atomic<size_t> reactivations_{0};
+    std::atomic<size_t> reopens_{0};
+    std::atomic<long long> timeRecovering_{0}; // ms, over every completed recovery
+};
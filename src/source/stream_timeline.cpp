@@ -0,0 +1,91 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "stream_timeline.hpp"
+
+#include <cmath>
+
+static constexpr double nsPerSecond = 1e9;
+
+void StreamTimeline::reset(double nominalSampleRate)
+{
+    nominalSampleRate_ = nominalSampleRate;
+    nextIndex_ = 0;
+    pendingDiscontinuity_ = false;
+    hasLastTime_ = false;
+    lastTimeNs_ = 0;
+    lastSamples_ = 0;
+    hasAnchor_ = false;
+
+    samplesReceived_ = 0;
+    gaps_ = 0;
+    lostSamples_ = 0;
+    measuredSampleRate_ = 0;
+}
+
+uint64_t StreamTimeline::advance(size_t samples, long long timeNs, bool hardwareTime,
+                                 uint32_t &flags)
+{
+    // The hardware clock tells us how many samples went missing since the last block.
+    // Anything under one sample is just rounding.
+    if (hardwareTime && hasLastTime_ && nominalSampleRate_ > 0)
+    {
+        auto blockNs =
+            static_cast<double>(lastSamples_) * nsPerSecond / nominalSampleRate_;
+        auto expectedNs = static_cast<double>(lastTimeNs_) + blockNs;
+        auto missing = std::llround((static_cast<double>(timeNs) - expectedNs) *
+                                    nominalSampleRate_ / nsPerSecond);
+        if (missing > 0)
+        {
+            auto lost = static_cast<size_t>(missing);
+            nextIndex_ += lost;
+            lostSamples_.fetch_add(lost, std::memory_order_relaxed);
+            pendingDiscontinuity_ = true;
+        }
+    }
+
+    if (pendingDiscontinuity_)
+    {
+        flags |= SampleBlockDiscontinuity;
+        gaps_.fetch_add(1, std::memory_order_relaxed);
+        pendingDiscontinuity_ = false;
+        hasAnchor_ = false; // Don't let the gap skew the rate
+    }
+    if (hardwareTime)
+    {
+        flags |= SampleBlockHasTime;
+    }
+
+    auto index = nextIndex_;
+    nextIndex_ += samples;
+    samplesReceived_.fetch_add(samples, std::memory_order_relaxed);
+
+    // Measure the rate between two anchors at least a window apart
+    if (!hasAnchor_ || anchorHardwareTime_ != hardwareTime)
+    {
+        hasAnchor_ = true;
+        anchorHardwareTime_ = hardwareTime;
+        anchorTimeNs_ = timeNs;
+        anchorIndex_ = index;
+    }
+    else if (timeNs - anchorTimeNs_ >= rateWindowNs_)
+    {
+        auto elapsedNs = static_cast<double>(timeNs - anchorTimeNs_);
+        measuredSampleRate_.store(
+            static_cast<double>(index - anchorIndex_) * nsPerSecond / elapsedNs,
+            std::memory_order_relaxed);
+        anchorTimeNs_ = timeNs;
+        anchorIndex_ = index;
+    }
+
+    hasLastTime_ = hardwareTime;
+    lastTimeNs_ = timeNs;
+    lastSamples_ = samples;
+
+    return index;
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "sample_block.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+// Follows a stream's sample count against its timestamps. It gives every block its
+// absolute sample index, spots gaps (from the hardware time, or flagged by the source)
+// and measures the real sample rate. `advance` is meant for the acquisition thread only;
+// the counters may be read from anywhere.
+class StreamTimeline
+{
+  public:
+    StreamTimeline() = default;
+    ~StreamTimeline() = default;
+    StreamTimeline(const StreamTimeline &) = delete;
+    StreamTimeline &operator=(const StreamTimeline &) = delete;
+
+    void reset(double nominalSampleRate);
+
+    // Accounts for `samples` new samples read at `timeNs`. Returns the index of the first
+    // one and adds any flags the block should carry to `flags`.
+    uint64_t advance(size_t samples, long long timeNs, bool hardwareTime,
+                     uint32_t &flags);
+
+    // The next block will be flagged as a discontinuity (overflow, dropped block, ...)
+    void markDiscontinuity()
+    {
+        pendingDiscontinuity_ = true;
+    };
+
+    [[nodiscard]] size_t getSamplesReceived() const
+    {
+        return samplesReceived_.load(std::memory_order_relaxed);
+    };
+    [[nodiscard]] size_t getGaps() const
+    {
+        return gaps_.load(std::memory_order_relaxed);
+    };
+    [[nodiscard]] size_t getLostSamples() const
+    {
+        return lostSamples_.load(std::memory_order_relaxed);
+    };
+    [[nodiscard]] double getMeasuredSampleRate() const
+    {
+        return measuredSampleRate_.load(std::memory_order_relaxed);
+    };
+
+  private:
+    double nominalSampleRate_{0};
+    uint64_t nextIndex_{0};
+    bool pendingDiscontinuity_{false};
+
+    bool hasLastTime_{false};
+    long long lastTimeNs_{0};
+    size_t lastSamples_{0};
+
+    // The rate is measured over windows of at least `rateWindowNs_`
+    static constexpr long long rateWindowNs_ = 1'000'000'000;
+    bool hasAnchor_{false};
+    bool anchorHardwareTime_{false};
+    long long anchorTimeNs_{0};
+    uint64_t anchorIndex_{0};
+
+    std::atomic<size_t> samplesReceived_{0};
+    std::atomic<size_t> gaps_{0};
+    std::atomic<size_t> lostSamples_{0};
+    std::atomic<double> measuredSampleRate_{0};
+};
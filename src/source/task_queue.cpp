@@ -0,0 +1,98 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "task_queue.hpp"
+
+#include <utility>
+
+TaskQueue::TaskQueue()
+    : idleInterval_(0), stopping_(false),
+      // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+      worker_(new std::thread(&TaskQueue::worker, this)), workerId_(worker_->get_id())
+{
+}
+
+TaskQueue::~TaskQueue()
+{
+    stop();
+}
+
+void TaskQueue::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_)
+        {
+            return;
+        }
+        stopping_ = true;
+        tasks_.clear();
+    }
+    wake_.notify_all();
+
+    worker_->join();
+    delete worker_;
+    worker_ = nullptr;
+}
+
+bool TaskQueue::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_)
+        {
+            return false;
+        }
+        tasks_.push_back(std::move(task));
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void TaskQueue::setIdleTask(std::chrono::milliseconds interval,
+                            std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idleInterval_ = interval;
+        idleTask_ = std::move(task);
+    }
+    wake_.notify_one();
+}
+
+void TaskQueue::worker()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        std::function<void()> task;
+        if (!tasks_.empty())
+        {
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        else if (!idleTask_)
+        {
+            wake_.wait(lock);
+            continue;
+        }
+        else if (!wake_.wait_for(lock, idleInterval_,
+                                 [&]() { return !tasks_.empty() || stopping_; }))
+        {
+            task = idleTask_;
+        }
+
+        // Never run a task while holding the lock, it may post more
+        if (task)
+        {
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Runs tasks one at a time, in the order they were posted, on its own thread. Keeps slow
+// driver calls (enumerating, opening and probing devices) off the GUI thread.
+class TaskQueue
+{
+  public:
+    TaskQueue();
+    ~TaskQueue();
+    TaskQueue(const TaskQueue &) = delete;
+    TaskQueue &operator=(const TaskQueue &) = delete;
+
+    // False, and `task` is dropped, once stopped
+    bool post(std::function<void()> task);
+
+    // Runs `task` on the queue's thread and waits for its result. Called from a task, it
+    // just runs it. If the queue is stopped before `task` gets to run, it never does and
+    // the result is a default one (nullptr, an empty list...).
+    template <typename Task> auto call(Task task) -> decltype(task())
+    {
+        if (std::this_thread::get_id() == workerId_)
+        {
+            return task();
+        }
+
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        auto result = packaged->get_future();
+        // `stop()` may drop it, which leaves the future ready but without a result. Only
+        // the queue holds it, or that would never happen.
+        auto ran = std::make_shared<std::atomic<bool>>(false);
+        if (!post([packaged = std::move(packaged), ran]() {
+                *ran = true;
+                (*packaged)();
+            }))
+        {
+            return Result();
+        }
+        result.wait();
+        if (!*ran)
+        {
+            return Result();
+        }
+        return result.get();
+    }
+
+    // Runs `task` whenever the queue has been empty for `interval`, e.g. to poll for
+    // hotplugged devices. An empty task stops it.
+    void setIdleTask(std::chrono::milliseconds interval, std::function<void()> task);
+
+    // Drops whatever is still queued and waits for the running task. Nothing runs after.
+    void stop();
+
+  private:
+    std::deque<std::function<void()>> tasks_;
+    std::function<void()> idleTask_;
+    std::chrono::milliseconds idleInterval_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_;
+
+    std::thread *worker_;
+    std::thread::id workerId_; // Still valid once `worker_` is gone
+    void worker();
+};
@@ -0,0 +1,143 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "thread_scheduling.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+// What the platform's affinity mask can hold, 0 without one
+static int maxCpus()
+{
+#if defined(__linux__)
+    return CPU_SETSIZE;
+#elif defined(_WIN32)
+    return std::numeric_limits<DWORD_PTR>::digits;
+#else
+    return 0;
+#endif
+}
+
+static bool setAffinity(const std::vector<int> &cpus)
+{
+    if (cpus.empty())
+    {
+        return true;
+    }
+
+#if defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto cpu : cpus)
+    {
+        CPU_SET(cpu, &cpuSet);
+    }
+    auto res = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (res != 0)
+    {
+        qDebug() << "pthread_setaffinity_np failed with error: " << res;
+        return false;
+    }
+    return true;
+#elif defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (auto cpu : cpus)
+    {
+        mask |= DWORD_PTR{1} << static_cast<unsigned>(cpu);
+    }
+    if (SetThreadAffinityMask(GetCurrentThread(), mask) == 0)
+    {
+        qDebug() << "SetThreadAffinityMask failed with error: " << GetLastError();
+        return false;
+    }
+    return true;
+#else
+    qDebug() << "Thread affinity isn't supported on this platform.";
+    return false;
+#endif
+}
+
+static bool setPolicy(SchedulingPolicy policy, int priority)
+{
+    if (policy == SchedulingPolicy::Default)
+    {
+        return true;
+    }
+
+#if defined(__linux__)
+    auto native = policy == SchedulingPolicy::Fifo ? SCHED_FIFO : SCHED_RR;
+    sched_param param{};
+    param.sched_priority = std::clamp(priority, sched_get_priority_min(native),
+                                      sched_get_priority_max(native));
+    auto res = pthread_setschedparam(pthread_self(), native, &param);
+    if (res != 0)
+    {
+        qDebug() << "pthread_setschedparam failed with error: " << res
+                 << ", the thread keeps its default scheduling.";
+        return false;
+    }
+    return true;
+#elif defined(_WIN32)
+    // The closest Windows has, within the process's priority class
+    Q_UNUSED(priority)
+    if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) == 0)
+    {
+        qDebug() << "SetThreadPriority failed with error: " << GetLastError();
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(priority)
+    qDebug() << "Real-time scheduling isn't supported on this platform.";
+    return false;
+#endif
+}
+
+bool applyThreadProfile(const ThreadProfile &profile)
+{
+    auto limit = maxCpus();
+    auto invalid = std::find_if(profile.cpus.begin(), profile.cpus.end(),
+                                [limit](int cpu) { return cpu < 0 || cpu >= limit; });
+    if (limit > 0 && invalid != profile.cpus.end())
+    {
+        qDebug() << "CPU index " << *invalid << " out of range (0 to " << limit - 1
+                 << "), the thread isn't pinned.";
+        setPolicy(profile.policy, profile.priority);
+        return false;
+    }
+
+    auto ok = setAffinity(profile.cpus);
+    ok &= setPolicy(profile.policy, profile.priority);
+    return ok;
+}
+
+bool lockProcessMemory()
+{
+#if defined(__linux__)
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        qDebug() << "mlockall failed with error: " << errno;
+        return false;
+    }
+    return true;
+#else
+    qDebug() << "Locking the process's memory isn't supported on this platform.";
+    return false;
+#endif
+}
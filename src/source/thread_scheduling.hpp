@@ -0,0 +1,46 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <vector>
+
+enum class SchedulingPolicy
+{
+    Default,   // Time-shared, like any other thread
+    Fifo,      // Real time: runs until it blocks or a higher priority thread is ready
+    RoundRobin // Real time: like Fifo, but shares its priority level in time slices
+};
+
+// How one pipeline thread is scheduled. Anything left at its default leaves the thread
+// as the OS made it.
+struct ThreadProfile
+{
+    std::vector<int> cpus; // Pinned to these
+    SchedulingPolicy policy{SchedulingPolicy::Default};
+    int priority{0}; // 1 to 99, for the real-time policies
+};
+
+// A source's threads. The acquisition thread only drains the device and should have CPUs
+// of its own, apart from those running the listeners and any other DSP. Sources with a
+// single thread run it with the acquisition profile.
+struct SchedulingProfile
+{
+    ThreadProfile acquisition;
+    ThreadProfile dispatch;
+};
+
+// Applies `profile` to the calling thread. Threads apply their own profile before
+// allocating their buffers, so those are first touched, and placed, on the NUMA node of
+// their CPUs. Real-time policies need CAP_SYS_NICE or an rtprio limit on Linux; when
+// refused the thread carries on as it was. Returns false if any part failed.
+bool applyThreadProfile(const ThreadProfile &profile);
+
+// Locks every page of the process, current and future, in RAM so a stream never stalls
+// on a page fault. Needs CAP_IPC_LOCK or a large enough memlock limit.
+bool lockProcessMemory();
@@ -0,0 +1,291 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "spectrum_analyser.hpp"
+
+#include "trace_recorder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+bool parseSpectrumAveraging(const std::string &text, SpectrumAveraging &averaging)
+{
+    if (text == "none")
+    {
+        averaging = SpectrumAveraging::None;
+        return true;
+    }
+    if (text == "linear")
+    {
+        averaging = SpectrumAveraging::Linear;
+        return true;
+    }
+    if (text == "exponential")
+    {
+        averaging = SpectrumAveraging::Exponential;
+        return true;
+    }
+    return false;
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init, hicpp-member-init)
+SpectrumAnalyser::SpectrumAnalyser(const SpectrumOptions &options)
+    : nextOptions_(options), optionsChanged_(false), options_(options), sampleRate_(0),
+      configured_(false), plan_(nullptr), bufferSize_(0), windowGain_(1), hop_(1),
+      framesPerUpdate_(1), alpha_(1), carried_(0), nextFrame_(0), expectedIndex_(0),
+      centreFrequency_(0), averaged_(0), sinceUpdate_(0), frames_(0), spectra_(0),
+      restarts_(0)
+{
+    // The planner may take a while, better here than on the stream
+    FftPlanCache::shared().plan(std::max<size_t>(options.fftSize, 2));
+}
+
+void SpectrumAnalyser::setSampleRate(double sampleRate)
+{
+    if (sampleRate != sampleRate_)
+    {
+        sampleRate_ = sampleRate;
+        configured_ = false;
+    }
+}
+
+void SpectrumAnalyser::setCentreFrequency(double /*centreFrequency*/)
+{
+    // Every block carries the frequency it was read at, which is what the frames follow
+}
+
+void SpectrumAnalyser::setOptions(const SpectrumOptions &options)
+{
+    FftPlanCache::shared().plan(std::max<size_t>(options.fftSize, 2));
+    std::lock_guard<std::mutex> lock(optionsMutex_);
+    nextOptions_ = options;
+    optionsChanged_.store(true, std::memory_order_release);
+}
+
+SpectrumOptions SpectrumAnalyser::getOptions()
+{
+    std::lock_guard<std::mutex> lock(optionsMutex_);
+    return nextOptions_;
+}
+
+SpectrumFrame SpectrumAnalyser::getSpectrum()
+{
+    std::lock_guard<std::mutex> lock(spectrumMutex_);
+    return spectrum_;
+}
+
+void SpectrumAnalyser::configure()
+{
+    auto fftSize = std::max<size_t>(options_.fftSize, 2);
+    options_.fftSize = fftSize;
+
+    plan_ = FftPlanCache::shared().plan(fftSize);
+    if (bufferSize_ != fftSize)
+    {
+        in_ = FftPlanCache::allocate(fftSize);
+        out_ = FftPlanCache::allocate(fftSize);
+        bufferSize_ = fftSize;
+    }
+    window_ = makeWindow(options_.window, fftSize);
+    auto windowSum = std::accumulate(window_.begin(), window_.end(), 0.0F);
+    windowGain_ = windowSum * windowSum;
+
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    auto overlap = std::clamp(options_.overlap, 0.0, 0.99);
+    auto hop = std::lround(static_cast<double>(fftSize) * (1 - overlap));
+    hop_ = std::max<size_t>(static_cast<size_t>(hop), 1);
+
+    // Counted in frames, so it stays exact whatever the block size
+    auto averages = std::max<size_t>(options_.averages, 1);
+    framesPerUpdate_ = 1;
+    if (options_.updateRate > 0)
+    {
+        auto framesPerSecond = sampleRate_ / static_cast<double>(hop_);
+        auto frames = static_cast<size_t>(framesPerSecond / options_.updateRate);
+        framesPerUpdate_ = std::max<size_t>(frames, 1);
+    }
+    if (options_.averaging == SpectrumAveraging::Linear)
+    {
+        framesPerUpdate_ = std::max(framesPerUpdate_, averages);
+    }
+    alpha_ = 1.0F / static_cast<float>(averages);
+
+    carry_.resize(fftSize);
+    power_.resize(fftSize);
+    db_.resize(fftSize);
+    restart(centreFrequency_);
+    configured_ = true;
+}
+
+void SpectrumAnalyser::restart(double centreFrequency)
+{
+    if (carried_ > 0 || averaged_ > 0)
+    {
+        restarts_++;
+    }
+    carried_ = 0;
+    nextFrame_ = 0;
+    centreFrequency_ = centreFrequency;
+    std::fill(power_.begin(), power_.end(), 0.0F);
+    averaged_ = 0;
+    sinceUpdate_ = 0;
+}
+
+void SpectrumAnalyser::receiveSamples(const SampleBlockPtr &block)
+{
+    if (optionsChanged_.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(optionsMutex_);
+        options_ = nextOptions_;
+        optionsChanged_.store(false, std::memory_order_relaxed);
+        configured_ = false;
+    }
+    if (sampleRate_ <= 0)
+    {
+        return;
+    }
+    if (!configured_)
+    {
+        configure();
+    }
+
+    auto count = static_cast<ptrdiff_t>(block->size());
+    TraceScope trace("analyse", "spectrum", "samples", static_cast<int64_t>(count));
+    auto channel = std::min(options_.channel, block->channelCount() - 1);
+    const auto *samples = block->data(channel);
+
+    // A frame only ever holds contiguous samples at one frequency
+    if (block->hasFlag(SampleBlockDiscontinuity) ||
+        block->sampleIndex() != expectedIndex_ ||
+        block->centreFrequency() != centreFrequency_)
+    {
+        restart(block->centreFrequency());
+    }
+    expectedIndex_ = block->sampleIndex() + block->size();
+
+    auto fftSize = static_cast<ptrdiff_t>(options_.fftSize);
+    auto start = nextFrame_;
+    for (; start + fftSize <= count; start += static_cast<ptrdiff_t>(hop_))
+    {
+        auto due = sinceUpdate_ + 1 >= framesPerUpdate_;
+        if (options_.averaging != SpectrumAveraging::None || due)
+        {
+            if (start >= 0)
+            {
+                analyse(samples + start, options_.fftSize, nullptr);
+            }
+            else
+            {
+                auto carried = static_cast<size_t>(-start);
+                analyse(carry_.data() + carried_ - carried, carried, samples);
+            }
+        }
+        sinceUpdate_++;
+        if (due)
+        {
+            publish(block->sampleIndex() + static_cast<uint64_t>(start + fftSize));
+        }
+    }
+
+    // Keep whatever the next frame needs from this block
+    if (start >= count)
+    {
+        carried_ = 0;
+        nextFrame_ = start - count;
+        return;
+    }
+    auto keep = static_cast<size_t>(count - start);
+    if (start < 0)
+    {
+        // The kept part of the carry moves to the front, which copying forwards allows
+        auto carried = static_cast<size_t>(-start);
+        std::copy(carry_.begin() + static_cast<ptrdiff_t>(carried_ - carried),
+                  carry_.begin() + static_cast<ptrdiff_t>(carried_), carry_.begin());
+        std::copy(samples, samples + count,
+                  carry_.begin() + static_cast<ptrdiff_t>(carried));
+    }
+    else
+    {
+        std::copy(samples + start, samples + count, carry_.begin());
+    }
+    carried_ = keep;
+    nextFrame_ = -static_cast<ptrdiff_t>(keep);
+}
+
+void SpectrumAnalyser::analyse(const std::complex<float> *first, size_t firstCount,
+                               const std::complex<float> *second)
+{
+    auto fftSize = options_.fftSize;
+    applyWindow(first, window_.data(), in_.get(), firstCount);
+    if (firstCount < fftSize)
+    {
+        applyWindow(second, window_.data() + firstCount, in_.get() + firstCount,
+                    fftSize - firstCount);
+    }
+    FftPlanCache::execute(plan_, in_.get(), out_.get());
+
+    switch (options_.averaging)
+    {
+    case SpectrumAveraging::None:
+        powerSpectrum(out_.get(), power_.data(), fftSize);
+        break;
+    case SpectrumAveraging::Linear:
+        accumulatePower(out_.get(), power_.data(), fftSize);
+        break;
+    case SpectrumAveraging::Exponential:
+        // Starts from the first frame rather than from nothing
+        if (averaged_ == 0)
+        {
+            powerSpectrum(out_.get(), power_.data(), fftSize);
+        }
+        else
+        {
+            smoothPower(out_.get(), power_.data(), fftSize, alpha_);
+        }
+        break;
+    }
+    averaged_++;
+    frames_++;
+}
+
+void SpectrumAnalyser::publish(uint64_t sampleIndex)
+{
+    auto fftSize = options_.fftSize;
+    auto scale = 1.0F / windowGain_;
+    if (options_.averaging == SpectrumAveraging::Linear)
+    {
+        scale /= static_cast<float>(averaged_);
+    }
+
+    // Lowest frequency first; bin 0 of the FFT is DC and the negative ones come last
+    auto negative = fftSize / 2;
+    powerToDb(power_.data() + fftSize - negative, db_.data(), negative, scale);
+    powerToDb(power_.data(), db_.data() + negative, fftSize - negative, scale);
+
+    auto binWidth = sampleRate_ / static_cast<double>(fftSize);
+    {
+        std::lock_guard<std::mutex> lock(spectrumMutex_);
+        spectrum_.startFrequency =
+            centreFrequency_ - static_cast<double>(negative) * binWidth;
+        spectrum_.binWidth = binWidth;
+        // The old spectrum's storage is reused for the next one
+        std::swap(spectrum_.power, db_);
+        spectrum_.frames = averaged_;
+        spectrum_.sampleIndex = sampleIndex;
+        spectrum_.sequence = spectra_++;
+    }
+    db_.resize(fftSize);
+
+    sinceUpdate_ = 0;
+    if (options_.averaging != SpectrumAveraging::Exponential)
+    {
+        std::fill(power_.begin(), power_.end(), 0.0F);
+        averaged_ = 0;
+    }
+}
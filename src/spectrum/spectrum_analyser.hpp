@@ -0,0 +1,110 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "ISourceListener.hpp"
+#include "fft_plan_cache.hpp"
+#include "sample_block.hpp"
+#include "spectrum_types.hpp"
+
+#include <atomic>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Turns the stream into power spectra: windowed FFT frames overlapping by `overlap`,
+// averaged, and converted to dBFS at most `updateRate` times per second. Frames are
+// windowed straight out of the blocks; only those straddling two blocks go through a
+// small carry buffer. Gaps, retunes and new sample rates start the frames and the average
+// over. Without averaging, frames that wouldn't be shown aren't transformed at all.
+// Runs on whichever thread feeds it. Subscribe it on a dedicated thread that drops the
+// oldest blocks, so a busy CPU costs spectra rather than stalling the stream.
+class SpectrumAnalyser : public ISourceListener
+{
+  public:
+    explicit SpectrumAnalyser(const SpectrumOptions &options = SpectrumOptions());
+    ~SpectrumAnalyser() override = default;
+    SpectrumAnalyser(const SpectrumAnalyser &) = delete;
+    SpectrumAnalyser &operator=(const SpectrumAnalyser &) = delete;
+
+    void setSampleRate(double sampleRate) override;
+    void setCentreFrequency(double centreFrequency) override;
+    void receiveSamples(const SampleBlockPtr &block) override;
+
+    // Any thread. Used from the next block on; a new FFT size is planned right away, so
+    // the stream never waits for the planner.
+    void setOptions(const SpectrumOptions &options);
+    SpectrumOptions getOptions();
+
+    // The latest spectrum, empty before the first one (any thread)
+    SpectrumFrame getSpectrum();
+
+    // Statistics (any thread) -----------------------------------------------------------
+    [[nodiscard]] uint64_t getFrames() const
+    {
+        return frames_;
+    };
+    [[nodiscard]] uint64_t getSpectra() const
+    {
+        return spectra_;
+    };
+    // Frames and averages cut short by gaps or retunes
+    [[nodiscard]] uint64_t getRestarts() const
+    {
+        return restarts_;
+    };
+
+  private:
+    std::mutex optionsMutex_;
+    SpectrumOptions nextOptions_;
+    std::atomic<bool> optionsChanged_;
+
+    // Stream side
+    SpectrumOptions options_;
+    double sampleRate_;
+    bool configured_;
+    void configure();
+
+    fftwf_plan plan_;
+    size_t bufferSize_;
+    FftPlanCache::Buffer in_;
+    FftPlanCache::Buffer out_;
+    std::vector<float> window_;
+    float windowGain_; // Of a full scale tone, in power
+    size_t hop_;
+    size_t framesPerUpdate_;
+    float alpha_;
+
+    // Samples of the next frame from earlier blocks, and where it starts relative to the
+    // current block: negative if in the carry, past 0 if samples are to be skipped
+    std::vector<std::complex<float>> carry_;
+    size_t carried_;
+    ptrdiff_t nextFrame_;
+    uint64_t expectedIndex_;
+    double centreFrequency_;
+    void restart(double centreFrequency);
+
+    std::vector<float> power_;
+    size_t averaged_;
+    size_t sinceUpdate_;
+    std::vector<float> db_;
+    // A frame of `fftSize` samples: `firstCount` from `first`, the rest from `second`
+    void analyse(const std::complex<float> *first, size_t firstCount,
+                 const std::complex<float> *second);
+    void publish(uint64_t sampleIndex);
+
+    std::mutex spectrumMutex_;
+    SpectrumFrame spectrum_;
+
+    std::atomic<uint64_t> frames_;
+    std::atomic<uint64_t> spectra_;
+    std::atomic<uint64_t> restarts_;
+};
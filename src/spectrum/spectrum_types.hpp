@@ -0,0 +1,54 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "spectrum_kernels.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define SPECTRUM_FFT_SIZE 2048
+#define SPECTRUM_OVERLAP 0.5
+#define SPECTRUM_AVERAGES 16
+#define SPECTRUM_UPDATE_RATE 30.0 // Spectra per second
+
+enum class SpectrumAveraging
+{
+    None,        // Every spectrum is a single frame
+    Linear,      // The mean of the frames since the previous spectrum
+    Exponential // Each frame moves the spectrum by 1 / `averages` of the difference
+};
+
+// "none", "linear" or "exponential", for config files. False if none.
+bool parseSpectrumAveraging(const std::string &text, SpectrumAveraging &averaging);
+
+struct SpectrumOptions
+{
+    size_t fftSize{SPECTRUM_FFT_SIZE};
+    WindowFunction window{WindowFunction::BlackmanHarris};
+    double overlap{SPECTRUM_OVERLAP}; // Of each frame with the next, in [0, 1)
+    SpectrumAveraging averaging{SpectrumAveraging::Exponential};
+    // Linear: at least this many frames per spectrum. Exponential: the time constant.
+    size_t averages{SPECTRUM_AVERAGES};
+    double updateRate{SPECTRUM_UPDATE_RATE}; // Spectra per second at most, 0 for no limit
+    size_t channel{0};                       // Of multi-channel blocks
+};
+
+// One spectrum of the stream: bin `i` is at `startFrequency + i * binWidth`
+struct SpectrumFrame
+{
+    double startFrequency{0};
+    double binWidth{0};
+    std::vector<float> power; // dBFS, a full scale tone reads 0
+    size_t frames{0};         // FFTs that went into it
+    uint64_t sampleIndex{0};  // Just past the last sample in it
+    uint64_t sequence{0};     // Counting from 0
+};
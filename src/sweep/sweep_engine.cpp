@@ -0,0 +1,309 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "sweep_engine.hpp"
+
+#include "spectrum_kernels.hpp"
+#include "trace_recorder.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init, hicpp-member-init)
+SweepEngine::SweepEngine(const SweepOptions &options)
+    : options_(options), source_(nullptr), sampleRate_(0), usableBins_(0), binWidth_(0),
+      settleSamples_(0), sweeping_(false), current_(nullptr), hop_(0), settling_(0),
+      expectedIndex_(0), analyser_(nullptr), analysing_(false), plan_(nullptr),
+      windowGain_(0), sweeps_(0), hopsDone_(0), hopsPerSecond_(0)
+{
+}
+
+SweepEngine::~SweepEngine()
+{
+    stopSweep();
+}
+
+void SweepEngine::setSampleRate(double sampleRate)
+{
+    if (sweeping_ && sampleRate != sampleRate_)
+    {
+        qDebug() << "Sample rate changed while sweeping, the hops no longer line up.";
+    }
+}
+
+void SweepEngine::setCentreFrequency(double /*centreFrequency*/)
+{
+    // Every block carries the frequency it was read at
+}
+
+bool SweepEngine::startSweep(ISource *source)
+{
+    if (sweeping_)
+    {
+        qDebug() << "Already sweeping!";
+        return false;
+    }
+
+    auto sampleRate = source->getSampleRate();
+    auto fftSize = options_.fftSize;
+    if (options_.stopFrequency <= options_.startFrequency || sampleRate <= 0 ||
+        fftSize < 2 || options_.averages == 0)
+    {
+        qDebug() << "Invalid sweep: " << options_.startFrequency << " to "
+                 << options_.stopFrequency << " at " << sampleRate << " S/s.";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(producerMutex_);
+
+    // Whole bins either side of DC, so consecutive hops tile without gaps or overlap
+    auto usable = static_cast<size_t>(options_.usableFraction * fftSize);
+    usableBins_ = std::clamp<size_t>(usable & ~size_t(1), 2, fftSize);
+    sampleRate_ = sampleRate;
+    binWidth_ = sampleRate / static_cast<double>(fftSize);
+    auto hopStep = static_cast<double>(usableBins_) * binWidth_;
+    auto span = options_.stopFrequency - options_.startFrequency;
+    auto hopCount = std::max<size_t>(static_cast<size_t>(std::ceil(span / hopStep)), 1);
+    hops_.clear();
+    for (auto i = 0U; i < hopCount; i++)
+    {
+        // NOLINTNEXTLINE(readability-magic-numbers)
+        hops_.push_back(options_.startFrequency + (i + 0.5) * hopStep);
+    }
+    // A single hop is never retuned, so it never settles either
+    settleSamples_ =
+        hopCount > 1 ? static_cast<size_t>(options_.settleTime * sampleRate) : 0;
+
+    captures_.resize(SWEEP_CAPTURES);
+    full_ = std::make_unique<SpscRingBuffer<Capture *>>(captures_.size());
+    free_ = std::make_unique<SpscRingBuffer<Capture *>>(captures_.size());
+    for (auto &capture : captures_)
+    {
+        capture.samples.resize(fftSize * options_.averages);
+        *free_->writeSlot() = &capture;
+        free_->commitWrite();
+    }
+
+    window_ = makeWindow(WindowFunction::Hann, fftSize);
+    auto windowSum = std::accumulate(window_.begin(), window_.end(), 0.0F);
+    windowGain_ = windowSum * windowSum;
+
+    plan_ = FftPlanCache::shared().plan(fftSize);
+    in_ = FftPlanCache::allocate(fftSize);
+    out_ = FftPlanCache::allocate(fftSize);
+    power_.resize(fftSize);
+    stitched_.assign(hopCount * usableBins_, 0);
+
+    {
+        std::lock_guard<std::mutex> spectrumLock(spectrumMutex_);
+        spectrum_ = SweepSpectrum{options_.startFrequency, binWidth_, {}, 0};
+    }
+    sweeps_ = 0;
+    hopsDone_ = 0;
+    hopsPerSecond_ = 0;
+    sweepStart_ = std::chrono::steady_clock::now();
+
+    source_ = source;
+    current_ = nullptr;
+    hop_ = 0;
+    settling_ = settleSamples_;
+    expectedIndex_ = 0;
+
+    analysing_ = true;
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    analyser_ = new std::thread(&SweepEngine::analyser, this);
+
+    sweeping_.store(true, std::memory_order_release);
+    source_->setCentreFrequency(hops_.front());
+    return true;
+}
+
+void SweepEngine::stopSweep()
+{
+    if (!sweeping_)
+    {
+        return;
+    }
+
+    sweeping_ = false;
+    {
+        // Waits for a block being captured right now
+        std::lock_guard<std::mutex> lock(producerMutex_);
+        current_ = nullptr;
+    }
+
+    analysing_ = false;
+    full_->notify();
+    analyser_->join();
+    delete analyser_;
+    analyser_ = nullptr;
+}
+
+void SweepEngine::nextHop()
+{
+    // Never full: it has room for every capture
+    current_->hop = hop_;
+    *full_->writeSlot() = current_;
+    full_->commitWrite();
+    current_ = nullptr;
+
+    hop_ = (hop_ + 1) % hops_.size();
+    settling_ = settleSamples_;
+    source_->setCentreFrequency(hops_[hop_]);
+}
+
+void SweepEngine::receiveSamples(const SampleBlockPtr &block)
+{
+    if (!sweeping_.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(producerMutex_, std::try_to_lock);
+    if (!lock.owns_lock() || !sweeping_.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    // Still at the previous hop
+    if (block->centreFrequency() != hops_[hop_])
+    {
+        return;
+    }
+
+    if (current_ == nullptr)
+    {
+        auto *slot = free_->readSlot();
+        if (slot == nullptr)
+        {
+            return; // The FFT thread is behind, dwell a little longer
+        }
+        current_ = *slot;
+        free_->commitRead();
+        current_->used = 0;
+    }
+
+    // Frames must be contiguous: start the one in progress over after a gap
+    auto frameSize = options_.fftSize;
+    if (block->hasFlag(SampleBlockDiscontinuity) ||
+        block->sampleIndex() != expectedIndex_)
+    {
+        current_->used -= current_->used % frameSize;
+    }
+    expectedIndex_ = block->sampleIndex() + block->size();
+
+    auto skip = std::min(settling_, block->size());
+    settling_ -= skip;
+
+    auto channel = std::min(options_.channel, block->channelCount() - 1);
+    const auto *samples = block->data(channel) + skip;
+    auto count =
+        std::min(block->size() - skip, current_->samples.size() - current_->used);
+    std::copy(samples, samples + count, current_->samples.begin() + current_->used);
+    current_->used += count;
+
+    if (current_->used == current_->samples.size())
+    {
+        nextHop();
+    }
+}
+
+void SweepEngine::analyser()
+{
+    applyThreadProfile(options_.fftThread);
+    TraceRecorder::nameThread("sweep analyser");
+
+    while (true)
+    {
+        auto *slot = full_->readSlot();
+        if (slot == nullptr)
+        {
+            if (!analysing_)
+            {
+                break;
+            }
+            full_->waitForData(std::chrono::microseconds(SWEEP_FFT_WAIT));
+            continue;
+        }
+
+        auto *capture = *slot;
+        full_->commitRead();
+
+        {
+            TraceScope trace("analyse", "sweep", "hop",
+                             static_cast<int64_t>(capture->hop));
+            analyse(*capture);
+        }
+
+        *free_->writeSlot() = capture;
+        free_->commitWrite();
+    }
+}
+
+void SweepEngine::analyse(const Capture &capture)
+{
+    auto fftSize = options_.fftSize;
+    std::fill(power_.begin(), power_.end(), 0.0F);
+    for (auto frame = 0U; frame < options_.averages; frame++)
+    {
+        const auto *samples = capture.samples.data() + frame * fftSize;
+        applyWindow(samples, window_.data(), in_.get(), fftSize);
+        FftPlanCache::execute(plan_, in_.get(), out_.get());
+        accumulatePower(out_.get(), power_.data(), fftSize);
+    }
+
+    // Keep the middle of the spectrum, lowest frequency first; bin 0 of the FFT is DC
+    auto scale = 1.0F / (static_cast<float>(options_.averages) * windowGain_);
+    auto first = fftSize - usableBins_ / 2;
+    auto *hop = stitched_.data() + capture.hop * usableBins_;
+    for (auto i = 0U; i < usableBins_; i++)
+    {
+        hop[i] = power_[(first + i) % fftSize] * scale;
+    }
+
+    // The LO leaks in at DC: bridge over it from the bins either side
+    auto dc = usableBins_ / 2;
+    auto mask = std::min(options_.dcMaskBins, dc - 1);
+    if (options_.dcMaskBins > 0 && dc + mask + 1 < usableBins_)
+    {
+        auto left = hop[dc - mask - 1];
+        auto right = hop[dc + mask + 1];
+        auto span = static_cast<float>(2 * mask + 2);
+        for (auto i = dc - mask; i <= dc + mask; i++)
+        {
+            auto t = static_cast<float>(i - (dc - mask - 1)) / span;
+            hop[i] = left + (right - left) * t;
+        }
+    }
+
+    powerToDb(hop, hop, usableBins_, 1.0F);
+    hopsDone_++;
+
+    if (capture.hop + 1 < hops_.size())
+    {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(now - sweepStart_).count();
+    sweepStart_ = now;
+    hopsPerSecond_ = seconds > 0 ? static_cast<double>(hops_.size()) / seconds : 0;
+
+    std::lock_guard<std::mutex> lock(spectrumMutex_);
+    spectrum_.power = stitched_;
+    spectrum_.sweep = sweeps_++;
+}
+
+SweepSpectrum SweepEngine::getSpectrum()
+{
+    std::lock_guard<std::mutex> lock(spectrumMutex_);
+    return spectrum_;
+}
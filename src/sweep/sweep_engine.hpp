@@ -0,0 +1,129 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "ISource.hpp"
+#include "ISourceListener.hpp"
+#include "fft_plan_cache.hpp"
+#include "sample_block.hpp"
+#include "spsc_ring_buffer.hpp"
+#include "sweep_types.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Sweeps a source across a span wider than its sample rate and stitches the hops into a
+// single power spectrum.
+// Hops are spaced by the usable part of the spectrum, so their trimmed spectra tile the
+// span exactly. The dwell is counted in samples from the first block at the hop's
+// frequency: the settle time is dropped, then `averages` FFT frames are captured and the
+// source is retuned to the next hop right away, from its stream thread. The captured
+// hop goes to an FFT thread, so its FFTs overlap with the next retune and settling.
+// Must be subscribed inline (not on a dedicated thread), as it retunes from the stream.
+class SweepEngine : public ISourceListener
+{
+  public:
+    explicit SweepEngine(const SweepOptions &options);
+    ~SweepEngine() override;
+    SweepEngine(const SweepEngine &) = delete;
+    SweepEngine &operator=(const SweepEngine &) = delete;
+
+    void setSampleRate(double sampleRate) override;
+    void setCentreFrequency(double centreFrequency) override;
+    void receiveSamples(const SampleBlockPtr &block) override;
+
+    // Plans the hops for the source's sample rate and tunes it to the first one
+    bool startSweep(ISource *source);
+    void stopSweep();
+    [[nodiscard]] bool isSweeping() const
+    {
+        return sweeping_;
+    };
+    [[nodiscard]] size_t getHopCount() const
+    {
+        return hops_.size();
+    };
+
+    // The last complete sweep, empty before the first one
+    SweepSpectrum getSpectrum();
+
+    // Statistics (any thread) -----------------------------------------------------------
+    [[nodiscard]] uint64_t getSweeps() const
+    {
+        return sweeps_;
+    };
+    [[nodiscard]] uint64_t getHops() const
+    {
+        return hopsDone_;
+    };
+    // Over the last complete sweep
+    [[nodiscard]] double getHopsPerSecond() const
+    {
+        return hopsPerSecond_;
+    };
+
+  private:
+    struct Capture
+    {
+        std::vector<std::complex<float>> samples; // `averages` frames back to back
+        size_t used;
+        size_t hop;
+    };
+
+    SweepOptions options_;
+    ISource *source_;
+
+    // The plan, fixed while sweeping
+    double sampleRate_;
+    std::vector<double> hops_;
+    size_t usableBins_;
+    double binWidth_;
+    size_t settleSamples_;
+    std::vector<Capture> captures_;
+
+    // Captured hops go to the FFT thread, which gives them back once analysed
+    std::unique_ptr<SpscRingBuffer<Capture *>> full_;
+    std::unique_ptr<SpscRingBuffer<Capture *>> free_;
+
+    // Stream side. Only start and stop take the mutex; the stream thread just tries it.
+    std::mutex producerMutex_;
+    std::atomic<bool> sweeping_;
+    Capture *current_;
+    size_t hop_;
+    size_t settling_;
+    uint64_t expectedIndex_;
+    void nextHop();
+
+    // FFT side
+    std::thread *analyser_;
+    std::atomic<bool> analysing_;
+    fftwf_plan plan_;
+    FftPlanCache::Buffer in_;
+    FftPlanCache::Buffer out_;
+    std::vector<float> window_;
+    float windowGain_; // Of a full scale tone, in power
+    std::vector<float> power_;
+    std::vector<float> stitched_;
+    std::chrono::steady_clock::time_point sweepStart_;
+    void analyser();
+    void analyse(const Capture &capture);
+
+    std::mutex spectrumMutex_;
+    SweepSpectrum spectrum_;
+
+    std::atomic<uint64_t> sweeps_;
+    std::atomic<uint64_t> hopsDone_;
+    std::atomic<double> hopsPerSecond_;
+};
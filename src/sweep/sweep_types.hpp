@@ -0,0 +1,49 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "thread_scheduling.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define SWEEP_FFT_SIZE 1024
+#define SWEEP_AVERAGES 8
+#define SWEEP_USABLE_FRACTION 0.75 // Of each hop's spectrum, the rest is filter roll-off
+#define SWEEP_DC_MASK_BINS 2       // Either side of DC
+#define SWEEP_SETTLE_TIME 0.005    // s, a transfer in flight and the PLL locking
+#define SWEEP_CAPTURES 4           // Hops captured ahead of the FFT thread
+#define SWEEP_FFT_WAIT 100000      // us
+
+// Hops are told apart by the frequency each block is tagged with, so this relies on the
+// source tagging what it had buffered before a retune with the old frequency (as
+// `SoapySdrRadio` does, draining the driver first). `settleTime` only has to cover what
+// the source can't tell apart: samples in flight during the retune, and the PLL locking.
+struct SweepOptions
+{
+    double startFrequency{0};
+    double stopFrequency{0};
+    size_t fftSize{SWEEP_FFT_SIZE};
+    size_t averages{SWEEP_AVERAGES};              // FFTs per hop
+    double usableFraction{SWEEP_USABLE_FRACTION}; // Hops overlap by the rest
+    size_t dcMaskBins{SWEEP_DC_MASK_BINS};        // Bridged over from their neighbours
+    double settleTime{SWEEP_SETTLE_TIME};         // Dropped after every hop, s
+    size_t channel{0};                            // Of multi-channel blocks
+    ThreadProfile fftThread;
+};
+
+// A whole sweep stitched into one spectrum: bin `i` is at `startFrequency + i * binWidth`
+struct SweepSpectrum
+{
+    double startFrequency{0};
+    double binWidth{0};
+    std::vector<float> power; // dBFS
+    uint64_t sweep{0};        // Counting from 0
+};
@@ -0,0 +1,412 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "synthetic_source.hpp"
+
+#include "synthetic_widget.hpp"
+#include "thread_scheduling.hpp"
+#include "trace_recorder.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+
+static float fromDbfs(double level)
+{
+    // NOLINTNEXTLINE(readability-magic-numbers)
+    return static_cast<float>(std::pow(10.0, level / 20));
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-pro-type-member-init, hicpp-member-init)
+SyntheticSource::SyntheticSource()
+    : settingsVersion_(0), activeVersion_(0), worker_(nullptr), running_(false),
+      droppedBlocks_(0), pacing_(SourcePacing::RealTime),
+      blockSize_(SYNTHETIC_BLOCK_SAMPLES),
+      centreFrequency_(SYNTHETIC_INITIAL_CENTRE_FREQUENCY),
+      sampleRate_(SYNTHETIC_INITIAL_SAMPLE_RATE), widget_(nullptr)
+{
+}
+
+SyntheticSource::~SyntheticSource()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+SyntheticSettings SyntheticSource::getSettings()
+{
+    std::lock_guard<std::mutex> lock(settingsMutex_);
+    return settings_;
+}
+
+void SyntheticSource::setSettings(const SyntheticSettings &settings)
+{
+    std::lock_guard<std::mutex> lock(settingsMutex_);
+    settings_ = settings;
+    settingsVersion_++;
+}
+
+void SyntheticSource::applySettings(bool restart)
+{
+    {
+        std::lock_guard<std::mutex> lock(settingsMutex_);
+        active_ = settings_;
+        activeVersion_ = settingsVersion_;
+    }
+
+    // The generators work in cycles per sample
+    auto normalise = [&](double frequency) { return frequency / sampleRate_; };
+
+    if (active_.signal == SyntheticSignal::Chirp)
+    {
+        tone_.setSweep(normalise(active_.frequency), normalise(active_.sweepEnd),
+                       active_.sweepTime * sampleRate_);
+    }
+    else
+    {
+        tone_.setTone(normalise(active_.frequency));
+    }
+    fm_.configure(normalise(active_.frequency), normalise(active_.deviation),
+                  normalise(active_.modulationFrequency));
+    qpsk_.configure(normalise(active_.frequency), normalise(active_.symbolRate));
+
+    // Only a restart goes back to the seed; live changes keep the stream continuous
+    if (restart)
+    {
+        tone_.reset();
+        fm_.reset();
+        qpsk_.reset(active_.seed);
+        noise_.seed(active_.seed);
+    }
+}
+
+void SyntheticSource::generate(std::complex<float> *out, size_t count)
+{
+    auto level = fromDbfs(active_.level);
+    switch (active_.signal)
+    {
+    case SyntheticSignal::Tone:
+    case SyntheticSignal::Chirp:
+        tone_.generate(out, count, level);
+        break;
+    case SyntheticSignal::Fm:
+        fm_.generate(out, count, level);
+        break;
+    case SyntheticSignal::Qpsk:
+        qpsk_.generate(out, count, level);
+        break;
+    case SyntheticSignal::Noise:
+        noise_.generate(out, count, level);
+        return;
+    }
+
+    if (active_.noise)
+    {
+        noise_.add(out, count, fromDbfs(active_.noiseLevel));
+    }
+}
+
+void SyntheticSource::worker()
+{
+    // Before anything is allocated, so the blocks land on this CPU's NUMA node
+    applyThreadProfile(scheduling_.acquisition);
+    TraceRecorder::nameThread("synthetic acquisition");
+    pool_ = SampleBlockPool::make(SYNTHETIC_POOL_BLOCKS, blockSize_);
+
+    applySettings(true);
+
+    // Sync up the listeners
+    for (const auto &listener : listeners_)
+    {
+        listener->setSampleRate(sampleRate_);
+        listener->setCentreFrequency(centreFrequency_);
+    }
+
+    timeline_.reset(sampleRate_);
+    droppedBlocks_ = 0;
+
+    double tunedFrequency = centreFrequency_;
+    bool retuned = false; // Until the first block after it is delivered
+
+    PacingClock pacing;
+    pacing.reset(sampleRate_);
+
+    while (running_)
+    {
+        if (settingsVersion_ != activeVersion_)
+        {
+            applySettings(false);
+        }
+
+        // Listeners hear of a retune in step with the samples, right before its first
+        // block
+        double frequency = centreFrequency_;
+        if (frequency != tunedFrequency)
+        {
+            tunedFrequency = frequency;
+            retuned = true;
+            traceInstant("retune", "source", "hz", static_cast<int64_t>(frequency));
+            for (const auto &listener : listeners_)
+            {
+                listener->setCentreFrequency(tunedFrequency);
+            }
+        }
+
+        if (pacing_ == SourcePacing::RealTime)
+        {
+            pacing.pace(blockSize_);
+        }
+        else
+        {
+            pacing.reset(sampleRate_);
+        }
+
+        auto block = pool_->acquire();
+        if (!block && pacing_ == SourcePacing::AsFastAsPossible)
+        {
+            // The listeners set the pace: wait for them to give a block back
+            std::this_thread::sleep_for(std::chrono::microseconds(SYNTHETIC_POOL_WAIT));
+            continue;
+        }
+
+        auto timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+        uint32_t blockFlags = 0;
+        auto sampleIndex = timeline_.advance(blockSize_, timeNs, false, blockFlags);
+
+        // In real time the stream moves on without slow listeners, like a device
+        if (!block)
+        {
+            droppedBlocks_++;
+            timeline_.markDiscontinuity();
+            continue;
+        }
+
+        if (retuned)
+        {
+            blockFlags |= SampleBlockRetuned;
+            retuned = false;
+        }
+
+        {
+            TraceScope trace("generate", "source", "samples",
+                             static_cast<int64_t>(blockSize_));
+            generate(block->data(), blockSize_);
+        }
+        // Like a device's samples, these exist once they're generated
+        block->setSize(blockSize_);
+        block->setTimeNs(timeNs);
+        block->setReadNs(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now().time_since_epoch())
+                             .count());
+        block->setSampleIndex(sampleIndex);
+        block->setFlags(blockFlags);
+        block->setCentreFrequency(tunedFrequency);
+
+        for (size_t i = 0; i < listeners_.size(); i++)
+        {
+            TraceScope trace("receiveSamples", "listener", "listener",
+                             static_cast<int64_t>(i));
+            listeners_[i]->receiveSamples(block);
+        }
+    }
+}
+
+void SyntheticSource::start()
+{
+    if (running_)
+    {
+        qDebug() << "Already running!";
+        return;
+    }
+
+    running_ = true;
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    worker_ = new std::thread(&SyntheticSource::worker, this);
+
+    if (widget_ != nullptr)
+    {
+        widget_->sourceStarted();
+    }
+}
+
+void SyntheticSource::stop()
+{
+    if (!running_)
+    {
+        qDebug() << "Already not running!";
+        return;
+    }
+
+    running_ = false;
+
+    if (worker_ != nullptr)
+    {
+        worker_->join();
+        delete worker_;
+    }
+
+    worker_ = nullptr;
+
+    qDebug() << "Generated samples: " << timeline_.getSamplesReceived()
+             << ", dropped blocks: " << droppedBlocks_
+             << ", measured sample rate: " << timeline_.getMeasuredSampleRate();
+
+    if (widget_ != nullptr)
+    {
+        widget_->sourceStopped();
+    }
+}
+
+SourceStatistics SyntheticSource::getStatistics()
+{
+    SourceStatistics stats;
+    stats.droppedBlocks = droppedBlocks_;
+    stats.samplesReceived = timeline_.getSamplesReceived();
+    stats.gaps = timeline_.getGaps();
+    stats.lostSamples = timeline_.getLostSamples();
+    stats.measuredSampleRate = timeline_.getMeasuredSampleRate();
+    return stats;
+}
+
+void SyntheticSource::setPacing(SourcePacing pacing)
+{
+    pacing_ = pacing;
+}
+
+void SyntheticSource::setBlockSize(size_t blockSize)
+{
+    if (running_)
+    {
+        qDebug() << "Can't change the block size while running.";
+        return;
+    }
+
+    blockSize_ = std::max<size_t>(blockSize, 1);
+}
+
+void SyntheticSource::setCentreFrequency(double centreFrequency)
+{
+    centreFrequency_ = centreFrequency;
+
+    // The worker passes it on with the next block
+    if (running_)
+    {
+        return;
+    }
+
+    for (const auto &listener : listeners_)
+    {
+        listener->setCentreFrequency(centreFrequency_);
+    }
+}
+
+void SyntheticSource::setSampleRate(double sampleRate)
+{
+    if (running_)
+    {
+        qDebug() << "Can't change the sample rate while running.";
+        return;
+    }
+
+    if (sampleRate <= 0)
+    {
+        qDebug() << "Invalid sample rate: " << sampleRate;
+        return;
+    }
+
+    sampleRate_ = sampleRate;
+}
+
+bool SyntheticSource::configure(const QJsonObject &settings)
+{
+    auto ok = true;
+    auto next = getSettings();
+
+    if (settings.contains("signal"))
+    {
+        static const std::map<QString, SyntheticSignal> signalNames{
+            {"tone", SyntheticSignal::Tone},
+            {"chirp", SyntheticSignal::Chirp},
+            {"fm", SyntheticSignal::Fm},
+            {"qpsk", SyntheticSignal::Qpsk},
+            {"noise", SyntheticSignal::Noise}};
+        auto signal = signalNames.find(settings["signal"].toString());
+        if (signal != signalNames.end())
+        {
+            next.signal = signal->second;
+        }
+        else
+        {
+            qDebug() << "Unknown signal: " << settings["signal"];
+            ok = false;
+        }
+    }
+    next.frequency = settings["frequency"].toDouble(next.frequency);
+    next.sweepEnd = settings["sweep_end"].toDouble(next.sweepEnd);
+    next.sweepTime = settings["sweep_time"].toDouble(next.sweepTime);
+    next.deviation = settings["deviation"].toDouble(next.deviation);
+    next.modulationFrequency =
+        settings["modulation_frequency"].toDouble(next.modulationFrequency);
+    next.symbolRate = settings["symbol_rate"].toDouble(next.symbolRate);
+    next.level = settings["level"].toDouble(next.level);
+    next.noise = settings["noise"].toBool(next.noise);
+    next.noiseLevel = settings["noise_level"].toDouble(next.noiseLevel);
+    next.seed = static_cast<uint32_t>(
+        settings["seed"].toDouble(static_cast<double>(next.seed)));
+    setSettings(next);
+
+    if (settings.contains("sample_rate"))
+    {
+        setSampleRate(settings["sample_rate"].toDouble());
+        ok &= sampleRate_ == settings["sample_rate"].toDouble();
+    }
+    if (settings.contains("block_size"))
+    {
+        setBlockSize(static_cast<size_t>(settings["block_size"].toInt()));
+    }
+    if (settings.contains("pacing"))
+    {
+        SourcePacing pacing{};
+        if (parseSourcePacing(settings["pacing"].toString().toStdString(), pacing))
+        {
+            setPacing(pacing);
+        }
+        else
+        {
+            qDebug() << "Unknown pacing: " << settings["pacing"];
+            ok = false;
+        }
+    }
+
+    if (widget_ != nullptr)
+    {
+        widget_->syncUi();
+    }
+
+    return ISource::configure(settings) && ok;
+}
+
+QWidget *SyntheticSource::getWidget()
+{
+    if (widget_ == nullptr)
+    {
+        widget_ = std::make_unique<SyntheticWidget>(this);
+        if (running_)
+        {
+            widget_->sourceStarted();
+        }
+    }
+    return static_cast<QWidget *>(widget_.get());
+}
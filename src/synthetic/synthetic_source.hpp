@@ -0,0 +1,129 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "ISource.hpp"
+#include "sample_block.hpp"
+#include "signal_generators.hpp"
+#include "source_pacing.hpp"
+#include "stream_timeline.hpp"
+#include "synthetic_types.hpp"
+#include "synthetic_widget.hpp"
+
+#include <QWidget>
+
+#include <atomic>
+#include <complex>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Generates test signals at any sample rate, with no hardware. As fast as possible it
+// finds how many samples per second the listeners can take; the same seed always gives
+// the same stream.
+class SyntheticSource : public ISource
+{
+  public:
+    SyntheticSource();
+    ~SyntheticSource() override;
+    SyntheticSource(const SyntheticSource &) = delete;
+    SyntheticSource &operator=(const SyntheticSource &) = delete;
+
+    // Signal ----------------------------------------------------------------------------
+  private:
+    std::mutex settingsMutex_;
+    SyntheticSettings settings_;
+    std::atomic<uint64_t> settingsVersion_; // Bumped on every change
+
+    // Worker only
+    SyntheticSettings active_;
+    uint64_t activeVersion_;
+    ToneGenerator tone_;
+    FmGenerator fm_;
+    QpskGenerator qpsk_;
+    NoiseGenerator noise_;
+    void applySettings(bool restart);
+    void generate(std::complex<float> *out, size_t count);
+
+  public:
+    SyntheticSettings getSettings();
+    // May be called while running, the worker picks it up before its next block
+    void setSettings(const SyntheticSettings &settings);
+
+    // Acquisition -----------------------------------------------------------------------
+  private:
+    std::thread *worker_;
+    std::atomic<bool> running_;
+    void worker();
+
+    std::shared_ptr<SampleBlockPool> pool_;
+    StreamTimeline timeline_;
+    std::atomic<size_t> droppedBlocks_;
+
+  public:
+    void start() override;
+    void stop() override;
+    SourceStatistics getStatistics() override;
+    [[nodiscard]] bool isRunning() const
+    {
+        return running_;
+    };
+
+    // Pacing ----------------------------------------------------------------------------
+  private:
+    std::atomic<SourcePacing> pacing_;
+    size_t blockSize_;
+
+  public:
+    [[nodiscard]] SourcePacing getPacing() const
+    {
+        return pacing_;
+    };
+    void setPacing(SourcePacing pacing);
+    [[nodiscard]] size_t getBlockSize() const
+    {
+        return blockSize_;
+    };
+    void setBlockSize(size_t blockSize);
+
+    // Frequency -------------------------------------------------------------------------
+  private:
+    std::atomic<double> centreFrequency_;
+
+  public:
+    double getCentreFrequency() override
+    {
+        return centreFrequency_;
+    };
+    void setCentreFrequency(double centreFrequency) override;
+
+    // Sample rate -----------------------------------------------------------------------
+  private:
+    double sampleRate_;
+
+  public:
+    double getSampleRate() override
+    {
+        return sampleRate_;
+    };
+    void setSampleRate(double sampleRate);
+
+    // Configuration ---------------------------------------------------------------------
+  public:
+    // Keys: signal (tone, chirp, fm, qpsk or noise), frequency, sweep_end, sweep_time,
+    // deviation, modulation_frequency, symbol_rate, level, noise, noise_level, seed,
+    // sample_rate, block_size, pacing and centre_frequency
+    bool configure(const QJsonObject &settings) override;
+
+    // Widget ----------------------------------------------------------------------------
+  private:
+    std::unique_ptr<SyntheticWidget> widget_; // Inherits from QWidget
+  public:
+    QWidget *getWidget() override;
+};
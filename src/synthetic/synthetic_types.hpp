@@ -0,0 +1,44 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#define SYNTHETIC_INITIAL_CENTRE_FREQUENCY 100'000'000.0
+#define SYNTHETIC_INITIAL_SAMPLE_RATE 10'000'000.0
+#define SYNTHETIC_BLOCK_SAMPLES 65536
+#define SYNTHETIC_POOL_BLOCKS 32
+#define SYNTHETIC_POOL_WAIT 100 // us, waiting for a free block when not paced
+
+enum class SyntheticSignal
+{
+    Tone,
+    Chirp, // Linear sweep from `frequency` to `sweepEnd`, repeating
+    Fm,    // Carrier at `frequency` modulated by a tone
+    Qpsk,  // Random symbols on a carrier at `frequency`
+    Noise  // Just AWGN, at `level`
+};
+
+// Frequencies are offsets from the centre frequency, in Hz. Levels are in dBFS.
+// NOLINTBEGIN(readability-magic-numbers)
+struct SyntheticSettings
+{
+    SyntheticSignal signal{SyntheticSignal::Tone};
+    double frequency{100'000};
+    double sweepEnd{1'000'000};
+    double sweepTime{0.01}; // s
+    double deviation{75'000};
+    double modulationFrequency{1'000};
+    double symbolRate{250'000};
+    double level{-6};
+    bool noise{true}; // Added to the signal
+    double noiseLevel{-40};
+    uint32_t seed{1};
+};
+// NOLINTEND(readability-magic-numbers)
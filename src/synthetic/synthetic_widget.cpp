@@ -0,0 +1,215 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#include "synthetic_widget.hpp"
+
+#include "synthetic_source.hpp"
+
+#include <limits>
+
+static void setupFrequencyBox(QDoubleSpinBox *box)
+{
+    box->setMinimum(-250'000'000.00); // NOLINT(readability-magic-numbers)
+    box->setMaximum(250'000'000.00);  // NOLINT(readability-magic-numbers)
+    box->setDecimals(2);
+    box->setSuffix(" Hz");
+    box->setGroupSeparatorShown(true);
+    box->setKeyboardTracking(false);
+}
+
+static void setupLevelBox(QDoubleSpinBox *box)
+{
+    box->setMinimum(-150); // NOLINT(readability-magic-numbers)
+    box->setMaximum(20);   // NOLINT(readability-magic-numbers)
+    box->setDecimals(1);
+    box->setSuffix(" dBFS");
+    box->setKeyboardTracking(false);
+}
+
+SyntheticWidget::SyntheticWidget(SyntheticSource *source)
+    : source_(source), running_(false), layout_(new QFormLayout(this)),
+      signalCombo_(new QComboBox(this)), frequencyBox_(new QDoubleSpinBox(this)),
+      sweepEndBox_(new QDoubleSpinBox(this)), sweepTimeBox_(new QDoubleSpinBox(this)),
+      deviationBox_(new QDoubleSpinBox(this)),
+      modulationFrequencyBox_(new QDoubleSpinBox(this)),
+      symbolRateBox_(new QDoubleSpinBox(this)), levelBox_(new QDoubleSpinBox(this)),
+      noiseBox_(new QCheckBox(this)), noiseLevelBox_(new QDoubleSpinBox(this)),
+      seedBox_(new QSpinBox(this)), sampleRateBox_(new QDoubleSpinBox(this)),
+      blockSizeBox_(new QSpinBox(this)), pacingCombo_(new QComboBox(this))
+{
+    setMinimumWidth(1); // Makes parent take control of the size;
+
+    // Setup the layout
+    layout_->addRow("Signal", signalCombo_);
+    layout_->addRow("Frequency", frequencyBox_);
+    layout_->addRow("Sweep end", sweepEndBox_);
+    layout_->addRow("Sweep time", sweepTimeBox_);
+    layout_->addRow("Deviation", deviationBox_);
+    layout_->addRow("Mod. frequency", modulationFrequencyBox_);
+    layout_->addRow("Symbol rate", symbolRateBox_);
+    layout_->addRow("Level", levelBox_);
+    layout_->addRow("Add noise", noiseBox_);
+    layout_->addRow("Noise level", noiseLevelBox_);
+    layout_->addRow("Seed", seedBox_);
+    layout_->addRow("Sample rate", sampleRateBox_);
+    layout_->addRow("Block size", blockSizeBox_);
+    layout_->addRow("Pacing", pacingCombo_);
+
+    // Customize widgets
+    // Same order as `SyntheticSignal`
+    signalCombo_->addItems({"Tone", "Chirp", "FM", "QPSK", "Noise"});
+    // Same order as `SourcePacing`
+    pacingCombo_->addItems({"Real time", "As fast as possible"});
+
+    setupFrequencyBox(frequencyBox_);
+    setupFrequencyBox(sweepEndBox_);
+    setupFrequencyBox(deviationBox_);
+    setupFrequencyBox(modulationFrequencyBox_);
+    setupFrequencyBox(symbolRateBox_);
+    deviationBox_->setMinimum(0);
+    modulationFrequencyBox_->setMinimum(0);
+    symbolRateBox_->setMinimum(1);
+    symbolRateBox_->setSuffix(" Bd");
+
+    sweepTimeBox_->setMinimum(0.000'001); // NOLINT(readability-magic-numbers)
+    sweepTimeBox_->setMaximum(3600);      // NOLINT(readability-magic-numbers)
+    sweepTimeBox_->setDecimals(6);        // NOLINT(readability-magic-numbers)
+    sweepTimeBox_->setSuffix(" s");
+    sweepTimeBox_->setKeyboardTracking(false);
+
+    setupLevelBox(levelBox_);
+    setupLevelBox(noiseLevelBox_);
+
+    seedBox_->setMinimum(0);
+    seedBox_->setMaximum(std::numeric_limits<int>::max());
+    seedBox_->setKeyboardTracking(false);
+
+    sampleRateBox_->setMinimum(1);
+    sampleRateBox_->setMaximum(500'000'000.00); // NOLINT(readability-magic-numbers)
+    sampleRateBox_->setDecimals(2);
+    sampleRateBox_->setSuffix(" Sa/s");
+    sampleRateBox_->setGroupSeparatorShown(true);
+    sampleRateBox_->setKeyboardTracking(false);
+
+    blockSizeBox_->setMinimum(1);
+    blockSizeBox_->setMaximum(1 << 24); // NOLINT(readability-magic-numbers)
+    blockSizeBox_->setSuffix(" samples");
+    blockSizeBox_->setKeyboardTracking(false);
+
+    // Connect (the easy) slots
+    // Every signal parameter may change while running
+    connect(signalCombo_, &QComboBox::currentIndexChanged, [&]() { applySettings(); });
+    for (auto *box : {frequencyBox_, sweepEndBox_, sweepTimeBox_, deviationBox_,
+                      modulationFrequencyBox_, symbolRateBox_, levelBox_, noiseLevelBox_})
+    {
+        connect(box, &QDoubleSpinBox::valueChanged, [&]() { applySettings(); });
+    }
+    connect(noiseBox_, &QCheckBox::toggled, [&]() { applySettings(); });
+    connect(seedBox_, &QSpinBox::valueChanged, [&]() { applySettings(); });
+
+    connect(pacingCombo_, &QComboBox::currentIndexChanged,
+            [&](int idx) { source_->setPacing(static_cast<SourcePacing>(idx)); });
+
+    connect(sampleRateBox_, &QDoubleSpinBox::valueChanged, [&](double value) {
+        source_->setSampleRate(value);
+        syncUi();
+    });
+    connect(blockSizeBox_, &QSpinBox::valueChanged, [&](int value) {
+        source_->setBlockSize(static_cast<size_t>(value));
+        syncUi();
+    });
+
+    syncUi();
+}
+
+SyntheticSettings SyntheticWidget::settingsFromUi() const
+{
+    SyntheticSettings settings;
+    settings.signal = static_cast<SyntheticSignal>(signalCombo_->currentIndex());
+    settings.frequency = frequencyBox_->value();
+    settings.sweepEnd = sweepEndBox_->value();
+    settings.sweepTime = sweepTimeBox_->value();
+    settings.deviation = deviationBox_->value();
+    settings.modulationFrequency = modulationFrequencyBox_->value();
+    settings.symbolRate = symbolRateBox_->value();
+    settings.level = levelBox_->value();
+    settings.noise = noiseBox_->isChecked();
+    settings.noiseLevel = noiseLevelBox_->value();
+    settings.seed = static_cast<uint32_t>(seedBox_->value());
+    return settings;
+}
+
+void SyntheticWidget::applySettings()
+{
+    source_->setSettings(settingsFromUi());
+    syncUi();
+}
+
+void SyntheticWidget::syncUi()
+{
+    auto settings = source_->getSettings();
+    auto signal = settings.signal;
+
+    // Block the signals so syncing doesn't apply the settings back
+    auto set = [](QDoubleSpinBox *box, double value, bool enabled) {
+        box->blockSignals(true);
+        box->setValue(value);
+        box->setEnabled(enabled);
+        box->blockSignals(false);
+    };
+
+    signalCombo_->blockSignals(true);
+    signalCombo_->setCurrentIndex(static_cast<int>(signal));
+    signalCombo_->blockSignals(false);
+
+    set(frequencyBox_, settings.frequency, signal != SyntheticSignal::Noise);
+    set(sweepEndBox_, settings.sweepEnd, signal == SyntheticSignal::Chirp);
+    set(sweepTimeBox_, settings.sweepTime, signal == SyntheticSignal::Chirp);
+    set(deviationBox_, settings.deviation, signal == SyntheticSignal::Fm);
+    set(modulationFrequencyBox_, settings.modulationFrequency,
+        signal == SyntheticSignal::Fm);
+    set(symbolRateBox_, settings.symbolRate, signal == SyntheticSignal::Qpsk);
+    set(levelBox_, settings.level, true);
+
+    noiseBox_->blockSignals(true);
+    noiseBox_->setChecked(settings.noise);
+    noiseBox_->setEnabled(signal != SyntheticSignal::Noise);
+    noiseBox_->blockSignals(false);
+
+    set(noiseLevelBox_, settings.noiseLevel,
+        settings.noise && signal != SyntheticSignal::Noise);
+
+    // The seed only takes effect on start
+    seedBox_->blockSignals(true);
+    seedBox_->setValue(static_cast<int>(settings.seed));
+    seedBox_->setEnabled(!running_);
+    seedBox_->blockSignals(false);
+
+    set(sampleRateBox_, source_->getSampleRate(), !running_);
+
+    blockSizeBox_->blockSignals(true);
+    blockSizeBox_->setValue(static_cast<int>(source_->getBlockSize()));
+    blockSizeBox_->setEnabled(!running_);
+    blockSizeBox_->blockSignals(false);
+
+    pacingCombo_->blockSignals(true);
+    pacingCombo_->setCurrentIndex(static_cast<int>(source_->getPacing()));
+    pacingCombo_->blockSignals(false);
+}
+
+void SyntheticWidget::sourceStarted()
+{
+    running_ = true;
+    syncUi();
+}
+
+void SyntheticWidget::sourceStopped()
+{
+    running_ = false;
+    syncUi();
+}
@@ -0,0 +1,56 @@
+/*
+ * This file is part of Aether Explorer
+ *
+ * Copyright (c) 2021 Rui Oliveira
+ * SPDX-License-Identifier: GPL-3.0-only
+ * Consult LICENSE.txt for detailed licensing information
+ */
+
+#pragma once
+
+#include "synthetic_types.hpp"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QSpinBox>
+#include <QWidget>
+
+class SyntheticSource;
+
+class SyntheticWidget : public QWidget
+{
+  public:
+    SyntheticWidget() = delete;
+    SyntheticWidget(SyntheticSource *source);
+    ~SyntheticWidget() override = default;
+
+    void syncUi();
+    void sourceStarted();
+    void sourceStopped();
+
+  private:
+    SyntheticSource *source_;
+    bool running_;
+
+    QFormLayout *layout_;
+
+    QComboBox *signalCombo_;
+    QDoubleSpinBox *frequencyBox_;
+    QDoubleSpinBox *sweepEndBox_;
+    QDoubleSpinBox *sweepTimeBox_;
+    QDoubleSpinBox *deviationBox_;
+    QDoubleSpinBox *modulationFrequencyBox_;
+    QDoubleSpinBox *symbolRateBox_;
+    QDoubleSpinBox *levelBox_;
+    QCheckBox *noiseBox_;
+    QDoubleSpinBox *noiseLevelBox_;
+    QSpinBox *seedBox_;
+    QDoubleSpinBox *sampleRateBox_;
+    QSpinBox *blockSizeBox_;
+    QComboBox *pacingCombo_;
+
+    [[nodiscard]] SyntheticSettings settingsFromUi() const;
+    void applySettings();
+};